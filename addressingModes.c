@@ -8,11 +8,12 @@
 #include "universal.h"
 #include "textToBinary.h"
 #include "errorTreatment.h"
+#include "symbolTable.h"
 
-char* immediate_addressing(char* input, ptrLabel h);
-char* direct_addressing(char* input, ptrLabel h);
-char* index_addressing(char* input, ptrLabel h);
-char* direct_register_addressing(char* sourceRegister, char* destinationRegister);
+int immediate_addressing(char* input, symbolTable* symbols, machineWord* output);
+int direct_addressing(char* input, symbolTable* symbols, machineWord* output);
+int index_addressing(char* input, symbolTable* symbols, machineWord* output);
+machineWord direct_register_addressing(char* sourceRegister, char* destinationRegister);
 
 /******************************************************
  * Function: detect_addressing_mode
@@ -33,77 +34,79 @@ int detect_addressing_mode(char* input) {
 /******************************************************
  * Function: immediate_addressing
  * Description: Processes immediate addressing mode
- *		and return binary string representing the input.
+ *		and stores the machine word representing the input.
  * 
  * @param input: The input string representing the immediate value or label.
- * @param h: Pointer to the symbol table.
- * @return The binary string representing the immediate value.
+ * @param symbols: Pointer to the symbol table.
+ * @param output: Where the machine word is stored.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-char* immediate_addressing(char* input, ptrLabel h) {
+int immediate_addressing(char* input, symbolTable* symbols, machineWord* output) {
   ptrLabel label;
   if(input[0] == '#') memmove(input, input + 1, strlen(input)); /*Remove '#'*/
-  if(is_number(input) == YES) return decimalToBinaryARE(atoi(input), A); /*Check if input is a number*/
-  else if ((label = is_label(input, h)) != NULL) { /*Check if input is a label (define) if it isn't a number*/
-    if(label->labelType == DEFINE) {
-      return decimalToBinaryARE(label->data, A);
-    }
+  if(is_number(input) == YES) { /*Check if input is a number*/
+    *output = decimalToBinaryARE(atoi(input), A);
+    return NO;
   }
-  return NULL; /*Return NULL if input does not represent a valid immediate value or label*/
+  else if ((label = is_label(input, symbols)) != NULL && label->labelType == DEFINE) { /*Check if input is a label (define) if it isn't a number*/
+    *output = decimalToBinaryARE(label->data, A);
+    return NO;
+  }
+  return YES; /*Input does not represent a valid immediate value or label*/
 }
 
 /******************************************************
  * Function: direct_addressing
  * Description: Processes direct addressing mode
- *		and return binary string representing the input.
+ *		and stores the machine word representing the input.
  *
  * @param input: The input string representing the label.
- * @param h: Pointer to the symbol table.
- * @return The binary string representing the address.
+ * @param symbols: Pointer to the symbol table.
+ * @param output: Where the machine word is stored.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-char* direct_addressing(char* input, ptrLabel h) {
-  ptrLabel label = is_label(input, h);
-  if(label == NULL) return NULL; /*Return NULL if label does not exist in symbol table*/
-  if(label->labelType == EXTERNAL) return decimalToBinaryARE(0, E); /*If the label is external return binary string with E value for ARE*/
-  else if(label->labelType != DEFINE) return decimalToBinaryARE(label->data, R); /*Return binary representation of label's value*/
-  return NULL; /*Return NULL if label is not defined*/
+int direct_addressing(char* input, symbolTable* symbols, machineWord* output) {
+  ptrLabel label = is_label(input, symbols);
+  if(label == NULL || label->labelType == DEFINE) return YES; /*The label does not exist in symbol table or is a constant*/
+  if(label->labelType == EXTERNAL) *output = decimalToBinaryARE(0, E); /*If the label is external use E value for ARE*/
+  else *output = decimalToBinaryARE(label->data, R); /*Use the label's value*/
+  return NO;
 }
 
 /******************************************************
  * Function: index_addressing
  * Description: Processes index addressing mode
- *		and return binary string representing the input.
+ *		and stores the machine words representing the input.
  * 
  * @param input: The input string representing the label and index.
- * @param h: Pointer to the symbol table.
- * @return The binary string(s) representing the address and index.
+ * @param symbols: Pointer to the symbol table.
+ * @param output: Where the two machine words (address and index) are stored.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-char* index_addressing(char* input, ptrLabel h) {
-  static char output[MAX_WORD*2];
-  char* list = strtok(input, "[");
-  char* index = strtok(NULL, "]");
+int index_addressing(char* input, symbolTable* symbols, machineWord* output) {
+  char* save; /* Position of strtok_r in the input */
+  char* list = strtok_r(input, "[", &save);
+  char* index = strtok_r(NULL, "]", &save);
+  ptrLabel label = is_label(list, symbols);
   
-  if(direct_addressing(list, h) != NULL && is_label(list, h)->labelType != CODE) strcpy(output, direct_addressing(list, h)); /*Copy binary representation of direct addressing result(address of the list)*/
-  else return NULL; /*Return NULL if direct addressing fails*/
-  strcat(output,"\n");
-  if(immediate_addressing(index, h) != NULL) strcat(output, immediate_addressing(index, h)); /*Append binary representation of index addressing result*/
-  else return NULL; /*Return NULL if immediate addressing fails*/
-  return output; /*Return binary string(s) representing the address and index*/
+  if(label == NULL || label->labelType == CODE || index == NULL) return YES; /*The list must be a data or external label*/
+  if(direct_addressing(list, symbols, &output[0]) == YES) return YES; /*Address of the list*/
+  return immediate_addressing(index, symbols, &output[1]); /*Value of the index*/
 }
 
 /******************************************************
  * Function: direct_register_addressing
  * Description: Processes direct register addressing mode
- *		and return binary string representing the input.
+ *		and return the machine word representing the input.
  * 
  * @parame sourceRegister: The source register (1-7, 0 if NULL).
  * @param destinationRegister: The destination register (1-7, 0 if NULL).
- * @return The binary string representing the registers.
+ * @return The machine word representing the registers.
  ******************************************************/
-char* direct_register_addressing(char* sourceRegister, char* destinationRegister) {
+machineWord direct_register_addressing(char* sourceRegister, char* destinationRegister) {
   if(sourceRegister == NULL)
     return registerToBinary(0, destinationRegister[1]-'0'); /*Return binary representation of destination register*/
-  else if(destinationRegister == NULL){
-    return registerToBinary(sourceRegister[1]-'0', 0);} /*Return binary representation of source register*/
-  else return registerToBinary(sourceRegister[1]-'0', destinationRegister[1]-'0'); /*Return binary representation of both registers*/
-  return NULL; /*Return NULL if no valid registers found*/
+  else if(destinationRegister == NULL)
+    return registerToBinary(sourceRegister[1]-'0', 0); /*Return binary representation of source register*/
+  return registerToBinary(sourceRegister[1]-'0', destinationRegister[1]-'0'); /*Return binary representation of both registers*/
 }
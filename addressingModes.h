@@ -9,40 +9,43 @@ int detect_addressing_mode(char* input);
 /******************************************************
  * Function: immediate_addressing
  * Description: Processes immediate addressing mode
- *		and return binary string representing the input.
+ *		and stores the machine word representing the input.
  * 
  * @param input: The input string representing the immediate value or label.
- * @param h: Pointer to the symbol table.
- * @return The binary string representing the immediate value.
+ * @param symbols: Pointer to the symbol table.
+ * @param output: Where the machine word is stored.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-char* immediate_addressing(char* input, ptrLabel h);
+int immediate_addressing(char* input, symbolTable* symbols, machineWord* output);
 /******************************************************
  * Function: direct_addressing
  * Description: Processes direct addressing mode
- *		and return binary string representing the input.
+ *		and stores the machine word representing the input.
  *
  * @param input: The input string representing the label.
- * @param h: Pointer to the symbol table.
- * @return The binary string representing the address.
+ * @param symbols: Pointer to the symbol table.
+ * @param output: Where the machine word is stored.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-char* direct_addressing(char* input, ptrLabel h);
+int direct_addressing(char* input, symbolTable* symbols, machineWord* output);
 /******************************************************
  * Function: index_addressing
  * Description: Processes index addressing mode
- *		and return binary string representing the input.
+ *		and stores the machine words representing the input.
  * 
  * @param input: The input string representing the label and index.
- * @param h: Pointer to the symbol table.
- * @return The binary string(s) representing the address and index.
+ * @param symbols: Pointer to the symbol table.
+ * @param output: Where the two machine words (address and index) are stored.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-char* index_addressing(char* input, ptrLabel h);
+int index_addressing(char* input, symbolTable* symbols, machineWord* output);
 /******************************************************
  * Function: direct_register_addressing
  * Description: Processes direct register addressing mode
- *		and return binary string representing the input.
+ *		and return the machine word representing the input.
  * 
  * @parame sourceRegister: The source register (1-7, 0 if NULL).
  * @param destinationRegister: The destination register (1-7, 0 if NULL).
- * @return The binary string representing the registers.
+ * @return The machine word representing the registers.
  ******************************************************/
-char* direct_register_addressing(char* sourceRegister, char* destinationRegister);
+machineWord direct_register_addressing(char* sourceRegister, char* destinationRegister);
@@ -0,0 +1,167 @@
+/******************************************************
+ * File: arena.c
+ * Description: This file implements a bump allocator that
+ *              owns all the memory of a single assembled
+ *              file (macros, symbols, images and the
+ *              external/entry list). Nothing is freed
+ *              separately, the whole arena is released in
+ *              one call once the file is done.
+ ******************************************************/
+
+#include "universal.h"
+
+#define ARENA_BLOCK 65536 /*Usable size of a regular block*/
+
+/* The strictest alignment an allocation may need */
+typedef union arenaAlign {
+  long l;
+  double d;
+  void* p;
+} arenaAlign;
+
+#define ALIGN_UP(n) (((n) + sizeof(arenaAlign) - 1) / sizeof(arenaAlign) * sizeof(arenaAlign))
+#define BLOCK_DATA(b) ((char*) (b) + ALIGN_UP(sizeof(arenaBlock)))
+
+ptrArenaBlock new_arena_block(arena* memory, size_t size);
+void out_of_memory(arena* memory);
+
+/******************************************************
+ * Function: init_arena
+ * Description: Initializes an empty arena.
+ * 
+ * @param memory: Pointer to the arena to initialize.
+ ******************************************************/
+void init_arena(arena* memory) {
+  memory->head = NULL;
+  memory->last = NULL;
+  memory->reserved = 0;
+  memory->onFailure = NULL;
+}
+
+/******************************************************
+ * Function: new_arena_block
+ * Description: Requests a new block from the system.
+ * 
+ * @param memory: Pointer to the arena.
+ * @param size: Usable size of the block.
+ * @return Pointer to the new (unlinked) block.
+ ******************************************************/
+ptrArenaBlock new_arena_block(arena* memory, size_t size) {
+  ptrArenaBlock block = (ptrArenaBlock) malloc(ALIGN_UP(sizeof(arenaBlock)) + size);
+
+  if(block == NULL) out_of_memory(memory);
+  block->next = NULL;
+  block->size = size;
+  block->used = 0;
+  memory->reserved += ALIGN_UP(sizeof(arenaBlock)) + size;
+  return block;
+}
+
+/******************************************************
+ * Function: out_of_memory
+ * Description: Handles an allocation that failed. A library call that set
+ *		onFailure gets the failure back, the command line reports it and exits.
+ * 
+ * @param memory: Pointer to the arena the memory was for.
+ ******************************************************/
+void out_of_memory(arena* memory) {
+  if(memory->onFailure != NULL) longjmp(*memory->onFailure, 1);
+  printf("\nFATAL ERROR: Cannot allocate memory\n");
+  exit(1);
+}
+
+/******************************************************
+ * Function: arena_alloc
+ * Description: Allocates memory that lives until the arena is freed.
+ * 
+ * @param memory: Pointer to the arena.
+ * @param size: Number of bytes to allocate.
+ * @return Pointer to the allocated (uninitialized) memory.
+ ******************************************************/
+void* arena_alloc(arena* memory, size_t size) {
+  ptrArenaBlock block = memory->head;
+
+  size = ALIGN_UP(size == 0 ? 1 : size);
+
+  /* Large requests get a block of their own behind the current one, so its free space is not wasted */
+  if(size > ARENA_BLOCK/4) {
+    block = new_arena_block(memory, size);
+    block->used = size;
+    if(memory->head == NULL) memory->head = block;
+    else {
+      block->next = memory->head->next;
+      memory->head->next = block;
+    }
+    memory->last = BLOCK_DATA(block);
+    return memory->last;
+  }
+
+  if(block == NULL || block->size - block->used < size) {
+    block = new_arena_block(memory, ARENA_BLOCK);
+    block->next = memory->head;
+    memory->head = block;
+  }
+  memory->last = BLOCK_DATA(block) + block->used;
+  block->used += size;
+  return memory->last;
+}
+
+/******************************************************
+ * Function: arena_grow
+ * Description: Resizes an allocation. The most recent allocation
+ *		is extended in place when its block has room, otherwise
+ *		the content is copied and the old memory is left to the arena.
+ * 
+ * @param memory: Pointer to the arena.
+ * @param old: The allocation to resize (or NULL).
+ * @param oldSize: Current size of the allocation.
+ * @param newSize: Requested size of the allocation.
+ * @return Pointer to the resized allocation.
+ ******************************************************/
+void* arena_grow(arena* memory, void* old, size_t oldSize, size_t newSize) {
+  ptrArenaBlock block = memory->head;
+  void* t;
+
+  if(old != NULL && old == memory->last && block != NULL && (char*) old >= BLOCK_DATA(block) && (char*) old < BLOCK_DATA(block) + block->size) {
+    size_t start = (char*) old - BLOCK_DATA(block);
+    if(ALIGN_UP(newSize) <= block->size - start) {
+      block->used = start + ALIGN_UP(newSize);
+      return old;
+    }
+  }
+
+  t = arena_alloc(memory, newSize);
+  if(old != NULL) memcpy(t, old, oldSize < newSize ? oldSize : newSize);
+  return t;
+}
+
+/******************************************************
+ * Function: arena_strdup
+ * Description: Copies a string into the arena.
+ * 
+ * @param memory: Pointer to the arena.
+ * @param str: The string to copy.
+ * @return Pointer to the copy.
+ ******************************************************/
+char* arena_strdup(arena* memory, char* str) {
+  char* t = (char*) arena_alloc(memory, strlen(str)+1);
+  strcpy(t, str);
+  return t;
+}
+
+/******************************************************
+ * Function: free_arena
+ * Description: Frees all the memory owned by the arena.
+ * 
+ * @param memory: Pointer to the arena.
+ ******************************************************/
+void free_arena(arena* memory) {
+  ptrArenaBlock p;
+
+  while(memory->head) {
+    p = memory->head;
+    memory->head = memory->head->next;
+    free(p);
+  }
+  init_arena(memory);
+}
@@ -0,0 +1,53 @@
+/******************************************************
+ * Function: init_arena
+ * Description: Initializes an empty arena.
+ * 
+ * @param memory: Pointer to the arena to initialize.
+ ******************************************************/
+void init_arena(arena* memory);
+/******************************************************
+ * Function: out_of_memory
+ * Description: Handles an allocation that failed. A library call that set
+ *		onFailure gets the failure back, the command line reports it and exits.
+ * 
+ * @param memory: Pointer to the arena the memory was for.
+ ******************************************************/
+void out_of_memory(arena* memory);
+/******************************************************
+ * Function: arena_alloc
+ * Description: Allocates memory that lives until the arena is freed.
+ * 
+ * @param memory: Pointer to the arena.
+ * @param size: Number of bytes to allocate.
+ * @return Pointer to the allocated (uninitialized) memory.
+ ******************************************************/
+void* arena_alloc(arena* memory, size_t size);
+/******************************************************
+ * Function: arena_grow
+ * Description: Resizes an allocation. The most recent allocation
+ *		is extended in place when its block has room, otherwise
+ *		the content is copied and the old memory is left to the arena.
+ * 
+ * @param memory: Pointer to the arena.
+ * @param old: The allocation to resize (or NULL).
+ * @param oldSize: Current size of the allocation.
+ * @param newSize: Requested size of the allocation.
+ * @return Pointer to the resized allocation.
+ ******************************************************/
+void* arena_grow(arena* memory, void* old, size_t oldSize, size_t newSize);
+/******************************************************
+ * Function: arena_strdup
+ * Description: Copies a string into the arena.
+ * 
+ * @param memory: Pointer to the arena.
+ * @param str: The string to copy.
+ * @return Pointer to the copy.
+ ******************************************************/
+char* arena_strdup(arena* memory, char* str);
+/******************************************************
+ * Function: free_arena
+ * Description: Frees all the memory owned by the arena.
+ * 
+ * @param memory: Pointer to the arena.
+ ******************************************************/
+void free_arena(arena* memory);
@@ -0,0 +1,88 @@
+/******************************************************
+ * File: assembleFile.c
+ * Description: This file runs the pre-processor and the
+ *              passes on a single file. The source is
+ *              either read from the .as file or handed
+ *              over in memory by a client of the server.
+ *              Files that did not change are restored
+ *              from the cache directory instead.
+ ******************************************************/
+
+#include "universal.h"
+#include "macro.h"
+#include "firsttrans.h"
+#include "split.h"
+#include "arena.h"
+#include "context.h"
+#include "textBuffer.h"
+#include "cache.h"
+#include "stats.h"
+
+void assemble_source(assemblerContext* ctx, textBuffer* source);
+
+/******************************************************
+ * Function: assemble_file
+ * Description: Reads the .as file of the context and assembles it.
+ *
+ * @param ctx: Context of the file.
+ ******************************************************/
+void assemble_file(assemblerContext* ctx) {
+  FILE *as;
+  textBuffer source; /*The whole .as file, read at once*/
+
+  /*Open the .as file for reading*/
+  if (!(as = fopen(file_path(ctx, ".as"), "r"))) report(ctx, "\nFATAL ERROR: Cannot open file \"%s.as\"\n", ctx->fileName);
+  else {
+    init_text_buffer(&source, &ctx->memory);
+    read_text(&source, as);
+    fclose(as);
+    assemble_source(ctx, &source);
+  }
+  free_arena(&ctx->memory); /*Release everything the file allocated in one call*/
+}
+
+/******************************************************
+ * Function: assemble_source
+ * Description: Runs the pre-processor and both passes on the source of a file.
+ *		The memory of the file is not released.
+ *
+ * @param ctx: Context of the file.
+ * @param source: The content of the .as file.
+ ******************************************************/
+void assemble_source(assemblerContext* ctx, textBuffer* source) {
+  textBuffer am; /*The expanded source, kept in memory between the passes*/
+  char* fileNameAs = (char*) arena_alloc(&ctx->memory, strlen(ctx->fileName)+4);
+  char* fileNameAm = (char*) arena_alloc(&ctx->memory, strlen(ctx->fileName)+4);
+  size_t reportStart = ctx->reportLength;
+  int isCachable = ctx->options->cacheDir != NULL ? YES : NO;
+  int isError;
+
+  /*The names in the diagnostics are the ones the user gave*/
+  strcpy(fileNameAs, ctx->fileName);
+  strcpy(fileNameAm, ctx->fileName);
+  strcat(fileNameAm, ".am");
+  strcat(fileNameAs, ".as");
+
+  /*A cached file is restored without running the passes*/
+  if(isCachable == YES && restore_cached(ctx, source) == YES) {
+    ADD_STAT(ctx, bytesAllocated, (long) ctx->memory.reserved);
+    return;
+  }
+
+  init_text_buffer(&am, &ctx->memory);
+  SWITCH_PHASE(ctx, PHASE_MACRO);
+  isError = pre_processor(source, &am, fileNameAs, ctx); /*Perform preprocessing*/
+  /*The .am file is only written when asked for*/
+  if(ctx->options->emitAm == YES && write_text(&am, file_path(ctx, ".am")) == YES) {
+    report(ctx, "\nFATAL ERROR: Cannot open file \"%s\"\n", fileNameAm);
+    isCachable = NO;
+  }
+  else if(ctx->options->emitAm == YES) ADD_STAT(ctx, bytesWritten, (long) am.length);
+  if(isError == YES) {
+    report(ctx, "\nErrors detected in pre processor, output files will not be created\n");
+  }
+  else if(ctx->options->split < 2 || split_file(&am, fileNameAm, ctx) == NO) firsttrans(&am, fileNameAm, ctx); /*Execute the first parsing of the code*/
+  SWITCH_PHASE(ctx, NO_PHASE);
+  if(isCachable == YES) store_cached(ctx, source, &am, reportStart);
+  ADD_STAT(ctx, bytesAllocated, (long) ctx->memory.reserved);
+}
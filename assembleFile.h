@@ -0,0 +1,16 @@
+/******************************************************
+ * Function: assemble_file
+ * Description: Reads the .as file of the context and assembles it.
+ *
+ * @param ctx: Context of the file.
+ ******************************************************/
+void assemble_file(assemblerContext* ctx);
+/******************************************************
+ * Function: assemble_source
+ * Description: Runs the pre-processor and both passes on the source of a file.
+ *		The memory of the file is not released.
+ *
+ * @param ctx: Context of the file.
+ * @param source: The content of the .as file.
+ ******************************************************/
+void assemble_source(assemblerContext* ctx, textBuffer* source);
@@ -0,0 +1,4 @@
+.extern X
+MAIN: mov r1, X
+ cmp X, X
+ hlt
@@ -0,0 +1,315 @@
+/******************************************************
+ * File: generate.c
+ * Description: Generator of synthetic assembly sources
+ *              for the benchmarks. Every generated file
+ *              assembles without errors: instructions
+ *              only use the addressing modes their
+ *              opcode allows, every label they use is
+ *              defined and the program fits the memory,
+ *              unless -words lets it take more to time
+ *              the passes on very large files.
+ *              The options control the size of the file,
+ *              its labels and macros, the volume of its
+ *              data, how many externals and entries it
+ *              has and the mix of addressing modes.
+ *              The source is written to stdout.
+ ******************************************************/
+
+#include "../universal.h"
+
+#define DEFINES 4 /*Constants of the .define lines*/
+#define MAX_WORDS 5 /*Most words an instruction takes*/
+#define MAX_WORDS_USED (MAX_PROGRAM-1) /*Default words of the program, END takes the last one*/
+
+/* What the generated file looks like */
+typedef struct generatorOptions {
+  unsigned long seed;
+  int lines; /*Instruction and data lines, not counting macros and directives*/
+  int words; /*Words the program may take before END*/
+  int labels; /*Labels of instructions*/
+  int macros;
+  int macroSize; /*Lines of every macro*/
+  int macroUse; /*Percent of the instruction lines that use a macro instead*/
+  int data; /*Percent of the lines that are .data*/
+  int strings; /*Percent of the lines that are .string*/
+  int externs;
+  int externUse; /*Percent of the label operands that are externals*/
+  int entries;
+  int modes[4]; /*Weights of the immediate, direct, index and register modes*/
+} generatorOptions;
+
+int parse_options(int argc, char* argv[], generatorOptions* options);
+int random_below(generatorOptions* options, int limit);
+int pick_mode(generatorOptions* options, int allowed);
+int print_operand(generatorOptions* options, int mode, int dataLabels, int codeLabels);
+int print_instruction(generatorOptions* options, int dataLabels, int codeLabels);
+
+/* The mnemonics in opcode order */
+char* mnemonics[] = {"mov", "cmp", "add", "sub", "not", "clr", "lea", "inc", "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "hlt"};
+
+/******************************************************
+ * Function: main
+ * Description: The entry point of the generator, recieves its options from the command line.
+ *
+ * @param argc: The number of command-line arguments.
+ * @param argv: An array of pointers to the arguments.
+ * @return 0, or 1 if an option is invalid.
+ ******************************************************/
+int main(int argc, char* argv[]) {
+  generatorOptions options;
+  int dataLines, stringLines, codeLines;
+  int* macroWords;
+  char* data; /*The data lines, made before the code so their words are known*/
+  char* p;
+  int words = 0;
+  int codeLabels, placed = 0;
+  int i, j;
+
+  if(parse_options(argc, argv, &options) == YES) return 1;
+  if((macroWords = (int*) calloc(options.macros+1, sizeof(int))) == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+
+  /* The data is made first and takes at most half the memory, the code gets what is left */
+  dataLines = options.lines*options.data/100;
+  stringLines = options.lines*options.strings/100;
+  if((long) dataLines*4 + (long) stringLines*11 > (options.words+1)/2) {
+    long most = (long) dataLines*4 + (long) stringLines*11;
+    dataLines = (int) (dataLines*(long) ((options.words+1)/2)/most);
+    stringLines = (int) (stringLines*(long) ((options.words+1)/2)/most);
+  }
+  if((data = (char*) malloc((size_t) (dataLines+stringLines)*BUFFER+1)) == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+  /* Labelled V0 and up so index operands can use every line */
+  for(i = 0, p = data, *p = '\0'; i < dataLines+stringLines; i++) {
+    p += sprintf(p, "V%d: ", i);
+    if(i < dataLines) {
+      int count = 1 + random_below(&options, 4);
+      p += sprintf(p, ".data ");
+      for(j = 0; j < count; j++) p += sprintf(p, j == 0 ? "%d" : ", %d", random_below(&options, 2000) - 1000);
+      words += count;
+    }
+    else {
+      int length = 1 + random_below(&options, 10);
+      p += sprintf(p, ".string \"");
+      for(j = 0; j < length; j++) *p++ = 'a' + random_below(&options, 26);
+      *p++ = '"';
+      words += length+1;
+    }
+    *p++ = '\n';
+    *p = '\0';
+  }
+  codeLines = options.lines - dataLines - stringLines;
+  codeLabels = options.labels < codeLines ? options.labels : codeLines;
+  if(codeLabels > options.words-words) codeLabels = options.words-words;
+  if(options.entries > codeLabels) options.entries = codeLabels;
+
+  printf("; generated with seed %lu\n", options.seed);
+  for(i = 0; i < DEFINES; i++) printf(".define K%d = %d\n", i, i+1);
+  for(i = 0; i < options.externs; i++) printf(".extern X%d\n", i);
+  for(i = 0; i < options.entries; i++) printf(".entry L%d\n", i);
+  for(i = 0; i < options.macros; i++) {
+    printf("mcr M%d\n", i);
+    for(j = 0; j < options.macroSize; j++) macroWords[i] += print_instruction(&options, dataLines+stringLines, codeLabels);
+    printf("endmcr\n");
+  }
+
+  /* Instructions, with the labels spread evenly between them, until the memory is full */
+  for(i = 0; i < codeLines; i++) {
+    int macro = options.macros > 0 && random_below(&options, 100) < options.macroUse ? random_below(&options, options.macros) : -1;
+    int label = placed < codeLabels && (long) i*codeLabels >= (long) placed*codeLines ? YES : NO;
+    /* Room is kept for a word per label that is not placed yet */
+    if(words + (label == NO && macro != -1 ? macroWords[macro] : MAX_WORDS) + codeLabels-placed > options.words) break;
+    if(label == YES) printf("L%d: ", placed++);
+    else if(macro != -1) {
+      printf("M%d\n", macro);
+      words += macroWords[macro];
+      continue;
+    }
+    words += print_instruction(&options, dataLines+stringLines, codeLabels);
+  }
+  while(placed < codeLabels) printf("L%d: rts\n", placed++);
+  printf("END: hlt\n");
+
+  fputs(data, stdout);
+  free(data);
+  free(macroWords);
+  return 0;
+}
+
+/******************************************************
+ * Function: parse_options
+ * Description: Reads the options of the generator, every option is followed by its value.
+ *
+ * @param argc: The number of command-line arguments.
+ * @param argv: An array of pointers to the arguments.
+ * @param options: The options to fill, with their defaults first.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int parse_options(int argc, char* argv[], generatorOptions* options) {
+  char* names[] = {"-seed", "-lines", "-labels", "-macros", "-macro-size", "-macro-use", "-data", "-strings", "-externs", "-extern-use", "-entries", "-words"};
+  int* values[12];
+  int seed = 1;
+  int i, j;
+
+  options->lines = 2000;
+  options->labels = 200;
+  options->macros = 10;
+  options->macroSize = 4;
+  options->macroUse = 5;
+  options->data = 10;
+  options->strings = 5;
+  options->externs = 10;
+  options->externUse = 10;
+  options->entries = 20;
+  options->words = MAX_WORDS_USED;
+  options->modes[IMMEDIATE] = 25;
+  options->modes[DIRECT] = 25;
+  options->modes[INDEX] = 25;
+  options->modes[DIRECT_REGISTER] = 25;
+  values[0] = &seed;
+  values[1] = &options->lines;
+  values[2] = &options->labels;
+  values[3] = &options->macros;
+  values[4] = &options->macroSize;
+  values[5] = &options->macroUse;
+  values[6] = &options->data;
+  values[7] = &options->strings;
+  values[8] = &options->externs;
+  values[9] = &options->externUse;
+  values[10] = &options->entries;
+  values[11] = &options->words;
+
+  for(i = 1; i < argc; i++) {
+    if(i+1 < argc && strcmp(argv[i], "-modes") == 0) {
+      /* Four weights separated by commas */
+      if(sscanf(argv[++i], "%d,%d,%d,%d", &options->modes[IMMEDIATE], &options->modes[DIRECT], &options->modes[INDEX], &options->modes[DIRECT_REGISTER]) != 4 ||
+         options->modes[IMMEDIATE] < 0 || options->modes[DIRECT] < 0 || options->modes[INDEX] < 0 || options->modes[DIRECT_REGISTER] < 0) {
+        printf("Invalid addressing mode weights \"%s\"\n", argv[i]);
+        return YES;
+      }
+      continue;
+    }
+    for(j = 0; j < 12 && strcmp(argv[i], names[j]) != 0; j++);
+    if(j == 12 || i+1 == argc || sscanf(argv[++i], "%d", values[j]) != 1 || *values[j] < 0) {
+      printf("Usage: generate [-seed N] [-lines N] [-labels N] [-macros N] [-macro-size N] [-macro-use %%] [-data %%] [-strings %%]\n"
+             "                [-externs N] [-extern-use %%] [-entries N] [-words N] [-modes immediate,direct,index,register]\n");
+      return YES;
+    }
+  }
+  if(options->data+options->strings > 100 || options->lines == 0 || options->macroSize == 0) {
+    printf("Invalid options, the data and strings are more than 100%% or there are no lines\n");
+    return YES;
+  }
+  options->seed = (unsigned long) seed;
+  return NO;
+}
+
+/******************************************************
+ * Function: random_below
+ * Description: Draws a pseudo-random number, the same seed always gives the same file.
+ *
+ * @param options: The options, holding the state of the generator.
+ * @param limit: The numbers are below it.
+ * @return: A number from 0 to limit-1.
+ ******************************************************/
+int random_below(generatorOptions* options, int limit) {
+  options->seed = (options->seed*1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+  return (int) ((options->seed >> 8) % (unsigned long) limit);
+}
+
+/******************************************************
+ * Function: pick_mode
+ * Description: Picks an addressing mode by its weight among the allowed ones.
+ *
+ * @param options: The options, with the weights of the modes.
+ * @param allowed: Bit per allowed mode (1 << mode).
+ * @return: The addressing mode.
+ ******************************************************/
+int pick_mode(generatorOptions* options, int allowed) {
+  int total = 0;
+  int mode, pick;
+
+  for(mode = 0; mode < 4; mode++) if(allowed & (1 << mode)) total += options->modes[mode];
+  if(total == 0) return (allowed & (1 << DIRECT_REGISTER)) ? DIRECT_REGISTER : DIRECT;
+  pick = random_below(options, total);
+  for(mode = 0; mode < 4; mode++) {
+    if(!(allowed & (1 << mode))) continue;
+    if(pick < options->modes[mode]) break;
+    pick -= options->modes[mode];
+  }
+  return mode;
+}
+
+/******************************************************
+ * Function: print_operand
+ * Description: Prints an operand in an addressing mode.
+ *
+ * @param options: The options of the generator.
+ * @param mode: The addressing mode.
+ * @param dataLabels: Number of labels of data lines.
+ * @param codeLabels: Number of labels of instructions.
+ * @return: The words the operand takes.
+ ******************************************************/
+int print_operand(generatorOptions* options, int mode, int dataLabels, int codeLabels) {
+  switch(mode) {
+    case IMMEDIATE:
+      if(random_below(options, 4) == 0) printf("#K%d", random_below(options, DEFINES));
+      else printf("#%d", random_below(options, 200) - 100);
+      return 1;
+    case INDEX:
+      printf("V%d[K%d]", random_below(options, dataLabels), random_below(options, DEFINES));
+      return 2;
+    case DIRECT_REGISTER:
+      printf("r%d", random_below(options, REGISTERS));
+      return 1;
+    default:
+      if(options->externs > 0 && (dataLabels+codeLabels == 0 || random_below(options, 100) < options->externUse)) printf("X%d", random_below(options, options->externs));
+      else if(dataLabels > 0 && (codeLabels == 0 || random_below(options, 2) == 0)) printf("V%d", random_below(options, dataLabels));
+      else printf("L%d", random_below(options, codeLabels));
+      return 1;
+  }
+}
+
+/******************************************************
+ * Function: print_instruction
+ * Description: Prints an instruction with operands its opcode allows.
+ *
+ * @param options: The options of the generator.
+ * @param dataLabels: Number of labels of data lines.
+ * @param codeLabels: Number of labels of instructions.
+ * @return: The words the instruction takes.
+ ******************************************************/
+int print_instruction(generatorOptions* options, int dataLabels, int codeLabels) {
+  /* Index operands need a data line, direct ones any label */
+  int index = dataLabels > 0 ? 1 << INDEX : 0;
+  int all = 1 << IMMEDIATE | 1 << DIRECT | index | 1 << DIRECT_REGISTER;
+  int writable = 1 << DIRECT | index | 1 << DIRECT_REGISTER;
+  int opcode = random_below(options, 16);
+  int source, destination;
+  int words = 1;
+
+  if(dataLabels+codeLabels+options->externs == 0) opcode = 15;
+  printf("%s", mnemonics[opcode]);
+  if(opcode <= 3 || opcode == 6) {
+    source = pick_mode(options, opcode == 6 ? (1 << DIRECT | index) : all);
+    destination = pick_mode(options, opcode == 1 ? all : writable);
+    printf(" ");
+    words += print_operand(options, source, dataLabels, codeLabels);
+    printf(", ");
+    words += print_operand(options, destination, dataLabels, codeLabels);
+    if(source == DIRECT_REGISTER && destination == DIRECT_REGISTER) words--;
+  }
+  else if(opcode < 14) {
+    if(opcode == 12) destination = pick_mode(options, all);
+    else if(opcode == 9 || opcode == 10 || opcode == 13) destination = pick_mode(options, 1 << DIRECT | 1 << DIRECT_REGISTER);
+    else destination = pick_mode(options, writable);
+    printf(" ");
+    words += print_operand(options, destination, dataLabels, codeLabels);
+  }
+  printf("\n");
+  return words;
+}
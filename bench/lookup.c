@@ -0,0 +1,111 @@
+/******************************************************
+ * File: lookup.c
+ * Description: Microbenchmark of the reserved word lookup.
+ *              Times classify_word against the linear
+ *              strcmp searches it replaced, on a mix of
+ *              mnemonics, directives, registers and
+ *              labels, after checking they agree.
+ ******************************************************/
+
+#include "../universal.h"
+#include <time.h>
+#include "../operations.h"
+#include "../errorTreatment.h"
+
+#define ROUNDS 200000 /*Passes over the word list*/
+
+int linear_detect_opcode (char* input);
+int linear_is_valid_word(char* word);
+double seconds(clock_t start);
+
+/* Words as they appear in sources, most of them are not reserved */
+char* words[] = {"mov", "cmp", "add", "sub", "not", "clr", "lea", "inc", "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "hlt",
+  "mcr", "endmcr", ".data", ".string", ".entry", ".extern", ".define", "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7",
+  "MAIN", "LOOP", "END", "STR", "LIST", "len", "sz", "r8", "ra", "mo", "movx", "jms", "hl", ".dat", ".strings", "endmcrs", "x"};
+
+/******************************************************
+ * Function: main
+ * Description: Checks the lookups agree, then prints the time of each per call.
+ *
+ * @return 0, or 1 if the lookups disagree.
+ ******************************************************/
+int main(void) {
+  int count = sizeof(words)/sizeof(words[0]);
+  int lengths[sizeof(words)/sizeof(words[0])];
+  long calls = (long) ROUNDS*count;
+  long sum = 0;
+  clock_t start;
+  int i, j;
+
+  for(i = 0; i < count; i++) {
+    lengths[i] = strlen(words[i]);
+    if(detect_opcode(words[i]) != linear_detect_opcode(words[i]) || is_valid_word(words[i]) != linear_is_valid_word(words[i])) {
+      printf("Lookups disagree on \"%s\"\n", words[i]);
+      return 1;
+    }
+  }
+
+  start = clock();
+  for(j = 0; j < ROUNDS; j++) for(i = 0; i < count; i++) sum += linear_detect_opcode(words[i]);
+  printf("linear detect_opcode  %6.1f ns/call\n", seconds(start)*1e9/calls);
+  start = clock();
+  for(j = 0; j < ROUNDS; j++) for(i = 0; i < count; i++) sum += detect_opcode(words[i]);
+  printf("detect_opcode         %6.1f ns/call\n", seconds(start)*1e9/calls);
+  start = clock();
+  for(j = 0; j < ROUNDS; j++) for(i = 0; i < count; i++) sum += classify_word(words[i], lengths[i]);
+  printf("classify_word         %6.1f ns/call\n", seconds(start)*1e9/calls);
+  start = clock();
+  for(j = 0; j < ROUNDS; j++) for(i = 0; i < count; i++) sum += linear_is_valid_word(words[i]);
+  printf("linear is_valid_word  %6.1f ns/call\n", seconds(start)*1e9/calls);
+  start = clock();
+  for(j = 0; j < ROUNDS; j++) for(i = 0; i < count; i++) sum += is_valid_word(words[i]);
+  printf("is_valid_word         %6.1f ns/call\n", seconds(start)*1e9/calls);
+  return sum == 0; /* Keeps the calls from being optimized away */
+}
+
+/******************************************************
+ * Function: seconds
+ * Description: Returns the processor time since start.
+ *
+ * @param start: Clock at the start of the measurement.
+ * @return Seconds since start.
+ ******************************************************/
+double seconds(clock_t start) {
+  return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+/******************************************************
+ * Function: linear_detect_opcode
+ * Description: The opcode lookup before classify_word.
+ *
+ * @param input: The input string to detect the opcode.
+ * @return The index of the detected opcode, or -1 if not found.
+ ******************************************************/
+int linear_detect_opcode (char* input) {
+  char* opcode[OPCODE] = {"mov", "cmp", "add", "sub", "not", "clr", "lea", "inc", "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "hlt"};
+  int i;
+  for (i = 0; i<OPCODE; i++)
+    if(strcmp(opcode[i], input) == 0) return i;
+  return -1;
+}
+
+/******************************************************
+ * Function: linear_is_valid_word
+ * Description: The word validation before classify_word.
+ *
+ * @param word: The input string to check.
+ * @return YES if the string represents a valid word, NO otherwise.
+ ******************************************************/
+int linear_is_valid_word(char* word) {
+  const char* savedWords[31] = {"mov", "cmp", "add", "sub", "not", "clr", "lea", "inc", "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "hlt", "mcr", "endmcr", ".data", ".string", ".entry", ".extern", ".define", "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7"};
+  int i;
+  if(word == NULL) return NO;
+  for(i = 0; i<31;i++) if (strcmp(savedWords[i], word)==0) return NO;
+  if(word[0] >= 'A' && word[0] <= 'z')
+    for(i = 1; i<strlen(word);i++) {
+    if((word[i] >= 'A' && word[i] <= 'z') || (word[i] >= '0' && word[i] <= '9') || word[i] == '-' || word[i] == '_') {}
+    else return NO;
+  }
+  else return NO;
+  return YES;
+}
@@ -0,0 +1,127 @@
+/******************************************************
+ * File: phases.c
+ * Description: Benchmark of the phases of the assembler.
+ *              Assembles the given files in memory the
+ *              way the assembler does, times the macro
+ *              expansion, the first pass, the second pass
+ *              and the export of every file apart and
+ *              writes lines per second of each phase and
+ *              the peak memory, one "name value" pair per
+ *              line, so runs can be compared with diff.
+ ******************************************************/
+
+#include "../universal.h"
+#include "../arena.h"
+#include "../context.h"
+#include "../textBuffer.h"
+#include "../exportFiles.h"
+#include "../assembleFile.h"
+#include "../stats.h"
+#include <sys/resource.h>
+
+#define DEFAULT_ROUNDS 5 /*Times every file is assembled*/
+
+/******************************************************
+ * Function: main
+ * Description: Assembles the files, then writes the results.
+ *		Usage: phases [-o results] [-r rounds] file.as...
+ *
+ * @param argc: The number of command-line arguments.
+ * @param argv: An array of pointers to the arguments.
+ * @return 0, or 1 if a file cannot be read or has errors.
+ ******************************************************/
+int main(int argc, char* argv[]) {
+  assemblerOptions options;
+  assemblerStats stats;
+  assemblerContext ctx;
+  struct rusage usage;
+  arena memory; /*Owns the sources, read once before the timing*/
+  textBuffer* sources;
+  char** names; /*Names of the files without .as*/
+  char* output = NULL;
+  FILE* results = stdout;
+  double total = 0;
+  long lines = 0;
+  int rounds = DEFAULT_ROUNDS;
+  int count = 0;
+  int isError = NO;
+  int i, j;
+
+  options.jobs = 1;
+  options.emitAm = NO;
+  options.format = FORMAT_TEXT;
+  options.cacheDir = NULL;
+  options.cacheBudget = 0;
+  options.stats = STATS_OFF;
+  options.split = 1;
+  options.optimize = 0;
+  init_arena(&memory);
+  init_stats(&stats);
+  init_encryption();
+  sources = (textBuffer*) malloc(argc*sizeof(textBuffer));
+  names = (char**) malloc(argc*sizeof(char*));
+  if(sources == NULL || names == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+
+  for(i = 1; i < argc; i++) {
+    FILE* file;
+    if(strcmp(argv[i], "-o") == 0 && i+1 < argc) {
+      output = argv[++i];
+      continue;
+    }
+    if(strcmp(argv[i], "-r") == 0 && i+1 < argc) {
+      if((rounds = atoi(argv[++i])) < 1) rounds = DEFAULT_ROUNDS;
+      continue;
+    }
+    if((file = fopen(argv[i], "r")) == NULL) {
+      printf("Cannot open file \"%s\"\n", argv[i]);
+      return 1;
+    }
+    init_text_buffer(&sources[count], &memory);
+    read_text(&sources[count], file);
+    fclose(file);
+    for(j = 0; j < (int) sources[count].length; j++) if(sources[count].text[j] == '\n') lines++;
+    /* The outputs are written next to the source, under the name without .as */
+    names[count] = arena_strdup(&memory, argv[i]);
+    if(strlen(names[count]) > 3 && strcmp(names[count]+strlen(names[count])-3, ".as") == 0) names[count][strlen(names[count])-3] = '\0';
+    count++;
+  }
+  if(count == 0) {
+    printf("Usage: phases [-o results] [-r rounds] file.as...\n");
+    return 1;
+  }
+
+  for(j = 0; j < rounds; j++) {
+    for(i = 0; i < count; i++) {
+      textBuffer source = sources[i]; /* The passes move the position of their copy */
+      init_context(&ctx, names[i], &options);
+      ctx.stats = &stats;
+      assemble_source(&ctx, &source);
+      if(j == 0 && ctx.reportLength > 0) {
+        flush_report(&ctx);
+        isError = YES;
+      }
+      free(ctx.report);
+      free_arena(&ctx.memory);
+    }
+  }
+
+  if(output != NULL && (results = fopen(output, "w")) == NULL) {
+    printf("Cannot open file \"%s\"\n", output);
+    return 1;
+  }
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(results, "files %d\nrounds %d\nlines %ld\n", count, rounds, lines);
+  for(i = 0; i < PHASES; i++) {
+    total += stats.seconds[i];
+    fprintf(results, "%s.seconds %.6f\n%s.lines_per_second %.0f\n", phase_name(i), stats.seconds[i], phase_name(i), lines*rounds/stats.seconds[i]);
+  }
+  fprintf(results, "total.seconds %.6f\ntotal.lines_per_second %.0f\npeak_rss_kb %ld\n", total, lines*rounds/total, (long) usage.ru_maxrss);
+  if(results != stdout) fclose(results);
+  free(sources);
+  free(names);
+  free_arena(&memory);
+  return isError == YES ? 1 : 0;
+}
@@ -0,0 +1,229 @@
+/******************************************************
+ * File: scan.c
+ * Description: Microbenchmark of the character scanning
+ *              of the lexer. Splits every line of the
+ *              given files with next_token and with a
+ *              scanner that tests 16 characters at a
+ *              time with SSE2, after checking they find
+ *              the same tokens, and times is_number
+ *              against the version that called strlen
+ *              for every character.
+ ******************************************************/
+
+#include "../universal.h"
+#include <time.h>
+#include "../arena.h"
+#include "../textBuffer.h"
+#include "../lexer.h"
+#include "../errorTreatment.h"
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define HAS_SSE2
+#endif
+
+#define ROUNDS 20 /*Passes over the files*/
+#define DELIMITERS (LEX_SPACE|LEX_COMMA) /*The delimiters of operand lists*/
+
+extern const unsigned char lexClasses[256]; /*Delimiter classes of the lexer*/
+
+long scan_lines(textBuffer* source, int isBlock, token* tokens);
+int strlen_is_number(char* input);
+double seconds(clock_t start);
+#ifdef HAS_SSE2
+int block_next_token(lexer* lex, int delimiters, token* tok);
+int block_mask(char* p, int delimiters);
+#endif
+
+/******************************************************
+ * Function: main
+ * Description: Checks the scanners agree, then prints the time of each per line.
+ *		Usage: scan file.as...
+ *
+ * @param argc: The number of command-line arguments.
+ * @param argv: An array of pointers to the arguments.
+ * @return 0, or 1 if a file cannot be read or the scanners disagree.
+ ******************************************************/
+int main(int argc, char* argv[]) {
+  arena memory;
+  textBuffer source;
+  token* tokens;
+  char** texts;
+  long count, lines = 0;
+  long sum = 0;
+  clock_t start;
+  int i, j;
+
+  init_arena(&memory);
+  init_text_buffer(&source, &memory);
+  for(i = 1; i < argc; i++) {
+    FILE* file = fopen(argv[i], "r");
+    if(file == NULL) {
+      printf("Cannot open file \"%s\"\n", argv[i]);
+      return 1;
+    }
+    read_text(&source, file);
+    fclose(file);
+  }
+  if(source.length == 0) {
+    printf("Usage: scan file.as...\n");
+    return 1;
+  }
+  for(i = 0; i < (int) source.length; i++) if(source.text[i] == '\n') lines++;
+
+  /* Every token of the files, for the check and for is_number */
+  count = scan_lines(&source, NO, NULL);
+  tokens = (token*) arena_alloc(&memory, (count+1)*sizeof(token));
+  texts = (char**) arena_alloc(&memory, (count+1)*sizeof(char*));
+  scan_lines(&source, NO, tokens);
+  for(i = 0; i < count; i++) texts[i] = token_text(&tokens[i], (char*) arena_alloc(&memory, tokens[i].length+1));
+#ifdef HAS_SSE2
+  {
+    token* blockTokens = (token*) arena_alloc(&memory, (count+1)*sizeof(token));
+    if(scan_lines(&source, YES, blockTokens) != count) {
+      printf("The scanners disagree on the number of tokens\n");
+      return 1;
+    }
+    for(i = 0; i < count; i++)
+      if(blockTokens[i].start != tokens[i].start || blockTokens[i].length != tokens[i].length) {
+        printf("The scanners disagree on \"%s\"\n", texts[i]);
+        return 1;
+      }
+  }
+#endif
+  for(i = 0; i < count; i++)
+    if(is_number(texts[i]) != strlen_is_number(texts[i])) {
+      printf("is_number disagrees on \"%s\"\n", texts[i]);
+      return 1;
+    }
+
+  start = clock();
+  for(j = 0; j < ROUNDS; j++) sum += scan_lines(&source, NO, NULL);
+  printf("next_token            %6.1f ns/line\n", seconds(start)*1e9/(lines*ROUNDS));
+#ifdef HAS_SSE2
+  start = clock();
+  for(j = 0; j < ROUNDS; j++) sum += scan_lines(&source, YES, NULL);
+  printf("SSE2 next_token       %6.1f ns/line\n", seconds(start)*1e9/(lines*ROUNDS));
+#else
+  printf("SSE2 next_token       not available\n");
+#endif
+  start = clock();
+  for(j = 0; j < ROUNDS; j++) for(i = 0; i < count; i++) sum += strlen_is_number(texts[i]);
+  printf("strlen is_number      %6.1f ns/call\n", seconds(start)*1e9/(count*ROUNDS));
+  start = clock();
+  for(j = 0; j < ROUNDS; j++) for(i = 0; i < count; i++) sum += is_number(texts[i]);
+  printf("is_number             %6.1f ns/call\n", seconds(start)*1e9/(count*ROUNDS));
+
+  free_arena(&memory);
+  return sum == 0; /* Keeps the calls from being optimized away */
+}
+
+/******************************************************
+ * Function: scan_lines
+ * Description: Splits every line of the source into tokens.
+ *
+ * @param source: The source, read from its start.
+ * @param isBlock: YES to use the SSE2 scanner, NO for next_token.
+ * @param tokens: Where the tokens are stored, NULL to only count them.
+ * @return: The number of tokens.
+ ******************************************************/
+long scan_lines(textBuffer* source, int isBlock, token* tokens) {
+  lexer lex;
+  token tok;
+  char* line;
+  long count = 0;
+  int length;
+
+  source->position = 0;
+  while((line = next_line(source, BUFFER-1, &length)) != NULL) {
+    init_lexer(&lex, line, length);
+#ifdef HAS_SSE2
+    if(isBlock == YES) {
+      while(block_next_token(&lex, DELIMITERS, &tok) == YES) if(tokens != NULL) tokens[count++] = tok; else count++;
+      continue;
+    }
+#endif
+    while(next_token(&lex, DELIMITERS, &tok) == YES) if(tokens != NULL) tokens[count++] = tok; else count++;
+  }
+  return count;
+}
+
+#ifdef HAS_SSE2
+/******************************************************
+ * Function: block_next_token
+ * Description: Finds the next token like next_token, testing 16 characters at a time
+ *		while that many are left in the line.
+ *
+ * @param lex: Pointer to the lexer.
+ * @param delimiters: The LEX_ classes that separate tokens.
+ * @param tok: Where the token is stored.
+ * @return: YES if a token was found, NO at the end of the line.
+ ******************************************************/
+int block_next_token(lexer* lex, int delimiters, token* tok) {
+  char* p = lex->position;
+  int mask = 0;
+
+  while(lex->end - p >= 16 && (mask = block_mask(p, delimiters)) == 0xFFFF) p += 16;
+  if(lex->end - p >= 16) p += __builtin_ctz(~mask & 0xFFFF);
+  else while(p < lex->end && (lexClasses[(unsigned char) *p] & delimiters)) p++;
+  if(p == lex->end) {
+    lex->position = p;
+    return NO;
+  }
+  tok->start = p;
+  while(lex->end - p >= 16 && (mask = block_mask(p, delimiters)) == 0) p += 16;
+  if(lex->end - p >= 16) p += __builtin_ctz(mask);
+  else while(p < lex->end && !(lexClasses[(unsigned char) *p] & delimiters)) p++;
+  tok->length = p - tok->start;
+  lex->position = p < lex->end ? p+1 : p;
+  classify_token(tok);
+  return YES;
+}
+
+/******************************************************
+ * Function: block_mask
+ * Description: Finds the delimiters among 16 characters.
+ *
+ * @param p: The characters, all 16 inside the line.
+ * @param delimiters: The LEX_ classes that separate tokens.
+ * @return: A bit for every character that is a delimiter.
+ ******************************************************/
+int block_mask(char* p, int delimiters) {
+  __m128i block = _mm_loadu_si128((__m128i*) p);
+  __m128i found = _mm_setzero_si128();
+
+  if(delimiters & LEX_SPACE) found = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t')));
+  if(delimiters & LEX_COMMA) found = _mm_or_si128(found, _mm_cmpeq_epi8(block, _mm_set1_epi8(',')));
+  if(delimiters & LEX_EQUALS) found = _mm_or_si128(found, _mm_cmpeq_epi8(block, _mm_set1_epi8('=')));
+  if(delimiters & LEX_NEWLINE) found = _mm_or_si128(found, _mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+  if(delimiters & LEX_OPEN) found = _mm_or_si128(found, _mm_cmpeq_epi8(block, _mm_set1_epi8('[')));
+  if(delimiters & LEX_CLOSE) found = _mm_or_si128(found, _mm_cmpeq_epi8(block, _mm_set1_epi8(']')));
+  return _mm_movemask_epi8(found);
+}
+#endif
+
+/******************************************************
+ * Function: strlen_is_number
+ * Description: The is_number that was replaced.
+ *
+ * @param input: The input string to check.
+ * @return YES if the string represents a number, NO otherwise.
+ ******************************************************/
+int strlen_is_number(char* input) {
+  int i;
+  for(i = 0; i < strlen(input); i++)
+    if(!(input[i] == '0' || input[i] == '1' || input[i] == '2' || input[i] == '3' || input[i] == '4' || input[i] == '5' || input[i] == '6' || input[i] == '7' ||
+        input[i] == '8' || input[i] == '9' || (i==0 && input[i] == '+') || (i==0 && input[i] == '-')))
+      return NO;
+  return YES;
+}
+
+/******************************************************
+ * Function: seconds
+ * Description: Returns the processor time since start.
+ *
+ * @param start: Clock at the start of the measurement.
+ * @return Seconds since start.
+ ******************************************************/
+double seconds(clock_t start) {
+  return (double) (clock()-start)/CLOCKS_PER_SEC;
+}
@@ -0,0 +1,222 @@
+/******************************************************
+ * File: threads.c
+ * Description: Check of the assembler library on several
+ *              threads. Every thread assembles all the
+ *              given files with asm_assemble_buffer, a few
+ *              rounds each, and compares the images and
+ *              symbols, written out as .ob, .ent and .ext
+ *              text, with the files the command line wrote
+ *              next to every source. A source the command
+ *              line wrote no .ob file for must fail.
+ ******************************************************/
+
+#include "../universal.h"
+#include "../arena.h"
+#include "../context.h"
+#include "../textBuffer.h"
+#include "../exportFiles.h"
+#include "../libasm.h"
+#include <pthread.h>
+
+#define DEFAULT_THREADS 4 /*Threads that assemble the files at once*/
+#define DEFAULT_ROUNDS 3 /*Times every thread assembles every file*/
+
+/* A source and what the command line wrote for it */
+typedef struct checkedFile {
+  char* name; /*Path of the source without .as*/
+  textBuffer source;
+  textBuffer expected[OUTPUTS]; /*The .ob, .ent and .ext files, empty when they were not written*/
+  int isWritten; /*YES if the command line wrote an .ob file*/
+} checkedFile;
+
+/* The files a thread checks and what it found */
+typedef struct checkThread {
+  pthread_t thread;
+  checkedFile* files;
+  int count;
+  int rounds;
+  int failures;
+} checkThread;
+
+void* check_files(void* arg);
+int check_result(checkedFile* file, asmResult* result);
+void read_output(textBuffer* text, char* name, const char* extension, arena* memory);
+
+/******************************************************
+ * Function: main
+ * Description: Reads the files and their outputs, runs the threads, then writes the results.
+ *		Usage: threads [-t threads] [-r rounds] file.as...
+ *
+ * @param argc: The number of command-line arguments.
+ * @param argv: An array of pointers to the arguments.
+ * @return 0, or 1 if a file cannot be read or a result differs.
+ ******************************************************/
+int main(int argc, char* argv[]) {
+  arena memory; /*Owns the sources and the outputs, only read by the threads*/
+  checkedFile* files;
+  checkThread* threads;
+  int threadCount = DEFAULT_THREADS;
+  int rounds = DEFAULT_ROUNDS;
+  int count = 0;
+  int failures = 0;
+  int i;
+
+  init_arena(&memory);
+  init_encryption();
+  if((files = (checkedFile*) malloc(argc*sizeof(checkedFile))) == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+
+  for(i = 1; i < argc; i++) {
+    checkedFile* file = &files[count];
+    FILE* source;
+    if(strcmp(argv[i], "-t") == 0 && i+1 < argc) {
+      if((threadCount = atoi(argv[++i])) < 1) threadCount = DEFAULT_THREADS;
+      continue;
+    }
+    if(strcmp(argv[i], "-r") == 0 && i+1 < argc) {
+      if((rounds = atoi(argv[++i])) < 1) rounds = DEFAULT_ROUNDS;
+      continue;
+    }
+    if((source = fopen(argv[i], "r")) == NULL) {
+      printf("Cannot open file \"%s\"\n", argv[i]);
+      return 1;
+    }
+    init_text_buffer(&file->source, &memory);
+    read_text(&file->source, source);
+    fclose(source);
+    file->name = arena_strdup(&memory, argv[i]);
+    if(strlen(file->name) > 3 && strcmp(file->name+strlen(file->name)-3, ".as") == 0) file->name[strlen(file->name)-3] = '\0';
+    read_output(&file->expected[OUTPUT_OB], file->name, ".ob", &memory);
+    read_output(&file->expected[OUTPUT_ENT], file->name, ".ent", &memory);
+    read_output(&file->expected[OUTPUT_EXT], file->name, ".ext", &memory);
+    file->isWritten = file->expected[OUTPUT_OB].length > 0 ? YES : NO;
+    count++;
+  }
+  if(count == 0) {
+    printf("Usage: threads [-t threads] [-r rounds] file.as...\n");
+    return 1;
+  }
+
+  if((threads = (checkThread*) malloc(threadCount*sizeof(checkThread))) == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+  for(i = 0; i < threadCount; i++) {
+    threads[i].files = files;
+    threads[i].count = count;
+    threads[i].rounds = rounds;
+    threads[i].failures = 0;
+    if(pthread_create(&threads[i].thread, NULL, check_files, &threads[i]) != 0) {
+      printf("Cannot start thread %d\n", i);
+      return 1;
+    }
+  }
+  for(i = 0; i < threadCount; i++) {
+    pthread_join(threads[i].thread, NULL);
+    failures += threads[i].failures;
+  }
+
+  printf("files %d\nthreads %d\nrounds %d\nfailures %d\n", count, threadCount, rounds, failures);
+  free(threads);
+  free(files);
+  free_arena(&memory);
+  return failures > 0 ? 1 : 0;
+}
+
+/******************************************************
+ * Function: check_files
+ * Description: Assembles the files of a thread with the library and checks every result.
+ *
+ * @param arg: The checkThread of the thread, its failures are counted there.
+ * @return: NULL.
+ ******************************************************/
+void* check_files(void* arg) {
+  checkThread* work = (checkThread*) arg;
+  asmResult result;
+  int round, i;
+
+  for(round = 0; round < work->rounds; round++) {
+    for(i = 0; i < work->count; i++) {
+      checkedFile* file = &work->files[i];
+      asm_assemble_buffer(file->source.text, file->source.length, &result);
+      if(check_result(file, &result) == NO) {
+        if(work->failures == 0) printf("\"%s\" differs from the command line\n", file->name);
+        work->failures++;
+      }
+      asm_free_result(&result);
+    }
+  }
+  return NULL;
+}
+
+/******************************************************
+ * Function: check_result
+ * Description: Writes a result the way the command line writes its output files
+ *		and compares it with the files it wrote.
+ *
+ * @param file: The file, with the outputs of the command line.
+ * @param result: The result of the library for the file.
+ * @return: YES if they are the same, NO otherwise.
+ ******************************************************/
+int check_result(checkedFile* file, asmResult* result) {
+  assemblerContext ctx; /*Only its output buffers and its IC and DC are used*/
+  char line[BUFFER*2];
+  char* words;
+  int outputs[3];
+  int isSame = YES;
+  int i;
+
+  if(result->isError == YES || file->isWritten == NO) return result->isError == YES && file->isWritten == NO ? YES : NO;
+  init_context(&ctx, file->name, NULL);
+  ctx.IC = result->image.IC;
+  ctx.DC = result->image.DC;
+  words = object_words(&ctx, ctx.IC+ctx.DC);
+  write_object_words(words, result->image.words, 0, ctx.IC+ctx.DC);
+  for(i = 0; i < result->entryCount; i++) {
+    sprintf(line, "%-8s %04d\n", result->entries[i].name, result->entries[i].address);
+    append_text(&ctx.output[OUTPUT_ENT], line, strlen(line));
+  }
+  for(i = 0; i < result->externalCount; i++) {
+    sprintf(line, "%-8s %04d\n", result->externals[i].name, result->externals[i].address);
+    append_text(&ctx.output[OUTPUT_EXT], line, strlen(line));
+  }
+
+  outputs[0] = OUTPUT_OB;
+  outputs[1] = OUTPUT_ENT;
+  outputs[2] = OUTPUT_EXT;
+  for(i = 0; i < 3; i++) {
+    textBuffer* made = &ctx.output[outputs[i]];
+    textBuffer* expected = &file->expected[outputs[i]];
+    if(made->length != expected->length || (made->length > 0 && memcmp(made->text, expected->text, made->length) != 0)) isSame = NO;
+  }
+  free_arena(&ctx.memory);
+  return isSame;
+}
+
+/******************************************************
+ * Function: read_output
+ * Description: Reads an output file of the command line, if it wrote one.
+ *
+ * @param text: Where the file is read, left empty if there is no file.
+ * @param name: Path of the source without .as.
+ * @param extension: The extension of the file, with its dot.
+ * @param memory: The arena that owns the text.
+ ******************************************************/
+void read_output(textBuffer* text, char* name, const char* extension, arena* memory) {
+  char* path = (char*) malloc(strlen(name) + strlen(extension) + 1);
+  FILE* file;
+
+  if(path == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+  init_text_buffer(text, memory);
+  sprintf(path, "%s%s", name, extension);
+  if((file = fopen(path, "r")) != NULL) {
+    read_text(text, file);
+    fclose(file);
+  }
+  free(path);
+}
@@ -0,0 +1,278 @@
+/******************************************************
+ * File: cache.c
+ * Description: This file keeps the results of assembled
+ *              files in a cache directory (--cache=DIR).
+ *              An entry is keyed by a hash of the name and
+ *              content of the .as file and the assembler
+ *              version, and holds the source itself, so a
+ *              hit is only taken when the source is exactly
+ *              the same. A hit restores the .am, .ob, .ent
+ *              and .ext files and the diagnostics without
+ *              running the passes. Entries are written to a
+ *              temporary file and renamed into place, the
+ *              least recently used ones are removed once the
+ *              directory grows over its size budget.
+ *              Temporary files a crashed writer left behind
+ *              count against the budget and are removed
+ *              once they are old.
+ ******************************************************/
+
+#include "universal.h"
+#include "context.h"
+#include "textBuffer.h"
+#include "symbolTable.h"
+#include "arena.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <time.h>
+
+#define CACHE_MAGIC "ASMCACHE" /*First word of every entry*/
+#define CACHE_FIELDS (4+OUTPUTS) /*Name, source, .am, diagnostics and the output files*/
+#define CACHE_HEADER 256 /*Room for the first line of an entry*/
+#define STALE_TEMPORARY 3600 /*Seconds after which a temporary file is taken as left by a crash*/
+
+/* A file of the cache directory, for eviction */
+typedef struct cacheFile {
+  char* name;
+  long size;
+  time_t used;
+  int isTemporary; /*YES for an entry that is still being written*/
+} cacheFile;
+
+char* cache_path(assemblerContext* ctx, textBuffer* source);
+int read_file(char* fileName, textBuffer* buffer);
+int write_changed(assemblerContext* ctx, char* fileName, char* text, long length);
+int compare_cache_files(const void* a, const void* b);
+
+/******************************************************
+ * Function: init_cache
+ * Description: Creates the cache directory if it does not exist yet.
+ *
+ * @param options: Command-line options, with the cache directory.
+ ******************************************************/
+void init_cache(assemblerOptions* options) {
+  mkdir(options->cacheDir, 0777);
+}
+
+/******************************************************
+ * Function: restore_cached
+ * Description: Restores the output files and the diagnostics of a file from its cache entry.
+ *
+ * @param ctx: Context of the file.
+ * @param source: The content of the .as file.
+ * @return: YES if the entry was found and restored, NO otherwise.
+ ******************************************************/
+int restore_cached(assemblerContext* ctx, textBuffer* source) {
+  char* path = cache_path(ctx, source);
+  textBuffer entry;
+  long lengths[CACHE_FIELDS];
+  char* fields[CACHE_FIELDS];
+  char* p;
+  char* end;
+  int i;
+
+  init_text_buffer(&entry, &ctx->memory);
+  if(read_file(path, &entry) == YES) return NO;
+
+  /* The first line holds the length of every field, 0 for a file that was not written */
+  p = (char*) memchr(entry.text, '\n', entry.length < CACHE_HEADER ? entry.length : CACHE_HEADER);
+  if(p == NULL) return NO;
+  *p = '\0';
+  if(strncmp(entry.text, CACHE_MAGIC " " ASSEMBLER_VERSION " ", strlen(CACHE_MAGIC " " ASSEMBLER_VERSION " ")) != 0) return NO;
+  end = entry.text + strlen(CACHE_MAGIC " " ASSEMBLER_VERSION);
+  for(i = 0; i < CACHE_FIELDS; i++) {
+    char* number = end;
+    lengths[i] = strtol(number, &end, 10);
+    if(end == number) return NO;
+  }
+  if(*end != '\0') return NO;
+  p++;
+  for(i = 0; i < CACHE_FIELDS; i++) {
+    if(lengths[i] < 0 || lengths[i] > entry.text + entry.length - p) return NO;
+    fields[i] = p;
+    p += lengths[i];
+  }
+  if(p != entry.text + entry.length) return NO;
+
+  /* Hash collisions are told apart by the name and the source themselves */
+  if(lengths[0] != (long) strlen(ctx->fileName) || memcmp(fields[0], ctx->fileName, lengths[0]) != 0 ||
+     lengths[1] != (long) source->length || memcmp(fields[1], source->text, lengths[1]) != 0) return NO;
+
+  /* A .am file that cannot be written is reported by assembling the file again */
+  if(ctx->options->emitAm == YES && write_changed(ctx, file_path(ctx, ".am"), fields[2], lengths[2]) == YES) return NO;
+  append_report(ctx, fields[3], lengths[3]);
+  for(i = 0; i < OUTPUTS; i++)
+    if(lengths[4+i] > 0) write_changed(ctx, output_file(ctx, i), fields[4+i], lengths[4+i]);
+  utime(path, NULL); /* Mark the entry as recently used */
+  return YES;
+}
+
+/******************************************************
+ * Function: store_cached
+ * Description: Writes the cache entry of a file that was just assembled.
+ *		Failures are ignored, the file is assembled again next time.
+ *
+ * @param ctx: Context of the file, with the content of its output files.
+ * @param source: The content of the .as file.
+ * @param am: The expanded source.
+ * @param reportStart: Where the diagnostics of the file start in the report.
+ ******************************************************/
+void store_cached(assemblerContext* ctx, textBuffer* source, textBuffer* am, size_t reportStart) {
+  char* path = cache_path(ctx, source);
+  char* temporary = (char*) arena_alloc(&ctx->memory, strlen(path)+64);
+  FILE* file;
+  int i;
+
+  /* Concurrent writers of the same entry use different temporary files */
+  sprintf(temporary, "%s.%ld.%lx.tmp", path, (long) getpid(), (unsigned long) ctx);
+  if((file = fopen(temporary, "w")) == NULL) return;
+  fprintf(file, CACHE_MAGIC " " ASSEMBLER_VERSION " %ld %ld %ld %ld", (long) strlen(ctx->fileName), (long) source->length, (long) am->length, (long) (ctx->reportLength-reportStart));
+  for(i = 0; i < OUTPUTS; i++) fprintf(file, " %ld", (long) ctx->output[i].length);
+  fputc('\n', file);
+  fwrite(ctx->fileName, 1, strlen(ctx->fileName), file);
+  if(source->length > 0) fwrite(source->text, 1, source->length, file);
+  if(am->length > 0) fwrite(am->text, 1, am->length, file);
+  if(ctx->reportLength > reportStart) fwrite(ctx->report+reportStart, 1, ctx->reportLength-reportStart, file);
+  for(i = 0; i < OUTPUTS; i++)
+    if(ctx->output[i].length > 0) fwrite(ctx->output[i].text, 1, ctx->output[i].length, file);
+  if(fclose(file) != 0 || rename(temporary, path) != 0) remove(temporary);
+  else ctx->isStored = YES;
+}
+
+/******************************************************
+ * Function: evict_cache
+ * Description: Removes the least recently used entries until the cache directory fits its budget.
+ *		Temporary files older than STALE_TEMPORARY are removed, younger ones may still
+ *		be renamed into place and only count against the budget.
+ *
+ * @param options: Command-line options, with the cache directory and its budget.
+ ******************************************************/
+void evict_cache(assemblerOptions* options) {
+  DIR* directory = opendir(options->cacheDir);
+  struct dirent* item;
+  struct stat status;
+  cacheFile* files = NULL;
+  char path[BUFFER*4];
+  int count = 0;
+  int capacity = 0;
+  long total = 0;
+  time_t now = time(NULL);
+  int i;
+
+  if(directory == NULL) return;
+  while((item = readdir(directory)) != NULL) {
+    size_t length = strlen(item->d_name);
+    int isTemporary = length > 10 && strcmp(item->d_name+length-4, ".tmp") == 0 && strstr(item->d_name, ".cache.") != NULL ? YES : NO;
+    if((isTemporary == NO && (length < 7 || strcmp(item->d_name+length-6, ".cache") != 0)) || strlen(options->cacheDir)+length+2 > sizeof(path)) continue;
+    sprintf(path, "%s/%s", options->cacheDir, item->d_name);
+    if(stat(path, &status) != 0) continue;
+    if(isTemporary == YES && now - status.st_mtime > STALE_TEMPORARY) {
+      remove(path);
+      continue;
+    }
+    /* Like storing, eviction is best effort, without memory it works on the files listed so far */
+    if(count == capacity) {
+      cacheFile* grown = (cacheFile*) realloc(files, (capacity == 0 ? 256 : capacity*2)*sizeof(cacheFile));
+      if(grown == NULL) break;
+      files = grown;
+      capacity = capacity == 0 ? 256 : capacity*2;
+    }
+    if((files[count].name = (char*) malloc(length+1)) == NULL) break;
+    strcpy(files[count].name, item->d_name);
+    files[count].size = (long) status.st_size;
+    files[count].used = status.st_mtime;
+    files[count].isTemporary = isTemporary;
+    total += files[count++].size;
+  }
+  closedir(directory);
+
+  /* Oldest first */
+  if(total > options->cacheBudget) qsort(files, count, sizeof(cacheFile), compare_cache_files);
+  for(i = 0; i < count; i++) {
+    if(total > options->cacheBudget && files[i].isTemporary == NO) {
+      sprintf(path, "%s/%s", options->cacheDir, files[i].name);
+      if(remove(path) == 0) total -= files[i].size;
+    }
+    free(files[i].name);
+  }
+  free(files);
+}
+
+/******************************************************
+ * Function: cache_path
+ * Description: Builds the name of the cache entry of a file.
+ *
+ * @param ctx: Context of the file.
+ * @param source: The content of the .as file.
+ * @return: The name of the entry, owned by the arena of the file.
+ ******************************************************/
+char* cache_path(assemblerContext* ctx, textBuffer* source) {
+  char* path = (char*) arena_alloc(&ctx->memory, strlen(ctx->options->cacheDir)+32);
+  unsigned long key = hash_text(source->text, (int) source->length);
+
+  key = key*31 ^ hash_name(ctx->fileName);
+  key = key*31 ^ hash_name(ASSEMBLER_VERSION);
+  key = key*31 ^ (unsigned long) ctx->options->format; /*The format changes the output files*/
+  key = key*31 ^ (unsigned long) ctx->options->optimize; /*And so does the optimizer*/
+  sprintf(path, "%s/%016lx.cache", ctx->options->cacheDir, key);
+  return path;
+}
+
+/******************************************************
+ * Function: read_file
+ * Description: Reads a whole file into a text buffer.
+ *
+ * @param fileName: Name of the file.
+ * @param buffer: Pointer to the text buffer.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int read_file(char* fileName, textBuffer* buffer) {
+  FILE* file = fopen(fileName, "r");
+
+  if(file == NULL) return YES;
+  read_text(buffer, file);
+  fclose(file);
+  return NO;
+}
+
+/******************************************************
+ * Function: write_changed
+ * Description: Writes a file unless it already holds the same text,
+ *		so an unchanged output keeps its time stamp and is not written again.
+ *
+ * @param ctx: Context of the file, its arena holds the old content.
+ * @param fileName: Name of the file.
+ * @param text: The content of the file.
+ * @param length: Length of the content.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int write_changed(assemblerContext* ctx, char* fileName, char* text, long length) {
+  textBuffer old;
+  FILE* file;
+
+  init_text_buffer(&old, &ctx->memory);
+  if(read_file(fileName, &old) == NO && old.length == (size_t) length && memcmp(old.text, text, length) == 0) return NO;
+  if((file = fopen(fileName, "w")) == NULL) return YES;
+  fwrite(text, 1, length, file);
+  fclose(file);
+  ADD_STAT(ctx, bytesWritten, length);
+  return NO;
+}
+
+/******************************************************
+ * Function: compare_cache_files
+ * Description: Orders the files of the cache directory from the least recently used.
+ *
+ * @param a: Pointer to the first file.
+ * @param b: Pointer to the second file.
+ * @return: Negative, zero or positive like strcmp.
+ ******************************************************/
+int compare_cache_files(const void* a, const void* b) {
+  const cacheFile* first = (const cacheFile*) a;
+  const cacheFile* second = (const cacheFile*) b;
+  if(first->used != second->used) return first->used < second->used ? -1 : 1;
+  return strcmp(first->name, second->name);
+}
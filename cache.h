@@ -0,0 +1,34 @@
+/******************************************************
+ * Function: init_cache
+ * Description: Creates the cache directory if it does not exist yet.
+ *
+ * @param options: Command-line options, with the cache directory.
+ ******************************************************/
+void init_cache(assemblerOptions* options);
+/******************************************************
+ * Function: restore_cached
+ * Description: Restores the output files and the diagnostics of a file from its cache entry.
+ *
+ * @param ctx: Context of the file.
+ * @param source: The content of the .as file.
+ * @return: YES if the entry was found and restored, NO otherwise.
+ ******************************************************/
+int restore_cached(assemblerContext* ctx, textBuffer* source);
+/******************************************************
+ * Function: store_cached
+ * Description: Writes the cache entry of a file that was just assembled.
+ *		Failures are ignored, the file is assembled again next time.
+ *
+ * @param ctx: Context of the file, with the content of its output files.
+ * @param source: The content of the .as file.
+ * @param am: The expanded source.
+ * @param reportStart: Where the diagnostics of the file start in the report.
+ ******************************************************/
+void store_cached(assemblerContext* ctx, textBuffer* source, textBuffer* am, size_t reportStart);
+/******************************************************
+ * Function: evict_cache
+ * Description: Removes the least recently used entries until the cache directory fits its budget.
+ *
+ * @param options: Command-line options, with the cache directory and its budget.
+ ******************************************************/
+void evict_cache(assemblerOptions* options);
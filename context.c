@@ -0,0 +1,134 @@
+/******************************************************
+ * File: context.c
+ * Description: This file manages the state of a single
+ *              assembled file. The counters of the passes
+ *              and the diagnostics live here instead of in
+ *              globals, so files can be assembled on
+ *              several threads. Diagnostics are buffered
+ *              and printed once the file is done, in the
+ *              order the files were given.
+ ******************************************************/
+
+#include "universal.h"
+#include "arena.h"
+#include "textBuffer.h"
+
+#define REPORT_LINE 1024 /*Longest single diagnostic (lines and names are bounded by BUFFER)*/
+
+void append_report(assemblerContext* ctx, char* text, size_t length);
+char* file_path(assemblerContext* ctx, const char* extension);
+
+const char* outputExtensions[OUTPUTS] = {".ob", ".ent", ".ext", ".bin"}; /*In the order of the OUTPUT_ indexes*/
+
+/******************************************************
+ * Function: init_context
+ * Description: Initializes the context of a file before its assembly.
+ *
+ * @param ctx: Pointer to the context to initialize.
+ * @param fileName: Name of the file without its extension.
+ * @param options: Command-line options of the run.
+ ******************************************************/
+void init_context(assemblerContext* ctx, char* fileName, assemblerOptions* options) {
+  int i;
+
+  ctx->fileName = fileName;
+  ctx->directory = NULL;
+  ctx->options = options;
+  ctx->IC = 0;
+  ctx->DC = 0;
+  ctx->lineCounterAs = 1;
+  ctx->lineCounterAm = 1;
+  ctx->isStored = NO;
+  ctx->stats = NULL;
+  ctx->result = NULL;
+  init_arena(&ctx->memory);
+  for(i = 0; i < OUTPUTS; i++) init_text_buffer(&ctx->output[i], &ctx->memory);
+  ctx->report = NULL;
+  ctx->reportLength = 0;
+  ctx->reportCapacity = 0;
+}
+
+/******************************************************
+ * Function: report
+ * Description: Appends a diagnostic to the report of the file, in printf format.
+ *
+ * @param ctx: Pointer to the context of the file.
+ * @param format: printf format of the diagnostic, followed by its arguments.
+ ******************************************************/
+void report(assemblerContext* ctx, const char* format, ...) {
+  char line[REPORT_LINE];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(line, REPORT_LINE, format, args);
+  va_end(args);
+  append_report(ctx, line, strlen(line));
+}
+
+/******************************************************
+ * Function: append_report
+ * Description: Appends text that is already formatted to the report of the file.
+ *
+ * @param ctx: Pointer to the context of the file.
+ * @param text: The text, it does not have to be null terminated.
+ * @param length: Length of the text.
+ ******************************************************/
+void append_report(assemblerContext* ctx, char* text, size_t length) {
+  /* Double the capacity when the report is full */
+  if(ctx->reportLength + length + 1 > ctx->reportCapacity) {
+    size_t capacity = ctx->reportCapacity == 0 ? REPORT_LINE : ctx->reportCapacity;
+    char* buffer;
+    while(ctx->reportLength + length + 1 > capacity) capacity *= 2;
+    if((buffer = (char*) realloc(ctx->report, capacity)) == NULL) out_of_memory(&ctx->memory);
+    ctx->report = buffer;
+    ctx->reportCapacity = capacity;
+  }
+  memcpy(ctx->report + ctx->reportLength, text, length);
+  ctx->reportLength += length;
+  ctx->report[ctx->reportLength] = '\0';
+}
+
+/******************************************************
+ * Function: flush_report
+ * Description: Prints the diagnostics of the file and frees them.
+ *
+ * @param ctx: Pointer to the context of the file.
+ ******************************************************/
+void flush_report(assemblerContext* ctx) {
+  if(ctx->reportLength > 0) fwrite(ctx->report, 1, ctx->reportLength, stdout);
+  free(ctx->report);
+  ctx->report = NULL;
+  ctx->reportLength = 0;
+  ctx->reportCapacity = 0;
+}
+
+/******************************************************
+ * Function: file_path
+ * Description: Builds the path of a file of the context, in its directory.
+ *
+ * @param ctx: Pointer to the context of the file.
+ * @param extension: The extension of the file, with its dot.
+ * @return: The path, owned by the arena of the file.
+ ******************************************************/
+char* file_path(assemblerContext* ctx, const char* extension) {
+  size_t length = strlen(ctx->fileName) + strlen(extension) + 1;
+  char* path;
+
+  if(ctx->directory != NULL && ctx->fileName[0] != '/') length += strlen(ctx->directory) + 1;
+  path = (char*) arena_alloc(&ctx->memory, length);
+  if(ctx->directory != NULL && ctx->fileName[0] != '/') sprintf(path, "%s/%s%s", ctx->directory, ctx->fileName, extension);
+  else sprintf(path, "%s%s", ctx->fileName, extension);
+  return path;
+}
+
+/******************************************************
+ * Function: output_file
+ * Description: Builds the path of an output file of the context.
+ *
+ * @param ctx: Pointer to the context of the file.
+ * @param output: The OUTPUT_ index of the file.
+ * @return: The path, owned by the arena of the file.
+ ******************************************************/
+char* output_file(assemblerContext* ctx, int output) {
+  return file_path(ctx, outputExtensions[output]);
+}
@@ -0,0 +1,51 @@
+/******************************************************
+ * Function: init_context
+ * Description: Initializes the context of a file before its assembly.
+ *
+ * @param ctx: Pointer to the context to initialize.
+ * @param fileName: Name of the file without its extension.
+ * @param options: Command-line options of the run.
+ ******************************************************/
+void init_context(assemblerContext* ctx, char* fileName, assemblerOptions* options);
+/******************************************************
+ * Function: report
+ * Description: Appends a diagnostic to the report of the file, in printf format.
+ *
+ * @param ctx: Pointer to the context of the file.
+ * @param format: printf format of the diagnostic, followed by its arguments.
+ ******************************************************/
+void report(assemblerContext* ctx, const char* format, ...);
+/******************************************************
+ * Function: append_report
+ * Description: Appends text that is already formatted to the report of the file.
+ *
+ * @param ctx: Pointer to the context of the file.
+ * @param text: The text, it does not have to be null terminated.
+ * @param length: Length of the text.
+ ******************************************************/
+void append_report(assemblerContext* ctx, char* text, size_t length);
+/******************************************************
+ * Function: flush_report
+ * Description: Prints the diagnostics of the file and frees them.
+ *
+ * @param ctx: Pointer to the context of the file.
+ ******************************************************/
+void flush_report(assemblerContext* ctx);
+/******************************************************
+ * Function: file_path
+ * Description: Builds the path of a file of the context, in its directory.
+ *
+ * @param ctx: Pointer to the context of the file.
+ * @param extension: The extension of the file, with its dot.
+ * @return: The path, owned by the arena of the file.
+ ******************************************************/
+char* file_path(assemblerContext* ctx, const char* extension);
+/******************************************************
+ * Function: output_file
+ * Description: Builds the path of an output file of the context.
+ *
+ * @param ctx: Pointer to the context of the file.
+ * @param output: The OUTPUT_ index of the file.
+ * @return: The path, owned by the arena of the file.
+ ******************************************************/
+char* output_file(assemblerContext* ctx, int output);
@@ -6,24 +6,15 @@
  * @return YES if the string represents a number, NO otherwise.
  ******************************************************/
 int is_number(char* input);
-/******************************************************
- * Function: is_label
- * Description: Checks if a string represents a label.
- * 
- * @param line: The input string to check.
- * @param h: Pointer to the symbol table.
- * @return Pointer to the label node if found, NULL otherwise.
- ******************************************************/
-ptrLabel is_label(char* line, ptrLabel h);
 /******************************************************
  * Function: is_ext_ent
  * Description: Checks if a string represents an external entry.
  * 
  * @param line: The input string to check.
- * @param h: Pointer to the external entry table.
+ * @param list: Pointer to the external entry table.
  * @return Pointer to the external entry node if found, NULL otherwise.
  ******************************************************/
-ptrExtEnt is_ext_ent(char* line, ptrExtEnt h);
+ptrExtEnt is_ext_ent(char* line, extEntList* list);
 /******************************************************
  * Function: is_valid_word
  * Description: Checks if a string represents a valid word.
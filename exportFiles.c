@@ -7,192 +7,311 @@
  ******************************************************/
 
 #include "universal.h"
+#include "context.h"
+#include "textBuffer.h"
+#include "arena.h"
+#include "symbolTable.h"
 
-char* encrypt(char* input);
-void freeDataImg(ptrDataImg * hptr);
-void freeCodeImg(ptrCodeImg * hptr);
-void freeExtEnt(ptrExtEnt * hptr);
+#define OB_HEADER 32 /*Room for the IC and DC line of an .ob file*/
+#define OB_LINE 13 /*Length of an .ob line: newline, address, space and word*/
+
+void export_binary(wordImage* dataImg, codeImage* codeImg, extEntList* extEnt, assemblerContext* ctx);
+char* object_words(assemblerContext* ctx, int count);
+void write_object_words(char* words, machineWord* image, int first, int count);
+void export_symbols(extEntList* extEnt, assemblerContext* ctx);
+char* write_words(char* output, machineWord* words, int count, int address);
+char* put_binary(char* output, unsigned long value, int bytes);
+void write_address(char* output, int address);
+
+/* The base 4 characters of every machine word, ENCRYPTED_WORD per word without a null terminator */
+char encryptedWords[(WORD_MASK+1)*ENCRYPTED_WORD];
+
+/******************************************************
+ * Function: init_encryption
+ * Description: Fills the table of the base 4 characters of every machine word.
+ *		Called once before any file is assembled.
+ ******************************************************/
+void init_encryption(void) {
+  const char* digits = "*#%!"; /* 00, 01, 10 and 11 */
+  int word, i;
+  for(word = 0; word <= WORD_MASK; word++)
+    for(i = 0; i < ENCRYPTED_WORD; i++) encryptedWords[word*ENCRYPTED_WORD+i] = digits[(word >> (WORD_BITS-2-2*i)) & 3];
+}
 
 /******************************************************
  * Function: export_files
- * Description: Exports data and code segments, as well as external and entry symbols, to output files.
+ * Description: Exports data and code segments, as well as external and entry symbols,
+ *		to the output files of the context.
  * 
- * @param headDataImg: Pointer to the head of the data image linked list.
- * @param headCodeImg: Pointer to the head of the code image linked list.
- * @param headExtEnt: Pointer to the head of the external/entry symbol linked list.
- * @param fileName: Name of the output file.
- * @param IC: Instruction counter.
- * @param DC: Data counter.
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
+ * @param extEnt: Pointer to the external/entry symbol list, sorted by address.
+ * @param ctx: Context of the file, holding the final IC and DC.
  ******************************************************/
-void export_files(ptrDataImg *headDataImg, ptrCodeImg *headCodeImg, ptrExtEnt *headExtEnt, char* fileName, int IC, int DC) {
-  FILE* ob;
-  FILE* ext = NULL;
-  FILE* ent = NULL;
-  int lineCounter = 100;
-  int isExt = NO;
-  int isEnt = NO;
-  ptrExtEnt pointerExtEnt = (*headExtEnt);
-  ptrCodeImg pointerCodeImg = (*headCodeImg);
-  ptrDataImg pointerDataImg = (*headDataImg);
-  char* fileNameExt = calloc(strlen(fileName)+2, sizeof(char));
-  
-  /* Create file names for external and entry files */
-  strcpy(fileNameExt, fileName);
-  fileName[strlen(fileName)-2] = 'o';
-  fileName[strlen(fileName)-1] = 'b';
-  fileNameExt[strlen(fileNameExt)-2] = 'e';
-  fileNameExt[strlen(fileNameExt)-1] = 'x'; 
-  fileNameExt[strlen(fileNameExt)] = 't';
-  fileNameExt[strlen(fileNameExt)+1] = '\0';
-  ob = fopen(fileName, "w");  /* Open output file */
-  
-  fprintf(ob, "  %d %d\n", IC, DC); /* Write IC and DC to output file */
-  /* Write code segment to output file */
-  if(pointerCodeImg) fprintf(ob, "%04d ", lineCounter);
-  while(pointerCodeImg) {
-    int i;
-    char chars[3]; /* Array to hold binary data */
-    chars[2] = '\0';
-    for(i = 0;i<strlen(pointerCodeImg->output);i++) {
-      if(pointerCodeImg->output[i] == '\n') {
-        lineCounter++;
-        fprintf(ob, "\n%04d ", lineCounter);
-        continue;
-      }
-      chars[0] = pointerCodeImg->output[i];
-      chars[1] = pointerCodeImg->output[i+1];
-      fprintf(ob, "%s", encrypt(chars));
-      i++;
-    }
-    pointerCodeImg = pointerCodeImg->next;
-    lineCounter++;
-    if(pointerCodeImg!=NULL) fprintf(ob, "\n%04d ", lineCounter);
+void export_files(wordImage* dataImg, codeImage* codeImg, extEntList* extEnt, assemblerContext* ctx) {
+  char* words;
+
+  if(ctx->options->format == FORMAT_BIN) {
+    export_binary(dataImg, codeImg, extEnt, ctx);
+    return;
   }
   
-  /* Write data image to output file */
-  if(pointerDataImg) fprintf(ob, "\n%04d ", lineCounter);
-  while(pointerDataImg) {
-    int i;
-    char chars[3]; /* Array to hold binary data */
-    chars[2] = '\0';
-    for(i = 0;i<strlen(pointerDataImg->output);i++) {
-      if(pointerDataImg->output[i] == '\n') {
-        lineCounter++;
-        fprintf(ob, "\n%04d ", lineCounter);
-        continue;
-      }
-      chars[0] = pointerDataImg->output[i];
-      chars[1] = pointerDataImg->output[i+1];
-      fprintf(ob, "%s", encrypt(chars));
-      i++;
-    }
-    pointerDataImg = pointerDataImg->next;
-    if(pointerDataImg!=NULL) {
-      lineCounter++;
-      fprintf(ob, "\n%04d ", lineCounter);
-    }
+  /* Write the code image followed by the data image, a line per word */
+  words = object_words(ctx, codeImg->words.count + dataImg->count);
+  write_object_words(words, codeImg->words.words, 0, codeImg->words.count);
+  write_object_words(words, dataImg->words, codeImg->words.count, dataImg->count);
+  export_symbols(extEnt, ctx);
+}
+
+/******************************************************
+ * Function: object_words
+ * Description: Makes room for the whole .ob file of the context and writes its IC and DC line.
+ *		The lines of the words are written with write_object_words, in any order.
+ * 
+ * @param ctx: Context of the file, holding the final IC and DC.
+ * @param count: Number of words of the file.
+ * @return: Where the lines of the words start.
+ ******************************************************/
+char* object_words(assemblerContext* ctx, int count) {
+  textBuffer* ob = &ctx->output[OUTPUT_OB];
+  char* start = reserve_text(ob, OB_HEADER + (size_t) count*OB_LINE); /* The whole .ob file */
+  int header = sprintf(start, "  %d %d\n", ctx->IC, ctx->DC);
+
+  ob->length += header + (count > 0 ? (size_t) count*OB_LINE-1 : 0); /* The first line has no newline before it */
+  return start + header;
+}
+
+/******************************************************
+ * Function: write_object_words
+ * Description: Writes the .ob lines of consecutive words where they belong in the file.
+ * 
+ * @param words: Where the lines of the words start, as returned by object_words.
+ * @param image: The words.
+ * @param first: Index of the first of them among the words of the file.
+ * @param count: Number of words.
+ ******************************************************/
+void write_object_words(char* words, machineWord* image, int first, int count) {
+  write_words(words + (first > 0 ? (size_t) first*OB_LINE-1 : 0), image, count, FIRST_ADDRESS+first);
+}
+
+/******************************************************
+ * Function: export_symbols
+ * Description: Writes the external and entry symbols to the .ext and .ent files of the context.
+ * 
+ * @param extEnt: Pointer to the external/entry symbol list, sorted by address.
+ * @param ctx: Context of the file.
+ ******************************************************/
+void export_symbols(extEntList* extEnt, assemblerContext* ctx) {
+  char line[BUFFER*2];
+  int i;
+
+  for(i = 0; i < extEnt->count; i++) {
+    sprintf(line, "%-8s %04d\n", extEnt->items[i].varName, extEnt->items[i].lineNum);
+    append_text(&ctx->output[extEnt->items[i].type == EXTERNAL ? OUTPUT_EXT : OUTPUT_ENT], line, strlen(line));
   }
-  
-  /* Create external and entry files */
-  while(pointerExtEnt) {
-    if(pointerExtEnt->type == EXTERNAL && isExt == NO) {
-      fileNameExt[strlen(fileNameExt)-2] = 'x';
-      ext = fopen(fileNameExt, "w");
-      isExt = YES;
-    }
-    if(pointerExtEnt->type == ENTRY && isEnt == NO) {
-      fileNameExt[strlen(fileNameExt)-2] = 'n';
-      ent = fopen(fileNameExt, "w");
-      isEnt = YES;
+}
+
+/******************************************************
+ * Function: export_binary
+ * Description: Exports the file in the binary format (--format=bin): the header,
+ *		the code and data words with their ARE bits, the entries as symbols,
+ *		the uses of externals as relocations and the table of their names.
+ *		Every section is 4-aligned so a loader can map the file and use it in place.
+ * 
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
+ * @param extEnt: Pointer to the external/entry symbol list, sorted by address.
+ * @param ctx: Context of the file.
+ ******************************************************/
+void export_binary(wordImage* dataImg, codeImage* codeImg, extEntList* extEnt, assemblerContext* ctx) {
+  textBuffer* bin = &ctx->output[OUTPUT_BIN];
+  symbolTable names; /*Offset of every name in the table of names, each name is stored once*/
+  textBuffer strings;
+  unsigned long offsets[5]; /*Code, data, symbols, relocations and names*/
+  int entries = 0;
+  int symbols = 0;
+  int relocations = 0;
+  char* start;
+  char* p;
+  int i;
+
+  /* The names come first, the symbols point into them */
+  init_symbol_table(&names, &ctx->memory);
+  init_text_buffer(&strings, &ctx->memory);
+  for(i = 0; i < extEnt->count; i++) {
+    if(extEnt->items[i].type == ENTRY) entries++;
+    if(is_label(extEnt->items[i].varName, &names) == NULL) {
+      add_symbol(&names, extEnt->items[i].varName, extEnt->items[i].type, (int) strings.length);
+      append_text(&strings, extEnt->items[i].varName, strlen(extEnt->items[i].varName)+1);
     }
-    if(isExt == YES && isEnt == YES) break;
-    pointerExtEnt = pointerExtEnt->next;
   }
-  
-  pointerExtEnt = (*headExtEnt);
-  
-  /* Write external and entry symbols to respective files */
-  while(pointerExtEnt) {
-    if(pointerExtEnt->type == EXTERNAL) fprintf(ext, "%-8s %04d\n", pointerExtEnt->varName, pointerExtEnt->lineNum);
-    if(pointerExtEnt->type == ENTRY) fprintf(ent, "%-8s %04d\n", pointerExtEnt->varName, pointerExtEnt->lineNum);
-    pointerExtEnt = pointerExtEnt->next;
+
+  offsets[0] = BIN_HEADER;
+  offsets[1] = (offsets[0] + codeImg->words.count*2 + 3) & ~3UL;
+  offsets[2] = (offsets[1] + dataImg->count*2 + 3) & ~3UL;
+  offsets[3] = offsets[2] + (unsigned long) entries*BIN_SYMBOL;
+  offsets[4] = offsets[3] + (unsigned long) (extEnt->count-entries)*BIN_SYMBOL;
+  start = reserve_text(bin, offsets[4] + strings.length);
+  memset(start, 0, offsets[4] + strings.length); /* The padding */
+
+  memcpy(start, BIN_MAGIC, 4);
+  p = put_binary(start+4, BIN_VERSION, 2);
+  p = put_binary(p, BIN_HEADER, 2);
+  p = put_binary(p, codeImg->words.count, 2);
+  p = put_binary(p, dataImg->count, 2);
+  p = put_binary(p, offsets[0], 4);
+  p = put_binary(p, offsets[1], 4);
+  p = put_binary(p, offsets[2], 4);
+  p = put_binary(p, entries, 4);
+  p = put_binary(p, offsets[3], 4);
+  p = put_binary(p, extEnt->count-entries, 4);
+  p = put_binary(p, offsets[4], 4);
+  put_binary(p, strings.length, 4);
+
+  for(i = 0, p = start+offsets[0]; i < codeImg->words.count; i++) p = put_binary(p, codeImg->words.words[i], 2);
+  for(i = 0, p = start+offsets[1]; i < dataImg->count; i++) p = put_binary(p, dataImg->words[i], 2);
+
+  /* The list is sorted by address, so are both tables */
+  for(i = 0; i < extEnt->count; i++) {
+    itemExtEnt* item = &extEnt->items[i];
+    if(item->type == ENTRY) p = start + offsets[2] + (unsigned long) symbols++*BIN_SYMBOL;
+    else p = start + offsets[3] + (unsigned long) relocations++*BIN_SYMBOL;
+    p = put_binary(p, (unsigned long) is_label(item->varName, &names)->data, 4);
+    p = put_binary(p, item->lineNum, 2);
+    put_binary(p, item->type == ENTRY ? ARE_RELOCATABLE : ARE_EXTERNAL, 2);
   }
-  
-  /* Free linked lists and close files*/
-  fclose(ob);
-  fclose(ext);
-  fclose(ent);
-  free(fileNameExt);
-  freeDataImg(headDataImg);
-  freeCodeImg(headCodeImg);
-  freeExtEnt(headExtEnt);
+  if(strings.length > 0) memcpy(start+offsets[4], strings.text, strings.length);
+  bin->length += offsets[4] + strings.length;
 }
 
 /******************************************************
- * Function: encrypt
- * Description: Converts binary strings to encrypted characters.
+ * Function: write_outputs
+ * Description: Writes the output files of the context that are not empty.
  * 
- * @param input: The binary string to encrypt.
- * @return The encrypted character representation of the binary string.
+ * @param ctx: Context of the file.
  ******************************************************/
-char* encrypt(char* input) {
-  if(strcmp(input, "00") == 0) return "*";
-  else if(strcmp(input, "01") == 0) return "#";
-  else if(strcmp(input, "10") == 0) return "%";
-  else if(strcmp(input, "11") == 0) return "!";
-  else return NULL;
+void write_outputs(assemblerContext* ctx) {
+  int i;
+
+  for(i = 0; i < OUTPUTS; i++) {
+    char* fileName;
+    if(ctx->output[i].length == 0) continue;
+    fileName = output_file(ctx, i);
+    if(write_text(&ctx->output[i], fileName) == YES) report(ctx, "\nFATAL ERROR: Cannot open file \"%s\"\n", fileName);
+    else ADD_STAT(ctx, bytesWritten, (long) ctx->output[i].length);
+  }
 }
 
 /******************************************************
- * Function: freeDataImg
- * Description: Frees memory allocated for data image nodes and their content.
+ * Function: export_result
+ * Description: Copies the code and data images and the external and entry symbols
+ *		into the result of the library, instead of the output files.
  * 
- * @param hptr: Pointer to the head of the data image linked list.
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
+ * @param extEnt: Pointer to the external/entry symbol list, sorted by address.
+ * @param result: The result, its arena owns the copies.
  ******************************************************/
-void freeDataImg(ptrDataImg * hptr) {
-  ptrDataImg p;
-  
-  /* Parse the linked list and free each node and its content */
-  while(*hptr) { 
-    p = *hptr;
-    *hptr = (*hptr)->next;
-    free(p->output); /* Free the output string */
-    free(p); /* Free the node */
+void export_result(wordImage* dataImg, codeImage* codeImg, extEntList* extEnt, asmResult* result) {
+  objectImage* image = &result->image;
+  int i;
+
+  image->IC = codeImg->words.count;
+  image->DC = dataImg->count;
+  image->words = (machineWord*) arena_alloc(&result->memory, (image->IC+image->DC+1)*sizeof(machineWord));
+  if(image->IC > 0) memcpy(image->words, codeImg->words.words, image->IC*sizeof(machineWord));
+  if(image->DC > 0) memcpy(image->words+image->IC, dataImg->words, image->DC*sizeof(machineWord));
+
+  /* Each table has room for the whole list */
+  result->entries = (asmSymbol*) arena_alloc(&result->memory, (extEnt->count+1)*sizeof(asmSymbol));
+  result->externals = (asmSymbol*) arena_alloc(&result->memory, (extEnt->count+1)*sizeof(asmSymbol));
+  for(i = 0; i < extEnt->count; i++) {
+    asmSymbol* symbol = extEnt->items[i].type == EXTERNAL ? &result->externals[result->externalCount++] : &result->entries[result->entryCount++];
+    symbol->name = arena_strdup(&result->memory, extEnt->items[i].varName);
+    symbol->address = extEnt->items[i].lineNum;
   }
+  result->isError = NO;
 }
 
 /******************************************************
- * Function: freeCodeImg
- * Description: Frees memory allocated for code image nodes and their content.
+ * Function: write_object
+ * Description: Writes an object image to an .ob file.
  * 
- * @param hptr: Pointer to the head of the code image linked list.
+ * @param fileName: Name of the .ob file.
+ * @param image: Pointer to the object image.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-void freeCodeImg(ptrCodeImg * hptr) {
-  ptrCodeImg p;
-  
-  /* Parse the linked list and free each node and its content */
-  while(*hptr) { 
-    p = *hptr;
-    *hptr = (*hptr)->next; 
-    free(p->output); /* Free the output string */
-    free(p); /* Free the node */
+int write_object(char* fileName, objectImage* image) {
+  char* text = (char*) malloc(OB_HEADER + (size_t) (image->IC+image->DC)*OB_LINE);
+  char* p = text;
+  FILE* ob;
+
+  if(text == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(1);
   }
+  if((ob = fopen(fileName, "w")) == NULL) {
+    free(text);
+    return YES;
+  }
+  p += sprintf(p, "  %d %d\n", image->IC, image->DC);
+  p = write_words(p, image->words, image->IC+image->DC, FIRST_ADDRESS);
+  fwrite(text, 1, p-text, ob);
+  fclose(ob);
+  free(text);
+  return NO;
 }
 
 /******************************************************
- * Function: freeExtEnt
- * Description: Frees memory allocated for external/entry symbol nodes and their content.
+ * Function: write_words
+ * Description: Writes the .ob lines of consecutive words, each line but the first of the file starts with a newline.
  * 
- * @param hptr: Pointer to the head of the external/entry symbol linked list.
+ * @param output: Where the lines are stored.
+ * @param words: The words.
+ * @param count: Number of words.
+ * @param address: Address of the first word.
+ * @return: The end of the lines.
  ******************************************************/
-void freeExtEnt(ptrExtEnt * hptr) {
-  ptrExtEnt p;
-  
-  /* Parse the linked list and free each node and its content */
-  while(*hptr) { 
-    p = *hptr;
-    *hptr = (*hptr)->next;
-    free(p->varName); /* Free the variable name string */
-    free(p); /* Free the node */
+char* write_words(char* output, machineWord* words, int count, int address) {
+  int i;
+
+  for(i = 0; i < count; i++, address++) {
+    if(address > FIRST_ADDRESS) *output++ = '\n';
+    write_address(output, address);
+    output += 4;
+    *output++ = ' ';
+    memcpy(output, &encryptedWords[(words[i] & WORD_MASK)*ENCRYPTED_WORD], ENCRYPTED_WORD);
+    output += ENCRYPTED_WORD;
   }
+  return output;
+}
+
+/******************************************************
+ * Function: write_address
+ * Description: Writes an address the way "%04d" formats it, without a null terminator.
+ *		Programs are at most MAX_PROGRAM words, so addresses have 4 digits.
+ * 
+ * @param output: Where the 4 digits are stored.
+ * @param address: The address.
+ ******************************************************/
+void write_address(char* output, int address) {
+  output[0] = '0' + address/1000;
+  output[1] = '0' + address/100%10;
+  output[2] = '0' + address/10%10;
+  output[3] = '0' + address%10;
+}
+
+/******************************************************
+ * Function: put_binary
+ * Description: Stores an unsigned number in little-endian order.
+ * 
+ * @param output: Where the number is stored.
+ * @param value: The number.
+ * @param bytes: Number of bytes it takes.
+ * @return: The end of the number.
+ ******************************************************/
+char* put_binary(char* output, unsigned long value, int bytes) {
+  int i;
+  for(i = 0; i < bytes; i++) output[i] = (char) ((value >> (8*i)) & 0xFF);
+  return output+bytes;
 }
@@ -1,12 +1,72 @@
+/******************************************************
+ * Function: init_encryption
+ * Description: Fills the table of the base 4 characters of every machine word.
+ *		Called once before any file is assembled.
+ ******************************************************/
+void init_encryption(void);
 /******************************************************
  * Function: export_files
- * Description: Exports data and code segments, as well as external and entry symbols, to output files.
+ * Description: Exports data and code segments, as well as external and entry symbols,
+ *		to the output files of the context.
+ * 
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
+ * @param extEnt: Pointer to the external/entry symbol list, sorted by address.
+ * @param ctx: Context of the file, holding the final IC and DC.
+ ******************************************************/
+void export_files(wordImage* dataImg, codeImage* codeImg, extEntList* extEnt, assemblerContext* ctx);
+/******************************************************
+ * Function: object_words
+ * Description: Makes room for the whole .ob file of the context and writes its IC and DC line.
+ *		The lines of the words are written with write_object_words, in any order.
+ * 
+ * @param ctx: Context of the file, holding the final IC and DC.
+ * @param count: Number of words of the file.
+ * @return: Where the lines of the words start.
+ ******************************************************/
+char* object_words(assemblerContext* ctx, int count);
+/******************************************************
+ * Function: write_object_words
+ * Description: Writes the .ob lines of consecutive words where they belong in the file.
+ * 
+ * @param words: Where the lines of the words start, as returned by object_words.
+ * @param image: The words.
+ * @param first: Index of the first of them among the words of the file.
+ * @param count: Number of words.
+ ******************************************************/
+void write_object_words(char* words, machineWord* image, int first, int count);
+/******************************************************
+ * Function: export_symbols
+ * Description: Writes the external and entry symbols to the .ext and .ent files of the context.
+ * 
+ * @param extEnt: Pointer to the external/entry symbol list, sorted by address.
+ * @param ctx: Context of the file.
+ ******************************************************/
+void export_symbols(extEntList* extEnt, assemblerContext* ctx);
+/******************************************************
+ * Function: write_outputs
+ * Description: Writes the output files of the context that are not empty.
+ * 
+ * @param ctx: Context of the file.
+ ******************************************************/
+void write_outputs(assemblerContext* ctx);
+/******************************************************
+ * Function: export_result
+ * Description: Copies the code and data images and the external and entry symbols
+ *		into the result of the library, instead of the output files.
+ * 
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
+ * @param extEnt: Pointer to the external/entry symbol list, sorted by address.
+ * @param result: The result, its arena owns the copies.
+ ******************************************************/
+void export_result(wordImage* dataImg, codeImage* codeImg, extEntList* extEnt, asmResult* result);
+/******************************************************
+ * Function: write_object
+ * Description: Writes an object image to an .ob file.
  * 
- * @param headDataImg: Pointer to the head of the data image linked list.
- * @param headCodeImg: Pointer to the head of the code image linked list.
- * @param headExtEnt: Pointer to the head of the external/entry symbol linked list.
- * @param fileName: Name of the output file.
- * @param IC: Instruction counter.
- * @param DC: Data counter.
+ * @param fileName: Name of the .ob file.
+ * @param image: Pointer to the object image.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-void export_files(ptrDataImg *headDataImg, ptrCodeImg *headCodeImg, ptrExtEnt *headExtEnt, char* fileName, int IC, int DC);
+int write_object(char* fileName, objectImage* image);
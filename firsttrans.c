@@ -11,333 +11,370 @@
 #include "operations.h"
 #include "addressingModes.h"
 #include "secondtrans.h"
+#include "optimize.h"
 #include "errorTreatment.h"
+#include "symbolTable.h"
+#include "wordImage.h"
+#include "context.h"
+#include "arena.h"
+#include "textBuffer.h"
+#include "lexer.h"
+#include "stats.h"
 
-int lineCounterAm = 1; /* Line counter for assembly file */
-int IC = 0; /*Instruction counter*/
-int DC = 0; /*Data counter*/
+#define INITIAL_EVENTS 64 /*Events of a chunk before the list first grows*/
 
-int translate_line(char* curLine, ptrLabel *headLabel, ptrDataImg *headDataImg, ptrCodeImg *headCodeImg, char* fileName);
-void define_label(ptrLabel **hptr, char* labelName, int labelType, int data);
-void build_data_image (ptrDataImg **hptr, int lineNum, int L, char* output);
-void build_code_image (ptrCodeImg **hptr, int lineNum, int opcode, int L, char* output);
-int translate_code_line (ptrCodeImg **hptr, int opcode, int lineNum, char* line, char* copyCurLine, char* fileName);
+extern const opcodeInfo opcodeTable[OPCODE]; /*Operands, modes, lengths and first words of the opcodes*/
+
+int translate_lines(textBuffer* am, symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, char* fileName, assemblerContext* ctx);
+int translate_line(char* curLine, int length, symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, char* fileName, assemblerContext* ctx);
+void define_label(symbolTable* symbols, char* labelName, int labelType, int data);
+void new_label(symbolTable* symbols, char* labelName, int labelType, int data);
+machineWord data_constant(symbolTable* symbols, char* name, int index);
+void record_event(symbolTable* symbols, int kind, char* name, int labelType, int data);
+int replay_events(symbolEventList* events, symbolTable* symbols, wordImage* dataImg, int codeBase, int dataBase);
+void place_data_labels(symbolTable* symbols, int IC);
+void build_data_image (wordImage* dataImg, machineWord* output, int L);
+void build_code_image (codeImage* codeImg, int lineNum, int opcode, int L, machineWord output);
+int translate_string(wordImage* dataImg, token* curArg, char* curLine, int length, char* fileName, assemblerContext* ctx);
+int translate_code_line (codeImage* codeImg, int opcode, int lineNum, token* line, char* curLine, int length, char* fileName, assemblerContext* ctx);
+void record_operands (codeImage* codeImg, int opcode, int lineNum, token* line, char* curLine, int length, assemblerContext* ctx);
+void record_operand (codeImage* codeImg, int mode, int slot, char* arg, char* curLine, int length, assemblerContext* ctx);
 
 /******************************************************
  * Function: firsttrans
  * Description: Performs the first pass of the translation process for the assembly file.
  * 
- * @param am: Pointer to the assembly file.
+ * @param am: Text buffer holding the expanded source.
  * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
  ******************************************************/
-void firsttrans(FILE* am, char* fileName) {
+void firsttrans(textBuffer* am, char* fileName, assemblerContext* ctx) {
 
-  ptrLabel headLabel = NULL;
-  ptrDataImg headDataImg = NULL;
-  ptrCodeImg headCodeImg = NULL;
-  char curLine[BUFFER];
-  int isError = NO; /* Flag for error detection */
-  ptrLabel p1;
+  symbolTable symbols;
+  wordImage dataImg;
+  codeImage codeImg;
+  int isError; /* Flag for error detection */
   
-  while(fgets(curLine, BUFFER-1, am) != NULL) { /*Parse the file line by line*/
-    if (curLine[strlen(curLine) - 1] != '\n') { /* Check for line length exceeding the maximum allowed */
-      printf("\nLine length exceeded maximum allowed length (80) in line %d (\"%s...\") in file \"%s\"\n", lineCounterAm, curLine, fileName);
-      isError = YES;
-      continue;
-    }
-    if(isError != YES) isError = translate_line(curLine, &headLabel, &headDataImg, &headCodeImg, fileName);
-    else translate_line(curLine, &headLabel, &headDataImg, &headCodeImg, fileName);
-    lineCounterAm++;
-    if(IC+DC>MAX_PROGRAM) isError = YES; /* Check if the program size exceeds the maximum limit */
+  SWITCH_PHASE(ctx, PHASE_FIRST);
+  init_symbol_table(&symbols, &ctx->memory);
+  init_word_image(&dataImg, &ctx->memory);
+  init_code_image(&codeImg, &ctx->memory);
+  isError = translate_lines(am, &symbols, &dataImg, &codeImg, fileName, ctx);
+  if(isError == NO && ctx->options->optimize != 0) {
+    if(ctx->options->optimize & OPTIMIZE_PEEPHOLE) optimize_code(&symbols, &codeImg, ctx);
+    if(ctx->options->optimize & OPTIMIZE_OUTLINE) outline_code(&symbols, &codeImg, ctx);
+    if(ctx->options->optimize & OPTIMIZE_DATA) merge_data(&symbols, &dataImg, &codeImg, ctx);
+    if(ctx->IC+ctx->DC > MAX_PROGRAM) isError = YES;
   }
   
   /* Check if errors were detected */
   if(isError == YES) {
-    printf("\nErrors detected in first transition, output files will not be created\n");
+    report(ctx, "\nErrors detected in first transition, output files will not be created\n");
+    if(ctx->stats != NULL) clear_savings(ctx->stats);
+    ADD_STAT(ctx, symbols, symbols.count);
+    ADD_STAT(ctx, labelLookups, symbols.lookups);
     return;
   }
   
-  /* Adjust labels' data values */
-  p1 = headLabel;
-  while(p1) {
-    if(p1->labelType != DEFINE && p1->labelType != CODE && p1->labelType != EXTERNAL) p1->data = p1->data + 100 + IC;
-    p1 = p1->next;
-  }
+  place_data_labels(&symbols, ctx->IC);
   
-  /* Reset file pointer and proceed to the second pass */
-  rewind(am);
-  secondtrans(am, &headLabel, &headDataImg, &headCodeImg, fileName, IC, DC);
+  /* Patch the recorded operands now that every label is known */
+  if(secondtrans(&symbols, &dataImg, &codeImg, fileName, ctx) == YES && ctx->stats != NULL) clear_savings(ctx->stats); /* Only a file that assembles saved words */
+  ADD_STAT(ctx, symbols, symbols.count);
+  ADD_STAT(ctx, labelLookups, symbols.lookups); /* Including the lookups of the second pass and the export */
+}
+
+/******************************************************
+ * Function: translate_lines
+ * Description: Translates the lines of the expanded source, or of a chunk of it,
+ *		into the symbol table and the images.
+ * 
+ * @param am: Text buffer holding the lines.
+ * @param symbols: Pointer to the symbol table.
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file, its counters start at the first line.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int translate_lines(textBuffer* am, symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, char* fileName, assemblerContext* ctx) {
+  char* curLine; /* Points into the expanded source */
+  int length;
+  int isError = NO;
+  
+  while((curLine = next_line(am, BUFFER-1, &length)) != NULL) { /*Parse the file line by line*/
+    ADD_STAT(ctx, lines[PHASE_FIRST], 1);
+    if (curLine[length - 1] != '\n') { /* Check for line length exceeding the maximum allowed */
+      report(ctx, "\nLine length exceeded maximum allowed length (80) in line %d (\"%.*s...\") in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
+      isError = YES;
+      continue;
+    }
+    if(isError != YES) isError = translate_line(curLine, length, symbols, dataImg, codeImg, fileName, ctx);
+    else translate_line(curLine, length, symbols, dataImg, codeImg, fileName, ctx);
+    ctx->lineCounterAm++;
+    /* Check if the program size exceeds the maximum limit, once optimized with -O */
+    if(ctx->options->optimize == 0 && ctx->IC+ctx->DC>MAX_PROGRAM) isError = YES;
+  }
+  return isError;
 }
 
 /******************************************************
  * Function: translate_line
  * Description: Translates a single line of code from the assembly file.
  * 
- * @param curLine: Current line of code.
- * @param headLabel: Pointer to the head of the label linked list.
- * @param headDataImg: Pointer to the head of the data image linked list.
- * @param headCodeImg: Pointer to the head of the code image linked list.
+ * @param curLine: Current line of code, with its newline and not null terminated.
+ * @param length: Length of the line.
+ * @param symbols: Pointer to the symbol table.
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
  * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
  * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-int translate_line(char* curLine, ptrLabel *headLabel, ptrDataImg *headDataImg, ptrCodeImg *headCodeImg, char* fileName) {
-  char* copyCurLine = malloc(strlen(curLine)+1);
-  char* curArg;
-  char* labelName = malloc(strlen(curLine)+1);
-  char* binaryLine = calloc(MAX_WORD, sizeof(char));
+int translate_line(char* curLine, int length, symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, char* fileName, assemblerContext* ctx) {
+  lexer lex;
+  token curArg;
+  token operands;
+  char argText[BUFFER]; /* The current token as a string */
+  char labelName[BUFFER];
+  machineWord lineWords[BUFFER]; /* Words of a .data or .string line */
   int isLabel = NO;
   int counter = 0;
   int opcode;
-  strcpy(copyCurLine, curLine);
-  curArg = strtok(curLine, "\040\t");
+  int word; /* Which reserved word the current token is (-1 if none) */
+  init_lexer(&lex, curLine, length);
+  if(next_token(&lex, LEX_SPACE, &curArg) == NO) return NO;
+  word = classify_word(curArg.start, curArg.length);
+  ADD_STAT(ctx, opcodeLookups, 1);
   
   /* Parse directives and handle accordingly */
-  if(strcmp(curArg, ".define")==0) {
-    int value;
-    char* valueStr;
-    labelName = strtok(NULL, "\040\t=\040\t"); /* Get the defined label name */
-    
+  if(word == WORD_DEFINE) {
+    token valueStr;
     /* Check for missing arguments */
-    if(labelName==NULL) {
-      printf("\nMissing arguments in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+    if(next_token(&lex, LEX_SPACE|LEX_EQUALS, &curArg) == NO) { /* Get the defined label name */
+      report(ctx, "\nMissing arguments in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
+    token_text(&curArg, labelName);
     /* Check for duplicate label definitions */
-    if(is_label(labelName, *headLabel)!=NULL) {
-      printf("\n\"%s\" is defined more than once in line %d: %s in file \"%s\"\n", labelName, lineCounterAm, copyCurLine, fileName);
+    if(is_label(labelName, symbols)!=NULL) {
+      report(ctx, "\n\"%s\" is defined more than once in line %d: %.*s in file \"%s\"\n", labelName, ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
     /* Check for label name length */
-    if(strlen(labelName) > MAX_LABEL) {
-      printf("\n\"%s\" is longer than %d characters in line %d: %s in file \"%s\"\n", labelName, MAX_LABEL-1, lineCounterAm, copyCurLine, fileName);
+    if(curArg.length > MAX_LABEL) {
+      report(ctx, "\n\"%s\" is longer than %d characters in line %d: %.*s in file \"%s\"\n", labelName, MAX_LABEL-1, ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
     /* Get the value assigned to the label */
-    valueStr = strtok(NULL,"=\040\t");
-    if(valueStr==NULL) {
-      printf("\nMissing arguments in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+    if(next_token(&lex, LEX_EQUALS|LEX_SPACE, &valueStr) == NO) {
+      report(ctx, "\nMissing arguments in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
-    if(valueStr[strlen(valueStr)-1]=='\n') valueStr[strlen(valueStr)-1]= '\0'; /* Remove newline character from value string */
+    drop_newline(&valueStr); /* Remove newline character from value string */
     /* Check if value is a valid number */
-    if(is_number(valueStr) == NO) {
-      printf("\n\"%s\" is not a real number in line %d: %s in file \"%s\"\n", valueStr, lineCounterAm, copyCurLine, fileName);
+    if(is_number(token_text(&valueStr, argText)) == NO) {
+      report(ctx, "\n\"%s\" is not a real number in line %d: %.*s in file \"%s\"\n", argText, ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
-    value = atoi(valueStr);
-    define_label(&headLabel, labelName, DEFINE, value);
+    new_label(symbols, labelName, DEFINE, atoi(argText));
     return NO;
   } 
   /* Handle label definition */
-  else if(curArg[strlen(curArg)-1] == ':') {
+  else if(curArg.kind == TOKEN_LABEL) {
     isLabel = YES;
-    strcpy(labelName, curArg);
-    labelName[strlen(labelName)-1] = '\0';
+    curArg.length--; /* Without the ':' */
+    token_text(&curArg, labelName);
     if(is_valid_word(labelName) == NO) { /* Check if label name is valid */
-      printf("\n\"%s\" is not a valid label name in line %d: %s in file \"%s\"\n", labelName, lineCounterAm, copyCurLine, fileName);
+      report(ctx, "\n\"%s\" is not a valid label name in line %d: %.*s in file \"%s\"\n", labelName, ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
     if(strlen(labelName) > MAX_LABEL) { /* Check for label name length */
-      printf("\n\"%s\" is longer than %d characters in line %d: %s in file \"%s\"\n", labelName, MAX_LABEL-1, lineCounterAm, copyCurLine, fileName);
+      report(ctx, "\n\"%s\" is longer than %d characters in line %d: %.*s in file \"%s\"\n", labelName, MAX_LABEL-1, ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
   }
   /* Handle .extern directive */
-  else if(strcmp(curArg, ".extern") == 0) {
-    while((curArg = strtok(NULL, "\040\t,\040\t")) != NULL) {
-      if(curArg[strlen(curArg)-1]=='\n') curArg[strlen(curArg)-1]= '\0';
-      define_label(&headLabel, curArg, EXTERNAL, 0);
+  else if(word == WORD_EXTERN) {
+    while(next_token(&lex, LEX_SPACE|LEX_COMMA, &curArg) == YES) {
+      drop_newline(&curArg);
+      define_label(symbols, token_text(&curArg, argText), EXTERNAL, 0);
     }
     return NO;
   }
   /* Handle .entry directive */
-  else if(strcmp(curArg, ".entry") == 0) {
+  else if(word == WORD_ENTRY) {
+    /* The label may be defined later, the second pass resolves it */
+    char* name = next_token(&lex, LEX_SPACE, &curArg) == YES ? token_text(&curArg, argText) : NULL;
+    add_fixup(&codeImg->fixups, ENTRY, -1, 0, ctx->lineCounterAm, name, curLine, length);
     return NO;
   }
   /* Handle .data directive */
-  else if (strcmp(curArg, ".data") == 0) {
+  else if (word == WORD_DATA) {
     ptrLabel label;
     if(isLabel==YES) {
-      define_label(&headLabel, labelName, DATA, DC);
+      define_label(symbols, labelName, DATA, ctx->DC);
     }
-    if((curArg = strtok(NULL, "\040\t,\040\t")) == NULL) {
-      printf("\nMissing arguments in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+    if(next_token(&lex, LEX_SPACE|LEX_COMMA, &curArg) == NO) {
+      report(ctx, "\nMissing arguments in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
-    while(curArg != NULL) {
-      if(curArg[strlen(curArg)-1]=='\n') curArg[strlen(curArg)-1]= '\0';
-      counter++;
-      binaryLine = realloc(binaryLine, (MAX_WORD+1)*counter);
-      if(is_number(curArg) == YES) strcat(binaryLine, decimalToBinary(atoi(curArg)));
-      else if((label = is_label(curArg, *headLabel)) != NULL && label->labelType == DEFINE) strcat(binaryLine, decimalToBinary(label->data));
+    do {
+      drop_newline(&curArg);
+      token_text(&curArg, argText);
+      if(is_number(argText) == YES) lineWords[counter++] = decimalToBinary(atoi(argText));
+      else if((label = is_label(argText, symbols)) != NULL && label->labelType == DEFINE) lineWords[counter++] = decimalToBinary(label->data);
+      else if(label == NULL && symbols->events != NULL) { /* May be defined by an earlier chunk */
+        lineWords[counter] = data_constant(symbols, argText, ctx->DC+counter);
+        counter++;
+      }
       else {
-        printf("\n\"%s\" is neither a number nor a symbol(.define value) in line %d: %s in file \"%s\"\n", curArg, lineCounterAm, copyCurLine, fileName);
+        report(ctx, "\n\"%s\" is neither a number nor a symbol(.define value) in line %d: %.*s in file \"%s\"\n", argText, ctx->lineCounterAm, length, curLine, fileName);
         return YES;
       }
-      if((curArg = strtok(NULL, "\040\t,\040\t")) != NULL) strcat(binaryLine, "\n");
-    }
-    build_data_image(&headDataImg, DC, counter, binaryLine);
-    DC+=counter;
+    } while(next_token(&lex, LEX_SPACE|LEX_COMMA, &curArg) == YES);
+    build_data_image(dataImg, lineWords, counter);
+    ctx->DC+=counter;
     return NO;
   }
   /* Handle .string directive */
-  else if (strcmp(curArg, ".string") == 0) {
-    int i;
-    char* str;
-    curArg = strtok(NULL, "\040\t");
-    if(curArg==NULL) {
-      printf("\nMissing arguments in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+  else if (word == WORD_STRING) {
+    if(next_token(&lex, LEX_SPACE, &curArg) == NO) {
+      report(ctx, "\nMissing arguments in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
     if(isLabel==YES) {
-      define_label(&headLabel, labelName, DATA, DC);
-    }
-    str = strchr(curArg, '\"');
-    if(str[strlen(str)-2] != '\"') {
-      printf("\nExtranous text after \" in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
-      return YES;
+      define_label(symbols, labelName, DATA, ctx->DC);
     }
-    i = 1;
-    while(i<strlen(str)-2) {
-      counter++;
-      if(str[i] == '\n') break;
-      if(isprint(str[i]) == 0) {
-        printf("\nCannot print\"%c\" (illegal character) in line %d: %s in file \"%s\"\n", str[i], lineCounterAm, copyCurLine, fileName);
-        return YES;
-      }
-      binaryLine = realloc(binaryLine, (MAX_WORD+1)*counter);
-      strcat(binaryLine, decimalToBinary(str[i]));
-      i++;
-      strcat(binaryLine, "\n");
-    }
-    counter++;
-    binaryLine = realloc(binaryLine, (MAX_WORD+1)*counter);
-    strcat(binaryLine, decimalToBinary(0));
-    build_data_image(&headDataImg, DC, counter, binaryLine);
-    DC+=counter;
-    return NO;
+    return translate_string(dataImg, &curArg, curLine, length, fileName, ctx);
   }
   /* Handle other arguments */
-  else if ((opcode = detect_opcode(curArg)) != -1) {
-    if(curArg[strlen(curArg)-1]=='\n') curArg[strlen(curArg)-1]= '\0'; /* Remove newline character if present */
-    if((opcode = detect_opcode(curArg)) == -1) { /* If not a valid opcode */
-      printf("\n\"%s\" is not a legal operation in line %d: %s in file \"%s\"\n", curArg, lineCounterAm, copyCurLine, fileName);
-      return YES;
-    }
-    curArg = strtok(NULL, "\0");
-    translate_code_line(&headCodeImg, opcode, IC, curArg, copyCurLine, fileName); /* Translate the code line with the detected opcode */
+  else if (word != -1 && word < OPCODE) {
+    translate_code_line(codeImg, word, ctx->IC, next_token(&lex, LEX_REST, &operands) == YES ? &operands : NULL, curLine, length, fileName, ctx); /* Translate the code line with the detected opcode */
     return NO;
   }
   
-  curArg = strtok(NULL, "\040\t");
-  if(curArg==NULL) return NO; /* If no more arguments, return */
-  else if(strcmp(curArg, ".define")==0) {
+  if(next_token(&lex, LEX_SPACE, &curArg) == NO) return NO; /* If no more arguments, return */
+  word = classify_word(curArg.start, curArg.length);
+  ADD_STAT(ctx, opcodeLookups, 1);
+  if(word == WORD_DEFINE) {
     /* Error: illegal label definition */
-    printf("\nIllegal label defenition in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+    report(ctx, "\nIllegal label defenition in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
     return YES;
   }
-  else if (strcmp(curArg, ".data") == 0) {
+  else if (word == WORD_DATA) {
     ptrLabel label;
     if(isLabel==YES) {
-      define_label(&headLabel, labelName, DATA, DC); /* Define a label for data section */
+      define_label(symbols, labelName, DATA, ctx->DC); /* Define a label for data section */
     }
     /* Error: missing arguments for .data directive */
-    if((curArg = strtok(NULL, "\040\t,\040\t")) == NULL) {
-      printf("\nMissing arguments in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+    if(next_token(&lex, LEX_SPACE|LEX_COMMA, &curArg) == NO) {
+      report(ctx, "\nMissing arguments in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
-    while(curArg != NULL) {
-      if(curArg[strlen(curArg)-1]=='\n') curArg[strlen(curArg)-1]= '\0'; /* Remove newline character if present */
-      counter++;
-      binaryLine = realloc(binaryLine, (MAX_WORD+1)*counter);
-      if(is_number(curArg) == YES) strcat(binaryLine, decimalToBinary(atoi(curArg))); /* Convert numbers to binary */
-      else if((label = is_label(curArg, *headLabel)) != NULL && label->labelType == DEFINE) strcat(binaryLine, decimalToBinary(label->data)); /* If symbol, get its value */
+    do {
+      drop_newline(&curArg); /* Remove newline character if present */
+      token_text(&curArg, argText);
+      if(is_number(argText) == YES) lineWords[counter++] = decimalToBinary(atoi(argText)); /* Convert numbers to binary */
+      else if((label = is_label(argText, symbols)) != NULL && label->labelType == DEFINE) lineWords[counter++] = decimalToBinary(label->data); /* If symbol, get its value */
+      else if(label == NULL && symbols->events != NULL) { /* May be defined by an earlier chunk */
+        lineWords[counter] = data_constant(symbols, argText, ctx->DC+counter);
+        counter++;
+      }
       /* Error: illegal data argument */
       else {
-        printf("\n\"%s\" is neither a number nor a symbol(.define value) in line %d: %s in file \"%s\"\n", curArg, lineCounterAm, copyCurLine, fileName);
+        report(ctx, "\n\"%s\" is neither a number nor a symbol(.define value) in line %d: %.*s in file \"%s\"\n", argText, ctx->lineCounterAm, length, curLine, fileName);
         return YES;
       }
-      if((curArg = strtok(NULL, "\040\t,\040\t")) != NULL) strcat(binaryLine, "\n");
-    }
-    build_data_image(&headDataImg, DC, counter, binaryLine); /* Build data image with the binary representation of data */
-    DC+=counter; /* Update Data Counter */
+    } while(next_token(&lex, LEX_SPACE|LEX_COMMA, &curArg) == YES);
+    build_data_image(dataImg, lineWords, counter); /* Build data image with the binary representation of data */
+    ctx->DC+=counter; /* Update Data Counter */
     return NO;
   }
   /* Error: missing arguments for .string directive */
-  else if (strcmp(curArg, ".string") == 0) {
-    int i;
-    char* str;
-    curArg = strtok(NULL, "\040\t");
-    if(curArg==NULL) {
-      printf("\nMissing arguments in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+  else if (word == WORD_STRING) {
+    if(next_token(&lex, LEX_SPACE, &curArg) == NO) {
+      report(ctx, "\nMissing arguments in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
     if(isLabel==YES) {
-      define_label(&headLabel, labelName, DATA, DC); /* Define a label for string section */
-    }
-    str = strchr(curArg, '\"');
-    /* Error: extraneous text after " */
-    if(str[strlen(str)-2] != '\"') {
-      printf("\nExtranous text after \" in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
-      return YES;
-    }
-    i = 1;
-    while(i<strlen(str)-2) {
-      counter++;
-      if(str[i] == '\n') break;
-      /* Error: illegal character in string */
-      if(isprint(str[i]) == 0) {
-        printf("\nCannot print\"%c\" (illegal character) in line %d: %s in file \"%s\"\n", str[i], lineCounterAm, copyCurLine, fileName);
-        return YES;
-      }
-      binaryLine = realloc(binaryLine, (MAX_WORD+1)*counter);
-      strcat(binaryLine, decimalToBinary(str[i])); /* Convert character to binary */
-      i++;
-      strcat(binaryLine, "\n"); /* Append newline */
+      define_label(symbols, labelName, DATA, ctx->DC); /* Define a label for string section */
     }
-    counter++;
-    binaryLine = realloc(binaryLine, (MAX_WORD+1)*counter);
-    strcat(binaryLine, decimalToBinary(0)); /* Add null terminator */
-    build_data_image(&headDataImg, DC, counter, binaryLine); /* Build data image with the binary representation of string */
-    DC+=counter; /* Update Data Counter */
-    return NO;
+    return translate_string(dataImg, &curArg, curLine, length, fileName, ctx);
   }
   else {
-    if(isLabel==YES && is_label(labelName, *headLabel) == NULL) {
-      define_label(&headLabel, labelName, CODE, IC+100); /* Define a label for code section if it doesn't already exist */
+    if(isLabel==YES && is_label(labelName, symbols) == NULL) {
+      new_label(symbols, labelName, CODE, ctx->IC+100); /* Define a label for code section if it doesn't already exist */
     }
-    if(curArg[strlen(curArg)-1]=='\n') curArg[strlen(curArg)-1]= '\0';
+    drop_newline(&curArg);
+    ADD_STAT(ctx, opcodeLookups, 1);
     /* Error: illegal operation */
-    if((opcode = detect_opcode(curArg)) == -1) {
-      printf("\n\"%s\" is not a legal operation in line %d: %s in file \"%s\"\n", curArg, lineCounterAm, copyCurLine, fileName);
+    if((opcode = classify_word(curArg.start, curArg.length)) == -1 || opcode >= OPCODE) {
+      token_text(&curArg, argText);
+      report(ctx, "\n\"%s\" is not a legal operation in line %d: %.*s in file \"%s\"\n", argText, ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
-    curArg = strtok(NULL, "\0");
-    return translate_code_line(&headCodeImg, opcode, IC, curArg, copyCurLine, fileName);
+    return translate_code_line(codeImg, opcode, ctx->IC, next_token(&lex, LEX_REST, &operands) == YES ? &operands : NULL, curLine, length, fileName, ctx);
   }
   return NO;
 }
 
+/******************************************************
+ * Function: translate_string
+ * Description: Translates the argument of a .string directive into the data image.
+ * 
+ * @param dataImg: Pointer to the data image.
+ * @param curArg: The argument, it has to be a quoted string.
+ * @param curLine: Current line of code for error reporting.
+ * @param length: Length of the line.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int translate_string(wordImage* dataImg, token* curArg, char* curLine, int length, char* fileName, assemblerContext* ctx) {
+  machineWord lineWords[BUFFER]; /* Words of the string */
+  int counter = 0;
+  char* str = (char*) memchr(curArg->start, '\"', curArg->length);
+  int strLength = str == NULL ? 0 : curArg->start + curArg->length - str;
+  int i;
+  
+  /* Error: extraneous text after " */
+  if(str == NULL || str[strLength-2] != '\"') {
+    report(ctx, "\nExtranous text after \" in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
+    return YES;
+  }
+  i = 1;
+  while(i<strLength-2) {
+    if(str[i] == '\n') break;
+    /* Error: illegal character in string */
+    if(isprint(str[i]) == 0) {
+      report(ctx, "\nCannot print\"%c\" (illegal character) in line %d: %.*s in file \"%s\"\n", str[i], ctx->lineCounterAm, length, curLine, fileName);
+      return YES;
+    }
+    lineWords[counter++] = decimalToBinary(str[i]); /* Convert character to binary */
+    i++;
+  }
+  lineWords[counter++] = decimalToBinary(0); /* Add null terminator */
+  build_data_image(dataImg, lineWords, counter); /* Build data image with the binary representation of string */
+  ctx->DC+=counter; /* Update Data Counter */
+  return NO;
+}
+
 /******************************************************
  * Function: define_label
- * Description: Defines a label in the label linked list.
+ * Description: Defines a label in the symbol table.
  * 
- * @param hptr: Pointer to the pointer to the head of the label linked list.
+ * @param symbols: Pointer to the symbol table.
  * @param labelName: Name of the label to be defined.
  * @param labelType: Type of the label (DEFINE, DATA, CODE, EXTERNAL).
  * @param data: Value associated with the label.
  ******************************************************/
-void define_label(ptrLabel **hptr, char* labelName, int labelType, int data) {
-  ptrLabel t = (ptrLabel) malloc(sizeof(itemLabel)); /*Create a new item in a linked list*/
-  ptrLabel p1, p2;
-
-  if(t==NULL) {
-    printf("\nFATAL ERROR: Cannot allocate memory\n");
-    exit(0);
-  }
+void define_label(symbolTable* symbols, char* labelName, int labelType, int data) {
+  ptrLabel p1;
   
+  if(symbols->events != NULL) record_event(symbols, EVENT_DEFINE, labelName, labelType, data);
   /* If the label already exists, update its data or type */
-  if((p1 = is_label(labelName, **hptr)) != NULL) {
+  if((p1 = is_label(labelName, symbols)) != NULL) {
     if((p1->labelType == CODE && labelType == DATA)) {
       p1->labelType = labelType;
       p1->data = data;
@@ -349,208 +386,278 @@ void define_label(ptrLabel **hptr, char* labelName, int labelType, int data) {
     }
   }
   
-  t->labelName = malloc(strlen(labelName)+1);
-  strcpy(t->labelName, labelName);
-  t->labelType = labelType;
-  t->data = data;
+  add_symbol(symbols, labelName, labelType, data);
+}
+
+/******************************************************
+ * Function: new_label
+ * Description: Defines a label whose name is not in the symbol table yet.
+ * 
+ * @param symbols: Pointer to the symbol table.
+ * @param labelName: Name of the label to be defined.
+ * @param labelType: Type of the label (DEFINE or CODE).
+ * @param data: Value associated with the label.
+ ******************************************************/
+void new_label(symbolTable* symbols, char* labelName, int labelType, int data) {
+  if(symbols->events != NULL) record_event(symbols, EVENT_NEW, labelName, labelType, data);
+  add_symbol(symbols, labelName, labelType, data);
+}
+
+/******************************************************
+ * Function: data_constant
+ * Description: Records a .data argument that is not defined in the chunk,
+ *		its word is set once the definitions of the earlier chunks are known.
+ * 
+ * @param symbols: Pointer to the symbol table of the chunk.
+ * @param name: The argument.
+ * @param index: Index of its word in the data image of the chunk.
+ * @return: The word until then.
+ ******************************************************/
+machineWord data_constant(symbolTable* symbols, char* name, int index) {
+  record_event(symbols, EVENT_CONSTANT, name, DEFINE, index);
+  return 0;
+}
+
+/******************************************************
+ * Function: record_event
+ * Description: Appends a definition or a use of a chunk to the events of its symbol table.
+ * 
+ * @param symbols: Pointer to the symbol table of the chunk.
+ * @param kind: EVENT_DEFINE, EVENT_NEW or EVENT_CONSTANT.
+ * @param name: Name of the label.
+ * @param labelType: Type of the label.
+ * @param data: Value of the label, or index of the data word of EVENT_CONSTANT.
+ ******************************************************/
+void record_event(symbolTable* symbols, int kind, char* name, int labelType, int data) {
+  symbolEventList* list = symbols->events;
+  symbolEvent* t;
   
-  /* Traverse the linked list to find the end */
-  p1 = **hptr;
-  while ((p1)) {
-    p2 = p1;
-    p1 = p1->next;
+  /* Double the capacity when the list is full */
+  if(list->count == list->capacity) {
+    int capacity = list->capacity == 0 ? INITIAL_EVENTS : list->capacity*2;
+    list->items = (symbolEvent*) arena_grow(list->memory, list->items, list->capacity*sizeof(symbolEvent), capacity*sizeof(symbolEvent));
+    list->capacity = capacity;
   }
+  t = &list->items[list->count++];
+  t->kind = kind;
+  t->labelType = labelType;
+  t->data = data;
+  t->name = arena_strdup(list->memory, name);
+}
+
+/******************************************************
+ * Function: replay_events
+ * Description: Replays the definitions of a chunk on the symbol table of the file,
+ *		after those of the earlier chunks, the way the first pass would have
+ *		made them. Code and data addresses are moved to where the chunk starts.
+ * 
+ * @param events: The events of the chunk, in line order.
+ * @param symbols: Pointer to the symbol table of the file.
+ * @param dataImg: Pointer to the data image of the file.
+ * @param codeBase: IC of the first instruction of the chunk.
+ * @param dataBase: DC of the first data word of the chunk.
+ * @return: YES if the chunk relied on a label the earlier chunks define differently, NO otherwise.
+ ******************************************************/
+int replay_events(symbolEventList* events, symbolTable* symbols, wordImage* dataImg, int codeBase, int dataBase) {
+  ptrLabel label;
+  int i;
   
-  if (p1 == **hptr) { 
-    **hptr = t;
-    t->next = p1;
+  for(i = 0; i < events->count; i++) {
+    symbolEvent* event = &events->items[i];
+    int data = event->data + (event->labelType == CODE ? codeBase : event->labelType == DATA ? dataBase : 0);
+    if(event->kind == EVENT_CONSTANT) {
+      if((label = is_label(event->name, symbols)) == NULL || label->labelType != DEFINE) return YES;
+      dataImg->words[dataBase+event->data] = decimalToBinary(label->data);
+    }
+    else if(event->kind == EVENT_DEFINE) define_label(symbols, event->name, event->labelType, data);
+    else if(is_label(event->name, symbols) == NULL) add_symbol(symbols, event->name, event->labelType, data);
+    else if(event->labelType == DEFINE) return YES; /* A .define of a name an earlier chunk defines */
   }
+  return NO;
+}
+
+/******************************************************
+ * Function: place_data_labels
+ * Description: Moves the data labels after the code, once its length is known.
+ * 
+ * @param symbols: Pointer to the symbol table.
+ * @param IC: Length of the code.
+ ******************************************************/
+void place_data_labels(symbolTable* symbols, int IC) {
+  ptrLabel p1 = symbols->head;
   
-  else {
-    p2->next = t;
-    t->next = p1;
+  while(p1) {
+    if(p1->labelType != DEFINE && p1->labelType != CODE && p1->labelType != EXTERNAL) p1->data = p1->data + 100 + IC;
+    p1 = p1->next;
   }
 }
 
 /******************************************************
  * Function: build_data_image
- * Description: Builds the data image linked list.
+ * Description: Appends the words of a data line to the data image.
  * 
- * @param hptr: Pointer to the pointer to the head of the data image linked list.
- * @param lineNum: Line number associated with the data.
+ * @param dataImg: Pointer to the data image.
+ * @param output: Words of the data line.
  * @param L: Length of the data.
- * @param output: Binary representation of the data.
  ******************************************************/
-void build_data_image (ptrDataImg **hptr, int lineNum, int L, char* output) {
-  ptrDataImg t = (ptrDataImg) malloc(sizeof(itemDataImg)); /*Create a new item in a linked list*/
-  ptrDataImg p1, p2;
-
-  if(t==NULL) {
-    printf("\nCannot allocate memory\n");
-    exit(0);
-  }
-  
-  t->lineNum = lineNum;
-  t->L = L;
-  t->output = malloc(strlen(output)+1);
-  strcpy(t->output, output);
-  
-  /* Traverse the linked list to find the end */
-  p1 = **hptr;
-  while ((p1)) {
-    p2 = p1;
-    p1 = p1->next;
-  }
-  
-  if (p1 == **hptr) { 
-    **hptr = t;
-    t->next = p1;
-  }
-  
-  else {
-    p2->next = t;
-    t->next = p1;
-  }
+void build_data_image (wordImage* dataImg, machineWord* output, int L) {
+  int i;
+  for(i = 0; i < L; i++) add_word(dataImg, output[i]);
 }
 
 /******************************************************
  * Function: build_code_image
- * Description: Builds the code image linked list.
+ * Description: Appends an instruction to the code image.
  * 
- * @param hptr: Pointer to the pointer to the head of the code image linked list.
- * @param lineNum: Line number associated with the code.
+ * @param codeImg: Pointer to the code image.
+ * @param lineNum: Address (IC) of the instruction.
  * @param opcode: Opcode of the instruction.
  * @param L: Length of the instruction.
- * @param output: Binary representation of the instruction.
+ * @param output: First word of the instruction, the operand words are filled in the second pass.
  ******************************************************/
-void build_code_image (ptrCodeImg **hptr, int lineNum, int opcode, int L, char* output) {
-  ptrCodeImg t = (ptrCodeImg) malloc(sizeof(itemCodeImg)); /*Create a new item in a linked list*/
-  ptrCodeImg p1, p2;
-
-  if(t==NULL) {
-    printf("\nCannot allocate memory\n");
-    exit(0);
-  }
-  
-  t->lineNum = lineNum;
-  t->L = L;
-  t->opcode = opcode;
-  t->output = malloc((strlen(output)+1)*L);
-  strcpy(t->output, output);
+void build_code_image (codeImage* codeImg, int lineNum, int opcode, int L, machineWord output) {
+  int i;
   
-  /* Traverse the linked list to find the end */
-  p1 = **hptr;
-  while ((p1)) {
-    p2 = p1;
-    p1 = p1->next;
-  }
-  
-  if (p1 == **hptr) { 
-    **hptr = t;
-    t->next = p1;
-  }
-  
-  else {
-    p2->next = t;
-    t->next = p1;
-  }
+  add_code_line(codeImg, lineNum, opcode, L);
+  add_word(&codeImg->words, output);
+  for(i = 1; i < L; i++) add_word(&codeImg->words, 0);
 }
 
 /******************************************************
  * Function: translate_code_line
  * Description: Translates a line of code into machine code.
  * 
- * @param hptr: Pointer to the pointer to the head of the code image linked list.
+ * @param codeImg: Pointer to the code image.
  * @param opcode: Opcode of the instruction.
- * @param lineNum: Line number associated with the instruction.
- * @param line: Line of code to be translated.
- * @param copyCurLine: Copy of the current line for error reporting.
+ * @param lineNum: Address (IC) of the instruction.
+ * @param line: The operands, the rest of the line after the operation (NULL if there are none).
+ * @param curLine: Current line of code for error reporting.
+ * @param length: Length of the line.
  * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
  * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-int translate_code_line (ptrCodeImg **hptr, int opcode, int lineNum, char* line, char* copyCurLine, char* fileName) {
-  if (opcode == 14 || opcode == 15) { /* Check if the opcode requires no parameters */
-    if (line == NULL) {
-      build_code_image(hptr, lineNum, opcode, 1, operationToBinary (opcode, 0, 0, A));
-      IC+=1;
-      return NO;
-    }
-    else {
-      printf("\nExtranous text in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+int translate_code_line (codeImage* codeImg, int opcode, int lineNum, token* line, char* curLine, int length, char* fileName, assemblerContext* ctx) {
+  const opcodeInfo* info = &opcodeTable[opcode];
+  char operand[BUFFER]; /* The operands as a string */
+  int addressingModeSource = 0;
+  int addressingModeDestination = 0;
+  int L;
+  
+  if (info->operands == 0) { /* Check if the opcode requires no parameters */
+    if (line != NULL) {
+      report(ctx, "\nExtranous text in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
       return YES;
-   }
+    }
   }
-  else if ((opcode >= 7 && opcode <= 13) || opcode == 4 || opcode == 5) { /* Check if the opcode requires 1 parameters */
-    int addressingMode;
-    int L;
+  else if (info->operands == 1) { /* Check if the opcode requires 1 parameters */
     if(line == NULL) {
-      printf("\nMissing argument in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+      report(ctx, "\nMissing argument in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
-    addressingMode = detect_addressing_mode(line);
+    addressingModeDestination = detect_addressing_mode(token_text(line, operand));
     /* Check validity of addressing modes */
-    if (addressingMode == -1) {
-      printf("\n\"%s\" is an illegal argument in line %d: %s in file \"%s\"\n", line, lineCounterAm, copyCurLine, fileName);
-      return YES;
-    }
-    else if (addressingMode == INDEX) L = 3;
-    else if (addressingMode == IMMEDIATE && opcode != 12) {
-      printf("\n\"%s\" is an illegal argument in line %d: %s in file \"%s\"\n", line, lineCounterAm, copyCurLine, fileName);
-      return YES;
-    }
-    else if (addressingMode == INDEX && (opcode == 9 || opcode == 10 || opcode == 13)) {
-      printf("\n\"%s\" is an illegal argument in line %d: %s in file \"%s\"\n", line, lineCounterAm, copyCurLine, fileName);
+    if (addressingModeDestination == -1 || !(info->destinationModes & MODE_BIT(addressingModeDestination))) {
+      report(ctx, "\n\"%s\" is an illegal argument in line %d: %.*s in file \"%s\"\n", operand, ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
-    else L = 2;
-    build_code_image(hptr, lineNum, opcode, L, operationToBinary(opcode, 0, addressingMode, A));
-    IC+=L;
-    return NO;
   }
-  else if (opcode <=3 || opcode == 6) { /* Check if the opcode requires 2 parameters */
-    char* arg1 = malloc(strlen(line)+1);
-    char* arg2 = malloc(strlen(line)+1);
-    int addressingModeSource;
-    int addressingModeDestination;
-    int L = 1;
-    arg1 = strtok(line, "\040\t,\040\t");
-    arg2 = strtok(NULL, ",\040\t");
+  else { /* The opcode requires 2 parameters */
+    lexer lex;
+    token arg1;
+    token arg2;
+    char arg2Text[BUFFER];
+    if(line != NULL) init_lexer(&lex, line->start, line->length);
     
-    if (arg1 == NULL || arg2 == NULL) {
-      printf("\nMissing argument(s) in line %d: %s in file \"%s\"\n", lineCounterAm, copyCurLine, fileName);
+    if (line == NULL || next_token(&lex, LEX_SPACE|LEX_COMMA, &arg1) == NO || next_token(&lex, LEX_COMMA|LEX_SPACE, &arg2) == NO) {
+      report(ctx, "\nMissing argument(s) in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
     
-    addressingModeSource = detect_addressing_mode(arg1);
-    addressingModeDestination = detect_addressing_mode(arg2);
+    addressingModeSource = detect_addressing_mode(token_text(&arg1, operand));
+    addressingModeDestination = detect_addressing_mode(token_text(&arg2, arg2Text));
     /* Check validity of addressing modes */
-    if(addressingModeSource == -1) {
-      printf("\n\"%s\" is an illegal argument in line %d: %s in file \"%s\"\n", arg1, lineCounterAm, copyCurLine, fileName);
+    if(addressingModeSource == -1 || (addressingModeDestination != -1 && !(info->sourceModes & MODE_BIT(addressingModeSource)))) {
+      report(ctx, "\n\"%s\" is an illegal argument in line %d: %.*s in file \"%s\"\n", operand, ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
-    if(addressingModeDestination == -1) {
-      printf("\n\"%s\" is an illegal argument in line %d: %s in file \"%s\"\n", arg2, lineCounterAm, copyCurLine, fileName);
+    if(addressingModeDestination == -1 || !(info->destinationModes & MODE_BIT(addressingModeDestination))) {
+      report(ctx, "\n\"%s\" is an illegal argument in line %d: %.*s in file \"%s\"\n", arg2Text, ctx->lineCounterAm, length, curLine, fileName);
       return YES;
     }
+  }
+  
+  L = info->length[addressingModeSource][addressingModeDestination];
+  build_code_image(codeImg, lineNum, opcode, L, info->firstWord[addressingModeSource][addressingModeDestination]);
+  record_operands(codeImg, opcode, lineNum, line, curLine, length, ctx);
+  ctx->IC+=L;
+  return NO;
+}
+
+/******************************************************
+ * Function: record_operands
+ * Description: Splits the operands of an instruction the way the second pass reads them.
+ *		Registers are encoded right away, every other operand is recorded
+ *		as a fixup to be patched once the symbol table is complete.
+ * 
+ * @param codeImg: Pointer to the code image.
+ * @param opcode: Opcode of the instruction.
+ * @param lineNum: Address (IC) of the instruction.
+ * @param line: The operands of the instruction (NULL if there are none).
+ * @param curLine: Current line of code for error reporting, owned by the arena.
+ * @param length: Length of the line.
+ * @param ctx: Context of the file.
+ ******************************************************/
+void record_operands (codeImage* codeImg, int opcode, int lineNum, token* line, char* curLine, int length, assemblerContext* ctx) {
+  char arg1[BUFFER];
+  char arg2[BUFFER];
+  
+  codeImg->fixups.lastCodeLine = ctx->lineCounterAm;
+  if (line == NULL) return;
+  if (opcodeTable[opcode].operands == 1) { /* Instructions that have a single operand */
+    token operand = *line;
+    drop_newline(&operand);
+    token_text(&operand, arg1);
+    record_operand(codeImg, detect_addressing_mode(arg1), lineNum+1, arg1, curLine, length, ctx);
+  }
+  else if (opcodeTable[opcode].operands == 2) { /* Instructions that have two operands */
+    lexer lex;
+    token operand;
+    int addressingModeSource;
+    int addressingModeDestination;
     
-    if(addressingModeSource == DIRECT_REGISTER && addressingModeDestination == DIRECT_REGISTER) L = 2;
-    else {
-      if (addressingModeSource == INDEX) L+=2;
-      else if ((addressingModeSource == IMMEDIATE || addressingModeSource == DIRECT_REGISTER) && opcode == 6) {
-        printf("\n\"%s\" is an illegal argument in line %d: %s in file \"%s\"\n", arg1, lineCounterAm, copyCurLine, fileName);
-        return YES;
-      }
-      else L++;
-      if (addressingModeDestination == INDEX) L+=2;
-      else if (addressingModeDestination == IMMEDIATE && opcode != 1) {
-        printf("\n\"%s\" is an illegal argument in line %d: %s in file \"%s\"\n", arg2, lineCounterAm, copyCurLine, fileName);
-        return YES;
-      }
-      else L++;
+    init_lexer(&lex, line->start, line->length);
+    next_token(&lex, LEX_SPACE|LEX_COMMA, &operand);
+    addressingModeSource = detect_addressing_mode(token_text(&operand, arg1));
+    if(next_token(&lex, LEX_COMMA|LEX_SPACE|LEX_NEWLINE, &operand) == YES) token_text(&operand, arg2);
+    else arg2[0] = '\0'; /* A trailing comma, reported as an illegal argument */
+    addressingModeDestination = detect_addressing_mode(arg2);
+    
+    /* Both registers share a single word */
+    if(addressingModeSource == DIRECT_REGISTER && addressingModeDestination == DIRECT_REGISTER) {
+      codeImg->words.words[lineNum+1] = direct_register_addressing(arg1, arg2);
+      return;
     }
-    build_code_image(hptr, lineNum, opcode, L, operationToBinary (opcode, addressingModeSource, addressingModeDestination, A));
-    IC+=L;
-    return NO;
+    if(addressingModeSource == DIRECT_REGISTER) codeImg->words.words[lineNum+1] = direct_register_addressing(arg1, NULL);
+    else record_operand(codeImg, addressingModeSource, lineNum+1, arg1, curLine, length, ctx);
+    record_operand(codeImg, addressingModeDestination, lineNum + ((addressingModeSource == INDEX) ? 3 : 2), arg2, curLine, length, ctx);
   }
-  return YES;
+}
+
+/******************************************************
+ * Function: record_operand
+ * Description: Encodes an operand that does not depend on labels, or records it as a fixup.
+ * 
+ * @param codeImg: Pointer to the code image.
+ * @param mode: Addressing mode of the operand.
+ * @param slot: Index of the first word of the operand in the code image.
+ * @param arg: The operand.
+ * @param curLine: Current line of code for error reporting, owned by the arena.
+ * @param length: Length of the line.
+ * @param ctx: Context of the file.
+ ******************************************************/
+void record_operand (codeImage* codeImg, int mode, int slot, char* arg, char* curLine, int length, assemblerContext* ctx) {
+  if(mode == DIRECT_REGISTER) codeImg->words.words[slot] = direct_register_addressing(NULL, arg);
+  else if(mode == IMMEDIATE && is_number(arg+1) == YES) codeImg->words.words[slot] = decimalToBinaryARE(atoi(arg+1), A);
+  else add_fixup(&codeImg->fixups, CODE, mode, slot, ctx->lineCounterAm, arg, curLine, length);
 }
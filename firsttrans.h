@@ -1,12 +1,45 @@
 /******************************************************
- * Function: translate_line
- * Description: Translates a single line of code from the assembly file.
+ * Function: firsttrans
+ * Description: Performs the first pass of the translation process for the assembly file.
  * 
- * @param curLine: Current line of code.
- * @param headLabel: Pointer to the head of the label linked list.
- * @param headDataImg: Pointer to the head of the data image linked list.
- * @param headCodeImg: Pointer to the head of the code image linked list.
+ * @param am: Text buffer holding the expanded source.
  * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
+ ******************************************************/
+void firsttrans(textBuffer* am, char* fileName, assemblerContext* ctx);
+/******************************************************
+ * Function: translate_lines
+ * Description: Translates the lines of the expanded source, or of a chunk of it,
+ *		into the symbol table and the images.
+ * 
+ * @param am: Text buffer holding the lines.
+ * @param symbols: Pointer to the symbol table.
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file, its counters start at the first line.
  * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-void firsttrans(FILE* am, char* fileName);
+int translate_lines(textBuffer* am, symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, char* fileName, assemblerContext* ctx);
+/******************************************************
+ * Function: replay_events
+ * Description: Replays the definitions of a chunk on the symbol table of the file,
+ *		after those of the earlier chunks, the way the first pass would have
+ *		made them. Code and data addresses are moved to where the chunk starts.
+ * 
+ * @param events: The events of the chunk, in line order.
+ * @param symbols: Pointer to the symbol table of the file.
+ * @param dataImg: Pointer to the data image of the file.
+ * @param codeBase: IC of the first instruction of the chunk.
+ * @param dataBase: DC of the first data word of the chunk.
+ * @return: YES if the chunk relied on a label the earlier chunks define differently, NO otherwise.
+ ******************************************************/
+int replay_events(symbolEventList* events, symbolTable* symbols, wordImage* dataImg, int codeBase, int dataBase);
+/******************************************************
+ * Function: place_data_labels
+ * Description: Moves the data labels after the code, once its length is known.
+ * 
+ * @param symbols: Pointer to the symbol table.
+ * @param IC: Length of the code.
+ ******************************************************/
+void place_data_labels(symbolTable* symbols, int IC);
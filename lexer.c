@@ -0,0 +1,107 @@
+/******************************************************
+ * File: lexer.c
+ * Description: This file splits lines into tokens. A
+ *              token is a span of the line, the line
+ *              itself is never modified. Each call takes
+ *              the set of delimiters it stops at, so the
+ *              passes split lines exactly where strtok
+ *              used to split them.
+ ******************************************************/
+
+#include "universal.h"
+
+void classify_token(token* tok);
+
+/* Delimiter classes of the characters, the ones past ASCII are never delimiters */
+const unsigned char lexClasses[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, LEX_SPACE, LEX_NEWLINE, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  LEX_SPACE, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, LEX_COMMA, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, LEX_EQUALS, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, LEX_OPEN, 0, LEX_CLOSE, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+#define IS_DELIMITER(c, delimiters) (lexClasses[(unsigned char)(c)] & (delimiters))
+
+/******************************************************
+ * Function: init_lexer
+ * Description: Starts splitting a line into tokens.
+ *
+ * @param lex: Pointer to the lexer to initialize.
+ * @param line: The line, it does not have to be null terminated.
+ * @param length: Length of the line.
+ ******************************************************/
+void init_lexer(lexer* lex, char* line, int length) {
+  lex->position = line;
+  lex->end = line + length;
+}
+
+/******************************************************
+ * Function: next_token
+ * Description: Finds the next token of the line. Leading delimiters are skipped,
+ *		the token ends at the next delimiter, which is skipped as well.
+ *
+ * @param lex: Pointer to the lexer.
+ * @param delimiters: The LEX_ classes that separate tokens (LEX_REST for the rest of the line).
+ * @param tok: Where the token is stored.
+ * @return: YES if a token was found, NO at the end of the line.
+ ******************************************************/
+int next_token(lexer* lex, int delimiters, token* tok) {
+  char* p = lex->position;
+
+  while(p < lex->end && IS_DELIMITER(*p, delimiters)) p++;
+  if(p == lex->end) {
+    lex->position = p;
+    return NO;
+  }
+  tok->start = p;
+  while(p < lex->end && !IS_DELIMITER(*p, delimiters)) p++;
+  tok->length = p - tok->start;
+  lex->position = p < lex->end ? p+1 : p;
+  classify_token(tok);
+  return YES;
+}
+
+/******************************************************
+ * Function: classify_token
+ * Description: Sets the kind of a token from its first and last characters.
+ *
+ * @param tok: Pointer to the token.
+ ******************************************************/
+void classify_token(token* tok) {
+  char* c = tok->start;
+
+  if(c[tok->length-1] == ':') tok->kind = TOKEN_LABEL;
+  else if(c[0] == '.') tok->kind = TOKEN_DIRECTIVE;
+  else if(c[0] == '#') tok->kind = TOKEN_IMMEDIATE;
+  else if(tok->length == 2 && c[0] == 'r' && c[1] >= '0' && c[1] <= '7') tok->kind = TOKEN_REGISTER;
+  else if(memchr(c, '[', tok->length) != NULL) tok->kind = TOKEN_INDEX;
+  else tok->kind = TOKEN_WORD;
+}
+
+/******************************************************
+ * Function: drop_newline
+ * Description: Removes the newline character that ends a token, if there is one.
+ *
+ * @param tok: Pointer to the token.
+ ******************************************************/
+void drop_newline(token* tok) {
+  if(tok->length > 0 && tok->start[tok->length-1] == '\n') tok->length--;
+}
+
+/******************************************************
+ * Function: token_text
+ * Description: Copies a token into a null terminated string.
+ *
+ * @param tok: Pointer to the token.
+ * @param text: Where the string is stored (tokens are shorter than BUFFER).
+ * @return: text.
+ ******************************************************/
+char* token_text(token* tok, char* text) {
+  memcpy(text, tok->start, tok->length);
+  text[tok->length] = '\0';
+  return text;
+}
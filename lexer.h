@@ -0,0 +1,43 @@
+/******************************************************
+ * Function: init_lexer
+ * Description: Starts splitting a line into tokens.
+ *
+ * @param lex: Pointer to the lexer to initialize.
+ * @param line: The line, it does not have to be null terminated.
+ * @param length: Length of the line.
+ ******************************************************/
+void init_lexer(lexer* lex, char* line, int length);
+/******************************************************
+ * Function: next_token
+ * Description: Finds the next token of the line. Leading delimiters are skipped,
+ *		the token ends at the next delimiter, which is skipped as well.
+ *
+ * @param lex: Pointer to the lexer.
+ * @param delimiters: The LEX_ classes that separate tokens (LEX_REST for the rest of the line).
+ * @param tok: Where the token is stored.
+ * @return: YES if a token was found, NO at the end of the line.
+ ******************************************************/
+int next_token(lexer* lex, int delimiters, token* tok);
+/******************************************************
+ * Function: classify_token
+ * Description: Sets the kind of a token from its first and last characters.
+ *
+ * @param tok: Pointer to the token.
+ ******************************************************/
+void classify_token(token* tok);
+/******************************************************
+ * Function: drop_newline
+ * Description: Removes the newline character that ends a token, if there is one.
+ *
+ * @param tok: Pointer to the token.
+ ******************************************************/
+void drop_newline(token* tok);
+/******************************************************
+ * Function: token_text
+ * Description: Copies a token into a null terminated string.
+ *
+ * @param tok: Pointer to the token.
+ * @param text: Where the string is stored (tokens are shorter than BUFFER).
+ * @return: text.
+ ******************************************************/
+char* token_text(token* tok, char* text);
@@ -0,0 +1,121 @@
+/******************************************************
+ * File: libasm.c
+ * Description: This file is the interface of the
+ *              assembler library (libasm.a), for tools
+ *              that embed the assembler. A source held
+ *              in memory is assembled without touching
+ *              the filesystem, the images, the symbol
+ *              tables and the diagnostics are returned
+ *              in memory. All the state of a call lives
+ *              in its own context, so calls can run on
+ *              several threads at once. Running out of
+ *              memory fails the call instead of ending
+ *              the program.
+ ******************************************************/
+
+#include "universal.h"
+#include "arena.h"
+#include "context.h"
+#include "textBuffer.h"
+#include "assembleFile.h"
+
+#define BUFFER_NAME "buffer" /*Name of the source in the diagnostics*/
+
+int assemble_or_fail(assemblerContext* ctx, const char* src, size_t len);
+
+/******************************************************
+ * Function: asm_assemble_buffer
+ * Description: Assembles a source held in memory.
+ *		The result must be released with asm_free_result, even after an error.
+ *		When the memory runs out the result only holds a diagnostic that says so.
+ *
+ * @param src: The source, it does not have to be null terminated.
+ * @param len: Length of the source.
+ * @param result: Where the images, the symbols and the diagnostics are stored.
+ * @return: int indicating whether the source has errors or the memory ran out (YES) or not (NO).
+ ******************************************************/
+int asm_assemble_buffer(const char* src, size_t len, asmResult* result) {
+  assemblerOptions options;
+  assemblerContext ctx;
+
+  /* No .am file and no cache, nothing is written */
+  options.jobs = 1;
+  options.emitAm = NO;
+  options.format = FORMAT_TEXT;
+  options.cacheDir = NULL;
+  options.cacheBudget = 0;
+  options.stats = STATS_OFF;
+  options.split = 1;
+  options.optimize = 0;
+
+  init_arena(&result->memory);
+  result->isError = YES;
+  result->image.IC = 0;
+  result->image.DC = 0;
+  result->image.words = NULL;
+  result->entries = NULL;
+  result->entryCount = 0;
+  result->externals = NULL;
+  result->externalCount = 0;
+
+  init_context(&ctx, BUFFER_NAME, &options);
+  ctx.result = result;
+  if(assemble_or_fail(&ctx, src, len) == YES) {
+    /* What was stored before the memory ran out is dropped */
+    free_arena(&result->memory);
+    result->isError = YES;
+    result->image.IC = 0;
+    result->image.DC = 0;
+    result->image.words = NULL;
+    result->entries = NULL;
+    result->entryCount = 0;
+    result->externals = NULL;
+    result->externalCount = 0;
+    result->diagnostics = "\nFATAL ERROR: Cannot allocate memory\n";
+  }
+  result->memory.onFailure = NULL;
+  free(ctx.report);
+  free_arena(&ctx.memory);
+  return result->isError;
+}
+
+/******************************************************
+ * Function: assemble_or_fail
+ * Description: Assembles the source and copies the diagnostics to the result.
+ *		An allocation that fails in the arenas of the call returns here.
+ *
+ * @param ctx: Context of the call, with its result.
+ * @param src: The source.
+ * @param len: Length of the source.
+ * @return: int indicating whether the memory ran out (YES) or not (NO).
+ ******************************************************/
+int assemble_or_fail(assemblerContext* ctx, const char* src, size_t len) {
+  jmp_buf onFailure;
+  textBuffer source;
+
+  if(setjmp(onFailure) != 0) return YES;
+  ctx->memory.onFailure = &onFailure;
+  ctx->result->memory.onFailure = &onFailure;
+  init_text_buffer(&source, &ctx->memory);
+  append_text(&source, (char*) src, len); /* The caller keeps its buffer */
+  assemble_source(ctx, &source);
+
+  ctx->result->diagnostics = (char*) arena_alloc(&ctx->result->memory, ctx->reportLength+1);
+  if(ctx->reportLength > 0) memcpy(ctx->result->diagnostics, ctx->report, ctx->reportLength);
+  ctx->result->diagnostics[ctx->reportLength] = '\0';
+  return NO;
+}
+
+/******************************************************
+ * Function: asm_free_result
+ * Description: Releases everything a call to asm_assemble_buffer stored in its result.
+ *
+ * @param result: The result.
+ ******************************************************/
+void asm_free_result(asmResult* result) {
+  free_arena(&result->memory);
+  result->image.words = NULL;
+  result->entries = NULL;
+  result->externals = NULL;
+  result->diagnostics = NULL;
+}
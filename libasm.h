@@ -0,0 +1,19 @@
+/******************************************************
+ * Function: asm_assemble_buffer
+ * Description: Assembles a source held in memory.
+ *		The result must be released with asm_free_result, even after an error.
+ *		When the memory runs out the result only holds a diagnostic that says so.
+ *
+ * @param src: The source, it does not have to be null terminated.
+ * @param len: Length of the source.
+ * @param result: Where the images, the symbols and the diagnostics are stored.
+ * @return: int indicating whether the source has errors or the memory ran out (YES) or not (NO).
+ ******************************************************/
+int asm_assemble_buffer(const char* src, size_t len, asmResult* result);
+/******************************************************
+ * Function: asm_free_result
+ * Description: Releases everything a call to asm_assemble_buffer stored in its result.
+ *
+ * @param result: The result.
+ ******************************************************/
+void asm_free_result(asmResult* result);
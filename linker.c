@@ -0,0 +1,254 @@
+/******************************************************
+ * File: linker.c
+ * Description: This program links the .ob, .ent and
+ *              .ext files of several modules into a
+ *              single .ob file. The code of all the
+ *              modules comes first, in the order they
+ *              were given, followed by their data. The
+ *              addresses in relocatable words are moved
+ *              to where their module was placed, the
+ *              entries of all the modules are collected
+ *              in one hashed symbol table and every use
+ *              listed in an .ext file is patched with
+ *              the address of its entry.
+ ******************************************************/
+
+#include "universal.h"
+#include "objectFile.h"
+#include "exportFiles.h"
+#include "symbolTable.h"
+#include "textToBinary.h"
+#include "arena.h"
+
+char* module_file(arena* memory, char* name, char* extension);
+int place_modules(linkModule* modules, int count, objectImage* image);
+int relocate(linkModule* module, int address);
+int read_entries(linkModule* module, symbolTable* symbols, arena* memory);
+int patch_externals(linkModule* module, symbolTable* symbols, objectImage* image, arena* memory);
+
+/******************************************************
+ * Function: main
+ * Description: The entry point of the linker,
+ *		recieves the output name (-o) and the modules from the command line.
+ *
+ * @param argc: The number of command-line arguments.
+ * @param argv: An array of pointers to the arguments.
+ * @return 0 if the linked file was created, 1 otherwise.
+ ******************************************************/
+int main(int argc, char* argv[]) {
+  linkModule* modules = (linkModule*) malloc(argc*sizeof(linkModule));
+  char* output = "a";
+  objectImage image;
+  symbolTable symbols;
+  arena memory;
+  int count = 0;
+  int isError = NO;
+  int i;
+
+  if(modules == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+  init_arena(&memory);
+  init_symbol_table(&symbols, &memory);
+  init_encryption();
+
+  /*Separate the output name from the modules*/
+  for(i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "-o") == 0 && i+1 < argc) output = argv[++i];
+    else modules[count++].name = argv[i];
+  }
+  if(count == 0) {
+    printf("\nYou didn't enter a module to be linked\n");
+    free(modules);
+    return 1;
+  }
+
+  for(i = 0; i < count; i++)
+    if(load_object(module_file(&memory, modules[i].name, ".ob"), &modules[i].image) == YES) isError = YES;
+  if(isError == NO && (isError = place_modules(modules, count, &image)) == NO) {
+    /* All the entries are known before the first external is patched */
+    for(i = 0; i < count; i++)
+      if(read_entries(&modules[i], &symbols, &memory) == YES) isError = YES;
+    for(i = 0; i < count; i++)
+      if(patch_externals(&modules[i], &symbols, &image, &memory) == YES) isError = YES;
+    if(isError == NO && write_object(module_file(&memory, output, ".ob"), &image) == YES) {
+      printf("\nFATAL ERROR: Cannot open file \"%s.ob\"\n", output);
+      isError = YES;
+    }
+    free_object(&image);
+  }
+  if(isError == YES) printf("\nErrors detected in linking, \"%s.ob\" will not be created\n", output);
+
+  for(i = 0; i < count; i++) free_object(&modules[i].image);
+  free(modules);
+  free_arena(&memory);
+  return isError == YES ? 1 : 0;
+}
+
+/******************************************************
+ * Function: module_file
+ * Description: Builds the name of a file of a module.
+ *
+ * @param memory: Arena that owns the name.
+ * @param name: Name of the module without its extension.
+ * @param extension: The extension, with its dot.
+ * @return: The name of the file.
+ ******************************************************/
+char* module_file(arena* memory, char* name, char* extension) {
+  char* fileName = (char*) arena_alloc(memory, strlen(name)+strlen(extension)+1);
+  strcpy(fileName, name);
+  strcat(fileName, extension);
+  return fileName;
+}
+
+/******************************************************
+ * Function: place_modules
+ * Description: Places the code and the data of the modules in one image
+ *		and relocates the addresses of their relocatable words.
+ *
+ * @param modules: The modules, with their object images loaded.
+ * @param count: Number of modules.
+ * @param image: The linked image to build.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int place_modules(linkModule* modules, int count, objectImage* image) {
+  int isError = NO;
+  int i, j;
+
+  image->IC = 0;
+  image->DC = 0;
+  for(i = 0; i < count; i++) {
+    image->IC += modules[i].image.IC;
+    image->DC += modules[i].image.DC;
+  }
+  if(image->IC+image->DC > MAX_PROGRAM) {
+    printf("\nThe linked program has %d words, more than %d\n", image->IC+image->DC, MAX_PROGRAM);
+    return YES;
+  }
+  if((image->words = (machineWord*) malloc((image->IC+image->DC+1)*sizeof(machineWord))) == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+
+  /* Code of every module, then data of every module */
+  modules[0].codeBase = FIRST_ADDRESS;
+  modules[0].dataBase = FIRST_ADDRESS+image->IC;
+  for(i = 1; i < count; i++) {
+    modules[i].codeBase = modules[i-1].codeBase + modules[i-1].image.IC;
+    modules[i].dataBase = modules[i-1].dataBase + modules[i-1].image.DC;
+  }
+
+  for(i = 0; i < count; i++) {
+    machineWord* code = image->words + modules[i].codeBase-FIRST_ADDRESS;
+    memcpy(code, modules[i].image.words, modules[i].image.IC*sizeof(machineWord));
+    memcpy(image->words + modules[i].dataBase-FIRST_ADDRESS, modules[i].image.words+modules[i].image.IC, modules[i].image.DC*sizeof(machineWord));
+    /* Only operand words of the code hold ARE bits, data words are plain numbers */
+    for(j = 0; j < modules[i].image.IC; j++) {
+      int address;
+      if((code[j] & 3) != ARE_RELOCATABLE) continue;
+      if((address = relocate(&modules[i], code[j] >> 2)) == -1) {
+        printf("\nThe word at address %04d of module \"%s\" refers outside of the module\n", FIRST_ADDRESS+j, modules[i].name);
+        isError = YES;
+      }
+      else code[j] = decimalToBinaryARE(address, R);
+    }
+  }
+  if(isError == YES) free_object(image);
+  return isError;
+}
+
+/******************************************************
+ * Function: relocate
+ * Description: Finds where an address of a module is in the linked image.
+ *
+ * @param module: Pointer to the module.
+ * @param address: Address in the module.
+ * @return: Address in the linked image, -1 if it is not an address of the module.
+ ******************************************************/
+int relocate(linkModule* module, int address) {
+  int offset = address-FIRST_ADDRESS;
+
+  if(offset < 0 || offset >= module->image.IC+module->image.DC) return -1;
+  if(offset < module->image.IC) return module->codeBase + offset;
+  return module->dataBase + offset-module->image.IC;
+}
+
+/******************************************************
+ * Function: read_entries
+ * Description: Adds the entries of a module to the global symbol table.
+ *		A module without an .ent file has no entries.
+ *
+ * @param module: Pointer to the module.
+ * @param symbols: Pointer to the global symbol table.
+ * @param memory: Arena that owns the name of the file.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int read_entries(linkModule* module, symbolTable* symbols, arena* memory) {
+  char* fileName = module_file(memory, module->name, ".ent");
+  FILE* file = fopen(fileName, "r");
+  char line[BUFFER];
+  char name[BUFFER];
+  int isError = NO;
+  int address;
+
+  if(file == NULL) return NO;
+  while(fgets(line, BUFFER, file) != NULL) {
+    if(sscanf(line, "%s %d", name, &address) != 2 || (address = relocate(module, address)) == -1) {
+      printf("\nInvalid line in file \"%s\": %s\n", fileName, line);
+      isError = YES;
+    }
+    else if(is_label(name, symbols) != NULL) {
+      printf("\n\"%s\" is an entry of more than one module, again in file \"%s\"\n", name, fileName);
+      isError = YES;
+    }
+    else add_symbol(symbols, name, ENTRY, address);
+  }
+  fclose(file);
+  return isError;
+}
+
+/******************************************************
+ * Function: patch_externals
+ * Description: Patches the uses of external labels listed in the .ext file of a module
+ *		with the addresses of their entries.
+ *
+ * @param module: Pointer to the module.
+ * @param symbols: Pointer to the global symbol table.
+ * @param image: The linked image.
+ * @param memory: Arena that owns the name of the file.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int patch_externals(linkModule* module, symbolTable* symbols, objectImage* image, arena* memory) {
+  char* fileName = module_file(memory, module->name, ".ext");
+  FILE* file = fopen(fileName, "r");
+  machineWord* code = image->words + module->codeBase-FIRST_ADDRESS;
+  char line[BUFFER];
+  char name[BUFFER];
+  ptrLabel label;
+  int isError = NO;
+  int address, j;
+
+  if(file != NULL) {
+    while(fgets(line, BUFFER, file) != NULL) {
+      if(sscanf(line, "%s %d", name, &address) != 2 || (j = address-FIRST_ADDRESS) < 0 || j >= module->image.IC || (code[j] & 3) != ARE_EXTERNAL) {
+        printf("\nInvalid line in file \"%s\": %s\n", fileName, line);
+        isError = YES;
+      }
+      else if((label = is_label(name, symbols)) == NULL) {
+        printf("\n\"%s\" is used by module \"%s\" but is not an entry of any module\n", name, module->name);
+        isError = YES;
+      }
+      else code[j] = decimalToBinaryARE(label->data, R);
+    }
+    fclose(file);
+  }
+
+  /* Every external reference must have been listed */
+  for(j = 0; j < module->image.IC && isError == NO; j++)
+    if((code[j] & 3) == ARE_EXTERNAL) {
+      printf("\nThe external reference at address %04d of module \"%s\" is not in file \"%s\"\n", FIRST_ADDRESS+j, module->name, fileName);
+      isError = YES;
+    }
+  return isError;
+}
@@ -1,205 +1,274 @@
 #include "universal.h"
 #include "errorTreatment.h"
+#include "arena.h"
+#include "context.h"
+#include "textBuffer.h"
+#include "symbolTable.h"
+#include "lexer.h"
 
-/* Structure definition for a linked list node */
+#define INITIAL_MACROS 64 /* Initial number of slots in the macro table (must be a power of two) */
+
+/* Structure definition for a macro */
 typedef struct node* ptr;
 typedef struct node {
   char* macroName;
-  char* macro;
-  ptr next;
+  int nameLength;
+  unsigned long hash;
+  char* macro; /* Body of the macro, the span of the source between its mcr and endmcr lines */
+  size_t length;
 } item;
 
-int handle_line(char* curLine, ptr *h, FILE *as, FILE *am, char* fileName);
-ptr add2list(ptr **hptr, char* macroName);
-void addMacro(ptr *hptr, char* macro);
-void freelist(ptr * hptr);
-ptr is_line_macro(char* line, ptr h);
+/* Open-addressing hash table of the macros, like the symbol table */
+typedef struct macroList {
+  ptr* slots;
+  unsigned long capacity;
+  unsigned long count;
+  unsigned long lookups; /* Calls of is_line_macro, for --stats */
+  assemblerContext* ctx; /* Context of the file, whose arena owns the table, names and bodies */
+} macroList;
 
-int lineCounterAs = 1;
+char* trim_line(char* line, int* length);
+int handle_line(char* curLine, int length, macroList* macros, textBuffer* as, textBuffer* am, char* fileName);
+void grow_macro_table(macroList* macros);
+ptr add2list(macroList* macros, char* macroName);
+void addMacro(ptr *hptr, char* macro, size_t length);
+void expand_macro(ptr macro, textBuffer* am);
+ptr is_line_macro(char* line, int length, macroList* macros);
 
 /******************************************************
  * Function: pre_processor
- * Description: Preprocesses the assembly file, handling macros and generating a modified assembly file.
+ * Description: Preprocesses the assembly file, handling macros and passing the expanded lines to the first pass.
  * 
- * @param as: Pointer to the original assembly file.
- * @param fileNameAm: Name of the macro file to be generated.
+ * @param as: Text buffer holding the original assembly file.
+ * @param am: Text buffer that receives the expanded source.
  * @param fileNameAs: Name of the modified assembly file to be generated.
+ * @param ctx: Context of the file.
  * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-int pre_processor (FILE *as, char* fileNameAm, char* fileNameAs) {
-  FILE *am;
-  ptr h = NULL;
-  char curLine[BUFFER];
-  int i;
+int pre_processor (textBuffer* as, textBuffer* am, char* fileNameAs, assemblerContext* ctx) {
+  macroList macros;
+  char* curLine;
+  int length;
   int isError = NO;
   
-  am = fopen(fileNameAm, "w"); /* Open the macro file for writing */
+  macros.ctx = ctx;
+  macros.slots = (ptr*) arena_alloc(&ctx->memory, INITIAL_MACROS*sizeof(ptr));
+  memset(macros.slots, 0, INITIAL_MACROS*sizeof(ptr));
+  macros.capacity = INITIAL_MACROS;
+  macros.count = 0;
+  macros.lookups = 0;
   
-  while(fgets(curLine, BUFFER-1, as) != NULL) { /*Parse the file line by line*/
+  while((curLine = next_line(as, BUFFER-1, &length)) != NULL) { /*Parse the file line by line*/
+    ADD_STAT(ctx, lines[PHASE_MACRO], 1);
     if(curLine[0] == ';') continue; /*Check for comment*/
-    if (strcmp(curLine, "\n") == 0) continue; /*Check for empty line*/
-    /* Remove leading and trailing whitespaces */
-    for(i = 0; isspace(curLine[i]); i++) memmove(curLine, curLine + 1, strlen(curLine));
-    for(i = strlen(curLine)-1; isspace(curLine[i]); i--) curLine[strlen(curLine)-1] = '\0';
-    if(isError != YES) isError = handle_line(curLine, &h, as, am, fileNameAs); /* Process the line and handle any errors */
-    lineCounterAs++;
+    if (length == 1 && curLine[0] == '\n') continue; /*Check for empty line*/
+    curLine = trim_line(curLine, &length);
+    if(isError != YES) isError = handle_line(curLine, length, &macros, as, am, fileNameAs); /* Process the line and handle any errors */
+    ctx->lineCounterAs++;
   }
-  fclose(am);
+  ADD_STAT(ctx, macros, macros.count);
+  ADD_STAT(ctx, macroLookups, macros.lookups);
   return isError;
 }
 
+/******************************************************
+ * Function: trim_line
+ * Description: Removes leading and trailing whitespaces from a line without modifying it.
+ * 
+ * @param line: The line.
+ * @param length: Length of the line, updated to the length of the trimmed line.
+ * @return: The start of the trimmed line.
+ ******************************************************/
+char* trim_line(char* line, int* length) {
+  char* end = line + *length;
+  
+  while(line < end && isspace(*line)) line++;
+  while(end > line && isspace(end[-1])) end--;
+  *length = end - line;
+  return line;
+}
+
 /******************************************************
  * Function: handle_line
  * Description: Handles each line of the assembly file, identifying macros and copying lines to the modified assembly file.
  * 
- * @param curLine: Current line of the assembly file being processed.
- * @param h: Pointer to the head of the macro linked list.
- * @param as: Pointer to the original assembly file.
- * @param am: Pointer to the modified assembly file.
+ * @param curLine: Current line of the assembly file being processed, trimmed and not null terminated.
+ * @param length: Length of the line.
+ * @param macros: Pointer to the macro table.
+ * @param as: Text buffer holding the original assembly file.
+ * @param am: Text buffer that receives the expanded source.
  * @param fileNameAs: Name of the modified assembly file.
  * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-int handle_line(char* curLine, ptr *h, FILE *as, FILE *am, char* fileNameAs) {
-  char* macro = calloc(BUFFER, sizeof(char)); /*note to self check for memory*/
-  char* macroName = malloc(MAX_LABEL);
-  char* copyCurLine = malloc(strlen(curLine)+1);
+int handle_line(char* curLine, int length, macroList* macros, textBuffer* as, textBuffer* am, char* fileNameAs) {
+  assemblerContext* ctx = macros->ctx;
   ptr returnMacro;
   
-  strcpy(copyCurLine, curLine); /* Make a copy of the current line */
-  
-  /* Check for memory allocation errors */
-  if(macro == NULL || macroName == NULL) {
-    printf("\nFATAL ERROR: Cannot allocate memory\n");
-    return YES;
-  }
-  
   /* Check if the line matches a macro */
-  if ((returnMacro = is_line_macro(curLine, *h))!=NULL) {
-    fprintf(am, "%s\n", returnMacro->macro);
+  if ((returnMacro = is_line_macro(curLine, length, macros))!=NULL) {
+    expand_macro(returnMacro, am);
   }
   
   /* Check if the line defines a new macro */
-  else if (curLine[0] == 'm' && curLine[1] == 'c' && curLine[2] == 'r') {
-    int i;
-    ptr returnMacro;
-    macroName = strtok(curLine, "\040\t");
-    if(macroName == NULL) {
-      printf("\nMissing macro name in line %d: %s in file \"%s\"\n", lineCounterAs, copyCurLine, fileNameAs);
-      return YES;
-    }
-    macroName = strtok(NULL, "\0");
-    if(macroName == NULL) {
-      printf("\nMissing macro name in line %d: %s in file \"%s\"\n", lineCounterAs, copyCurLine, fileNameAs);
+  else if (length >= 3 && curLine[0] == 'm' && curLine[1] == 'c' && curLine[2] == 'r') {
+    lexer lex;
+    token macroName;
+    char name[BUFFER];
+    char* body; /* The body is not copied, the macro keeps where it is in the source */
+    char* bodyEnd;
+    char* bodyLine;
+    int bodyLength;
+    init_lexer(&lex, curLine, length);
+    next_token(&lex, LEX_SPACE, &macroName); /* Skip mcr */
+    if(next_token(&lex, LEX_REST, &macroName) == NO) {
+      report(ctx, "\nMissing macro name in line %d: %.*s in file \"%s\"\n", ctx->lineCounterAs, length, curLine, fileNameAs);
       return YES;
     }
-    if(is_valid_word(macroName) == NO) {
-      printf("\n\"%s\" is not a valid macro name in line %d: %s in file \"%s\"\n", macroName, lineCounterAs, copyCurLine, fileNameAs);
+    if(is_valid_word(token_text(&macroName, name)) == NO) {
+      report(ctx, "\n\"%s\" is not a valid macro name in line %d: %.*s in file \"%s\"\n", name, ctx->lineCounterAs, length, curLine, fileNameAs);
       return YES;
     }
-    returnMacro = add2list(&h, macroName);
-    while((fgets(curLine, BUFFER-1, as) != NULL)) {
-      if(curLine[0] == ';') continue; /*Check for comment*/
-      if (curLine[strlen(curLine) - 1] != '\n') {
-        printf("\n\"%s\" Line length exceeded maximum allowed length (80) in line %d: %s in file \"%s\"\n", curLine, lineCounterAs, copyCurLine, fileNameAs);
+    returnMacro = add2list(macros, name);
+    body = bodyEnd = as->text + as->position;
+    while((bodyLine = next_line(as, BUFFER-1, &bodyLength)) != NULL) {
+      if(bodyLine[0] == ';') continue; /*Check for comment*/
+      if (bodyLine[bodyLength - 1] != '\n') {
+        report(ctx, "\n\"%.*s\" Line length exceeded maximum allowed length (80) in line %d: %.*s in file \"%s\"\n", bodyLength, bodyLine, ctx->lineCounterAs, length, curLine, fileNameAs);
         return YES;
       }
-      if (strcmp(curLine, "\n") == 0) continue; /*Check for empty line*/
-      for(i = 0; isspace(curLine[i]); i++) memmove(curLine, curLine + 1, strlen(curLine));
-      for(i = strlen(curLine)-1; isspace(curLine[i]); i--) curLine[strlen(curLine)-1] = '\0';
-      if (strcmp(curLine, "endmcr") == 0) break;
-      strcat(macro, curLine);
-      strcat(macro, "\n");
+      if (bodyLength == 1) continue; /*Check for empty line*/
+      bodyLine = trim_line(bodyLine, &bodyLength);
+      if (bodyLength == 6 && strncmp(bodyLine, "endmcr", 6) == 0) break;
+      bodyEnd = as->text + as->position;
     }
-    macro[strlen(macro)-1] = '\0';
-    addMacro(&returnMacro, macro);
+    addMacro(&returnMacro, body, bodyEnd - body);
   }
   
-  else { /* No macro found, copy the line to the output file */
-    fprintf(am, "%s\n", curLine);
+  else { /* No macro found, pass the line on */
+    append_line(am, curLine, length);
   }
   return NO;
 }
 
+/******************************************************
+ * Function: expand_macro
+ * Description: Appends the lines of a macro body to the expanded source, read from the
+ *		source again the way its definition read them: comments and empty lines are
+ *		skipped and every line is trimmed.
+ * 
+ * @param macro: Pointer to the node of the macro.
+ * @param am: Text buffer that receives the expanded source.
+ ******************************************************/
+void expand_macro(ptr macro, textBuffer* am) {
+  textBuffer body; /* Reads the span without moving the position in the source */
+  char* line;
+  int length;
+  int lines = 0;
+  
+  body.text = macro->macro;
+  body.length = macro->length;
+  body.capacity = macro->length;
+  body.position = 0;
+  body.memory = NULL;
+  while((line = next_line(&body, BUFFER-1, &length)) != NULL) {
+    if(line[0] == ';' || length == 1) continue; /*Check for comment or empty line*/
+    line = trim_line(line, &length);
+    append_line(am, line, length);
+    lines++;
+  }
+  if(lines == 0) append_line(am, "", 0); /* An empty macro still expands to an empty line */
+}
+
 /******************************************************
  * Function: is_line_macro
  * Description: Checks if a line from the assembly file corresponds to a defined macro.
  * 
- * @param line: Line from the assembly file being checked.
- * @param h: Pointer to the head of the macro linked list.
+ * @param line: Line from the assembly file being checked, not null terminated.
+ * @param length: Length of the line.
+ * @param macros: Pointer to the macro table.
  * @return: Pointer to the node containing the macro if found, otherwise NULL.
  ******************************************************/
-ptr is_line_macro(char* line, ptr h) {
-  while(h) {
-    if(strcmp(line, h->macroName) == 0) break;
-    h=h->next;
+ptr is_line_macro(char* line, int length, macroList* macros) {
+  unsigned long hash = hash_text(line, length);
+  unsigned long i = hash & (macros->capacity-1);
+  
+  COUNT_LOOKUP(macros->lookups);
+  /* Probe until the macro or an empty slot is found */
+  while(macros->slots[i] != NULL) {
+    ptr p = macros->slots[i];
+    if(p->hash == hash && p->nameLength == length && memcmp(line, p->macroName, length) == 0) return p;
+    i = (i+1) & (macros->capacity-1);
   }
-  return h;
+  return NULL;
 }
 
 /******************************************************
  * Function: add2list
- * Description: Adds a macro name to the macro linked list.
+ * Description: Adds a macro name to the macro table.
  * 
- * @param hptr: Pointer to the pointer to the head of the macro linked list.
+ * @param macros: Pointer to the macro table.
  * @param macroName: Name of the macro to be added.
  * @return: Pointer to the newly added node.
  ******************************************************/
-ptr add2list(ptr **hptr, char* macroName) {
-  ptr t = (ptr) malloc(sizeof(item)); /*Create a new item in a linked list*/
-  ptr p1, p2;
-
-  if(t==NULL) {
-    printf("\nFATAL ERROR: Cannot allocate memory\n");
-    exit(0);
-  }
+ptr add2list(macroList* macros, char* macroName) {
+  ptr t = (ptr) arena_alloc(&macros->ctx->memory, sizeof(item)); /*Create a new item in the table*/
+  unsigned long i;
   
-  t->macroName = malloc(strlen(macroName)+1);
-  strcpy(t->macroName, macroName);
+  t->macroName = arena_strdup(&macros->ctx->memory, macroName);
+  t->nameLength = strlen(macroName);
+  t->hash = hash_text(macroName, t->nameLength);
+  t->macro = NULL;
+  t->length = 0;
   
-  p1 = **hptr;
-  while ((p1)) {
-    p2 = p1;
-    p1 = p1->next;
-  }
+  /* Keep the load factor under 1/2 */
+  if(2*(macros->count+1) > macros->capacity) grow_macro_table(macros);
   
-  if (p1 == **hptr) { 
-    **hptr = t;
-    t->next = p1;
+  /* A repeated name keeps expanding to its first definition */
+  i = t->hash & (macros->capacity-1);
+  while(macros->slots[i] != NULL) {
+    if(macros->slots[i]->hash == t->hash && strcmp(macroName, macros->slots[i]->macroName) == 0) return t;
+    i = (i+1) & (macros->capacity-1);
   }
-  
-  else {
-    p2->next = t;
-    t->next = p1;
-  }
-  
+  macros->slots[i] = t;
+  macros->count++;
   return t;
 }
 
 /******************************************************
- * Function: addMacro
- * Description: Adds macro content to the corresponding node in the macro linked list.
+ * Function: grow_macro_table
+ * Description: Doubles the number of slots and re-inserts
+ *		the macros.
  * 
- * @param hptr: Pointer to the node in the macro linked list.
- * @param macro: Content of the macro to be added.
+ * @param macros: Pointer to the macro table.
  ******************************************************/
-void addMacro(ptr *hptr, char* macro) {
-  (*hptr)->macro = malloc(strlen(macro)+1);
-  strcpy((*hptr)->macro, macro);
+void grow_macro_table(macroList* macros) {
+  unsigned long capacity = macros->capacity*2;
+  ptr* slots = (ptr*) arena_alloc(&macros->ctx->memory, capacity*sizeof(ptr)); /*The old slots are left to the arena*/
+  ptr p;
+  unsigned long i;
+  
+  memset(slots, 0, capacity*sizeof(ptr));
+  for(i = 0; i < macros->capacity; i++) {
+    unsigned long j;
+    if((p = macros->slots[i]) == NULL) continue;
+    j = p->hash & (capacity-1);
+    while(slots[j] != NULL) j = (j+1) & (capacity-1);
+    slots[j] = p;
+  }
+  
+  macros->slots = slots;
+  macros->capacity = capacity;
 }
 
 /******************************************************
- * Function: freelist
- * Description: Frees allocated memory of the macro linked list.
+ * Function: addMacro
+ * Description: Adds macro content to the corresponding node in the macro table.
  * 
- * @param hptr: Pointer to the pointer to the head of the macro linked list.
+ * @param hptr: Pointer to the node in the macro table.
+ * @param macro: Start of the body of the macro in the source, which outlives the table.
+ * @param length: Length of the body, up to the line of its endmcr.
  ******************************************************/
-void freelist(ptr * hptr) {
-  ptr p;
-  
-  /*Parse the linked list and free each item and its content*/
-  while(*hptr) { 
-    p = *hptr;
-    *hptr = (*hptr)->next;
-    free(p);
-  }
+void addMacro(ptr *hptr, char* macro, size_t length) {
+  (*hptr)->macro = macro;
+  (*hptr)->length = length;
 }
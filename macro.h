@@ -1,10 +1,11 @@
 /******************************************************
  * Function: pre_processor
- * Description: Preprocesses the assembly file, handling macros and generating a modified assembly file.
+ * Description: Preprocesses the assembly file, handling macros and passing the expanded lines to the first pass.
  * 
- * @param as: Pointer to the original assembly file.
- * @param fileNameAm: Name of the macro file to be generated.
+ * @param as: Text buffer holding the original assembly file.
+ * @param am: Text buffer that receives the expanded source.
  * @param fileNameAs: Name of the modified assembly file to be generated.
+ * @param ctx: Context of the file.
  * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-int pre_processor (FILE *as, char* fileNameAm, char* fileNameAs);
+int pre_processor (textBuffer* as, textBuffer* am, char* fileNameAs, assemblerContext* ctx);
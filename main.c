@@ -1,62 +1,290 @@
 /******************************************************
  * File: main.c
- * Description: This program is the entry point for the 
- *              assembler. It reads input files provided 
- *              as command-line arguments, processes 
+ * Description: This program is the entry point for the
+ *              assembler. It reads input files provided
+ *              as command-line arguments, processes
  *              them, and performs the pre-processor
  *		as well as thefirst pass of the
- *              assembly.
+ *              assembly. The expanded source is passed
+ *		to the first pass in memory, --emit-am
+ *		also writes it to the .am file. With -j N the files are
+ *		assembled by N worker threads, their
+ *		diagnostics are still printed in order.
+ *		With --cache=DIR files that did not change
+ *		are restored from the cache directory.
+ *		--format=bin exports a binary .bin file instead
+ *		of the .ob, .ent and .ext files.
+ *		--serve=SOCKET keeps the assembler resident
+ *		for clients started with --client=SOCKET.
+ *		--stats prints the time, the lines and the
+ *		lookups of every phase of every file to the
+ *		standard error, with the words the optimizers
+ *		saved, --stats=json as JSON lines.
+ *		Only files assembled by this process are
+ *		measured, not the ones sent to a server.
+ *		--split=N runs the passes over each large
+ *		file on up to N threads, with the same output.
+ *		-O removes the instructions that change
+ *		nothing before the second pass, -Os also moves
+ *		the instruction sequences that repeat to
+ *		subroutines and merges the data like
+ *		--merge-data, which lets data labels whose
+ *		words repeat share them.
  ******************************************************/
- 
+
 #include "universal.h"
-#include "macro.h"
-#include "firsttrans.h"
-#include "textToBinary.h"
+#include "context.h"
+#include "errorTreatment.h"
+#include "exportFiles.h"
+#include "assembleFile.h"
+#include "cache.h"
+#include "server.h"
+#include "stats.h"
+#include <pthread.h>
+
+/* Files shared by the worker threads */
+typedef struct workerPool {
+  assemblerContext* files;
+  int count;
+  int next; /* Index of the next file to be assembled */
+  int* done; /* Files whose report can be printed */
+  pthread_mutex_t lock;
+  pthread_cond_t finished;
+} workerPool;
+
+void* worker(void* arg);
+void assemble_parallel(assemblerContext* files, int count, int jobs);
 
 /******************************************************
  * Function: main
  * Description: The entry point of the assembler,
  *		recieves file names from the command line.
- * 
+ *
  * @param argc: The number of command-line arguments.
  * @param argv: An array of pointers to the arguments.
  * @return 0 (If there are errors they will be printed but will not terminate)
  ******************************************************/
 int main (int argc, char* argv[]) {
   int i;
-  FILE *as;
-  FILE *am;
-  
-  /*Check if at least one file is provided*/
-  if(argc<2) {
-    printf("\nYou didn't enter a file to be read\n");
+  assemblerOptions options;
+  int count = 0;
+  char* serveSocket = NULL;
+  char* clientSocket = NULL;
+  assemblerStats* stats = NULL;
+  assemblerContext* files = (assemblerContext*) malloc(argc*sizeof(assemblerContext));
+
+  if(files == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
     exit(0);
   }
-  
-  /*Process each input file*/
+
+  options.jobs = 1;
+  options.emitAm = NO;
+  options.format = FORMAT_TEXT;
+  options.cacheDir = NULL;
+  options.cacheBudget = DEFAULT_CACHE_BUDGET;
+  options.stats = STATS_OFF;
+  options.split = 1;
+  options.optimize = 0;
+
+  /*Separate the options from the file names*/
   for (i = 1; i<argc; i++) {
-    char fileNameAs[BUFFER];
-    char fileNameAm[BUFFER];
-    strcpy(fileNameAs, argv[i]);
-    strcpy(fileNameAm, argv[i]);
-    strcat(fileNameAm, ".am");
-    strcat(fileNameAs, ".as");
-    
-    /*Open the .as file for reading*/
-    if (!(as = fopen(fileNameAs, "r"))) {
-      printf("\nFATAL ERROR: Cannot open file \"%s\"\n", fileNameAs);
+    if(strcmp(argv[i], "--emit-am") == 0) {
+      options.emitAm = YES;
+      continue;
+    }
+    if(strncmp(argv[i], "--format=", 9) == 0) {
+      if(strcmp(argv[i]+9, "bin") == 0) options.format = FORMAT_BIN;
+      else if(strcmp(argv[i]+9, "text") == 0) options.format = FORMAT_TEXT;
+      else {
+        printf("\nUnknown format in \"%s\", expected text or bin\n", argv[i]);
+        exit(0);
+      }
+      continue;
+    }
+    if(strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=text") == 0) {
+      options.stats = STATS_TEXT;
+      continue;
+    }
+    if(strcmp(argv[i], "--stats=json") == 0) {
+      options.stats = STATS_JSON;
+      continue;
+    }
+    if(strncmp(argv[i], "--cache=", 8) == 0) {
+      if(argv[i][8] == '\0') {
+        printf("\nMissing cache directory in \"%s\"\n", argv[i]);
+        exit(0);
+      }
+      options.cacheDir = argv[i]+8;
       continue;
     }
-    
-    if(pre_processor(as, fileNameAm, fileNameAs) == YES) { /*Perform preprocessing and generate the .am file*/
-      printf("\nErrors detected in pre processor, output files will not be created\n"); 
+    if(strncmp(argv[i], "--cache-size=", 13) == 0) {
+      if(is_number(argv[i]+13) == NO || atol(argv[i]+13) < 1) {
+        printf("\nInvalid cache size in \"%s\"\n", argv[i]);
+        exit(0);
+      }
+      options.cacheBudget = atol(argv[i]+13)*1024*1024;
       continue;
     }
-    else {
-      am = fopen(fileNameAm, "r"); /*Open the .am file for reading*/
-      firsttrans(am, fileNameAm); /*Execute the first parsing of the code*/
-      fclose(am);
+    if(strncmp(argv[i], "--serve=", 8) == 0 || strncmp(argv[i], "--client=", 9) == 0) {
+      char* value = strchr(argv[i], '=')+1;
+      if(*value == '\0') {
+        printf("\nMissing socket in \"%s\"\n", argv[i]);
+        exit(0);
+      }
+      if(argv[i][2] == 's') serveSocket = value;
+      else clientSocket = value;
+      continue;
+    }
+    if(strncmp(argv[i], "--split=", 8) == 0) {
+      if(is_number(argv[i]+8) == NO || (options.split = atoi(argv[i]+8)) < 1) {
+        printf("\nInvalid number of threads in \"%s\"\n", argv[i]);
+        exit(0);
+      }
+      continue;
+    }
+    if(strcmp(argv[i], "-O") == 0) {
+      options.optimize |= OPTIMIZE_PEEPHOLE;
+      continue;
+    }
+    if(strcmp(argv[i], "-Os") == 0) {
+      options.optimize |= OPTIMIZE_PEEPHOLE|OPTIMIZE_OUTLINE|OPTIMIZE_DATA;
+      continue;
+    }
+    if(strcmp(argv[i], "--merge-data") == 0) {
+      options.optimize |= OPTIMIZE_DATA;
+      continue;
+    }
+    if(strncmp(argv[i], "-j", 2) == 0) {
+      char* value = argv[i][2] != '\0' ? argv[i]+2 : (i+1 < argc ? argv[++i] : NULL);
+      if(value == NULL || *value == '\0' || is_number(value) == NO || (options.jobs = atoi(value)) < 1) {
+        printf("\nInvalid number of jobs in \"%s\"\n", argv[i]);
+        exit(0);
+      }
+      continue;
+    }
+    init_context(&files[count++], argv[i], &options);
+  }
+
+  /*Check if at least one file is provided*/
+  if(count == 0 && serveSocket == NULL) {
+    printf("\nYou didn't enter a file to be read\n");
+    exit(0);
+  }
+
+  /*The server assembles the files, this process only waits for its reply*/
+  if(clientSocket != NULL && serveSocket == NULL && run_client(clientSocket, files, count, &options) == NO) {
+    free(files);
+    return 0;
+  }
+
+  init_encryption(); /*Shared by all the files, filled before any thread starts*/
+  if(options.cacheDir != NULL) init_cache(&options);
+  if(serveSocket != NULL) {
+    serve(serveSocket, &options); /*Only returns if the socket cannot be used*/
+    free(files);
+    return 0;
+  }
+  if(options.stats != STATS_OFF) {
+    if((stats = (assemblerStats*) malloc(count*sizeof(assemblerStats))) == NULL) {
+      printf("\nFATAL ERROR: Cannot allocate memory\n");
+      exit(0);
+    }
+    for (i = 0; i<count; i++) {
+      init_stats(&stats[i]);
+      files[i].stats = &stats[i];
+    }
+  }
+  if(options.jobs > count) options.jobs = count;
+  if(options.jobs > 1) assemble_parallel(files, count, options.jobs);
+  else {
+    /*Process each input file*/
+    for (i = 0; i<count; i++) {
+      assemble_file(&files[i]);
+      flush_report(&files[i]);
+      if(files[i].stats != NULL) print_stats(&files[i]);
+    }
+  }
+  /*Only new entries can take the cache over its budget*/
+  for (i = 0; i<count && options.cacheDir != NULL; i++) {
+    if(files[i].isStored == YES) {
+      evict_cache(&options);
+      break;
     }
   }
+  free(stats);
+  free(files);
   return 0;
 }
+
+/******************************************************
+ * Function: worker
+ * Description: Takes files from the pool and assembles them until none are left.
+ *
+ * @param arg: Pointer to the worker pool.
+ * @return NULL.
+ ******************************************************/
+void* worker(void* arg) {
+  workerPool* pool = (workerPool*) arg;
+  int i;
+
+  while(1) {
+    pthread_mutex_lock(&pool->lock);
+    i = pool->next < pool->count ? pool->next++ : -1;
+    pthread_mutex_unlock(&pool->lock);
+    if(i == -1) return NULL;
+
+    assemble_file(&pool->files[i]);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->done[i] = YES;
+    pthread_cond_broadcast(&pool->finished);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+/******************************************************
+ * Function: assemble_parallel
+ * Description: Assembles the files on a pool of threads. The calling
+ *		thread prints each report as soon as it and every report
+ *		before it are ready, so the output matches a sequential run.
+ *
+ * @param files: Contexts of the files, in command-line order.
+ * @param count: Number of files.
+ * @param jobs: Number of worker threads.
+ ******************************************************/
+void assemble_parallel(assemblerContext* files, int count, int jobs) {
+  workerPool pool;
+  pthread_t* threads = (pthread_t*) malloc(jobs*sizeof(pthread_t));
+  int started = 0;
+  int i;
+
+  pool.files = files;
+  pool.count = count;
+  pool.next = 0;
+  pool.done = (int*) calloc(count, sizeof(int));
+  if(threads == NULL || pool.done == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_cond_init(&pool.finished, NULL);
+
+  while(started < jobs && pthread_create(&threads[started], NULL, worker, &pool) == 0) started++;
+  if(started == 0) worker(&pool); /* No thread could be created, assemble everything here */
+
+  /* Print the reports in command-line order */
+  for(i = 0; i < count; i++) {
+    pthread_mutex_lock(&pool.lock);
+    while(pool.done[i] != YES) pthread_cond_wait(&pool.finished, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+    flush_report(&files[i]);
+    if(files[i].stats != NULL) print_stats(&files[i]);
+  }
+
+  for(i = 0; i < started; i++) pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&pool.lock);
+  pthread_cond_destroy(&pool.finished);
+  free(pool.done);
+  free(threads);
+}
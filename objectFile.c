@@ -0,0 +1,179 @@
+/******************************************************
+ * File: objectFile.c
+ * Description: This file reads back the .ob files the
+ *              assembler exports: the IC and DC line,
+ *              then a line per word with its address
+ *              and its 7 base 4 characters. Files that
+ *              end with .bin are read in the binary
+ *              format of --format=bin instead.
+ ******************************************************/
+
+#include "universal.h"
+
+int load_binary(char* fileName, objectImage* image);
+unsigned long get_binary(unsigned char* input, int bytes);
+int decode_word(char* encrypted, machineWord* word);
+void free_object(objectImage* image);
+
+/******************************************************
+ * Function: load_object
+ * Description: Reads an .ob or a .bin file into an object image.
+ *
+ * @param fileName: Name of the .ob or .bin file.
+ * @param image: Pointer to the object image to fill.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int load_object(char* fileName, objectImage* image) {
+  FILE* file;
+  char line[BUFFER];
+  char encrypted[BUFFER];
+  int i, address;
+
+  image->words = NULL;
+  if(strlen(fileName) > 4 && strcmp(fileName+strlen(fileName)-4, ".bin") == 0) {
+    return load_binary(fileName, image);
+  }
+  if((file = fopen(fileName, "r")) == NULL) {
+    printf("\nCannot open file \"%s\"\n", fileName);
+    return YES;
+  }
+
+  /* The header holds the number of code and data words */
+  if(fgets(line, BUFFER, file) == NULL || sscanf(line, "%d %d", &image->IC, &image->DC) != 2 ||
+     image->IC < 0 || image->DC < 0 || image->IC+image->DC > MAX_PROGRAM) {
+    printf("\nInvalid header in file \"%s\"\n", fileName);
+    fclose(file);
+    return YES;
+  }
+  if((image->words = (machineWord*) malloc((image->IC+image->DC+1)*sizeof(machineWord))) == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+
+  /* Every word is at the address after the previous one */
+  for(i = 0; i < image->IC+image->DC; i++) {
+    if(fgets(line, BUFFER, file) == NULL) {
+      printf("\nFile \"%s\" ends after %d of its %d words\n", fileName, i, image->IC+image->DC);
+      break;
+    }
+    if(sscanf(line, "%d %s", &address, encrypted) != 2 || address != FIRST_ADDRESS+i || decode_word(encrypted, &image->words[i]) == YES) {
+      printf("\nInvalid word at address %04d in file \"%s\"\n", FIRST_ADDRESS+i, fileName);
+      break;
+    }
+  }
+  fclose(file);
+  if(i < image->IC+image->DC) {
+    free_object(image);
+    return YES;
+  }
+  return NO;
+}
+
+/******************************************************
+ * Function: load_binary
+ * Description: Reads a .bin file into an object image. Only the header and the
+ *		words are used, the symbols and relocations are left for other tools.
+ *
+ * @param fileName: Name of the .bin file.
+ * @param image: Pointer to the object image to fill.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int load_binary(char* fileName, objectImage* image) {
+  FILE* file = fopen(fileName, "rb");
+  unsigned char header[BIN_HEADER];
+  unsigned char* words;
+  unsigned long code, data;
+  long size;
+  int i;
+
+  if(file == NULL) {
+    printf("\nCannot open file \"%s\"\n", fileName);
+    return YES;
+  }
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  rewind(file);
+
+  /* The sections of the words must be inside the file */
+  if(size < BIN_HEADER || fread(header, 1, BIN_HEADER, file) != BIN_HEADER || memcmp(header, BIN_MAGIC, 4) != 0 ||
+     get_binary(header+4, 2) != BIN_VERSION || get_binary(header+6, 2) != BIN_HEADER) {
+    printf("\nInvalid header in file \"%s\"\n", fileName);
+    fclose(file);
+    return YES;
+  }
+  image->IC = (int) get_binary(header+8, 2);
+  image->DC = (int) get_binary(header+10, 2);
+  code = get_binary(header+12, 4);
+  data = get_binary(header+16, 4);
+  if(image->IC+image->DC > MAX_PROGRAM || code < BIN_HEADER || code+image->IC*2 > (unsigned long) size ||
+     data < BIN_HEADER || data+image->DC*2 > (unsigned long) size) {
+    printf("\nInvalid header in file \"%s\"\n", fileName);
+    fclose(file);
+    return YES;
+  }
+
+  if((words = (unsigned char*) malloc(size)) == NULL || (image->words = (machineWord*) malloc((image->IC+image->DC+1)*sizeof(machineWord))) == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+  rewind(file);
+  if(fread(words, 1, size, file) != (size_t) size) {
+    printf("\nCannot read file \"%s\"\n", fileName);
+    free(words);
+    free_object(image);
+    fclose(file);
+    return YES;
+  }
+  fclose(file);
+  for(i = 0; i < image->IC; i++) image->words[i] = (machineWord) (get_binary(words+code+2*i, 2) & WORD_MASK);
+  for(i = 0; i < image->DC; i++) image->words[image->IC+i] = (machineWord) (get_binary(words+data+2*i, 2) & WORD_MASK);
+  free(words);
+  return NO;
+}
+
+/******************************************************
+ * Function: get_binary
+ * Description: Reads an unsigned little-endian number.
+ *
+ * @param input: Where the number is stored.
+ * @param bytes: Number of bytes it takes.
+ * @return: The number.
+ ******************************************************/
+unsigned long get_binary(unsigned char* input, int bytes) {
+  unsigned long value = 0;
+  while(bytes-- > 0) value = (value << 8) | input[bytes];
+  return value;
+}
+
+/******************************************************
+ * Function: decode_word
+ * Description: Converts the base 4 characters of a machine word back to the word.
+ *
+ * @param encrypted: The characters of the word, null terminated.
+ * @param word: Where the word is stored.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int decode_word(char* encrypted, machineWord* word) {
+  const char* digits = "*#%!"; /* 00, 01, 10 and 11 */
+  char* digit;
+  int i;
+
+  if(strlen(encrypted) != ENCRYPTED_WORD) return YES;
+  *word = 0;
+  for(i = 0; i < ENCRYPTED_WORD; i++) {
+    if((digit = strchr(digits, encrypted[i])) == NULL) return YES;
+    *word = (machineWord) ((*word << 2) | (digit-digits));
+  }
+  return NO;
+}
+
+/******************************************************
+ * Function: free_object
+ * Description: Frees the words of an object image.
+ *
+ * @param image: Pointer to the object image.
+ ******************************************************/
+void free_object(objectImage* image) {
+  free(image->words);
+  image->words = NULL;
+}
@@ -0,0 +1,16 @@
+/******************************************************
+ * Function: load_object
+ * Description: Reads an .ob or a .bin file into an object image.
+ *
+ * @param fileName: Name of the .ob or .bin file.
+ * @param image: Pointer to the object image to fill.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int load_object(char* fileName, objectImage* image);
+/******************************************************
+ * Function: free_object
+ * Description: Frees the words of an object image.
+ *
+ * @param image: Pointer to the object image.
+ ******************************************************/
+void free_object(objectImage* image);
@@ -1,11 +1,113 @@
 /******************************************************
  * File: operations.c
- * Description: This file contains a function to detect
- *              the opcode index based on the input string.
+ * Description: This file contains functions to detect
+ *              the opcode index and the other reserved
+ *              words based on the input string.
  ******************************************************/
  
 #include "universal.h"
 
+/* The reserved words, indexed by their WORD_ code (opcodes first) */
+const char* reservedWords[RESERVED_WORDS] = {"mov", "cmp", "add", "sub", "not", "clr", "lea", "inc", "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "hlt",
+  "mcr", "endmcr", ".data", ".string", ".entry", ".extern", ".define", "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7"};
+
+/* Masks of the legal addressing modes */
+#define ANY_MODE (MODE_BIT(IMMEDIATE)|MODE_BIT(DIRECT)|MODE_BIT(INDEX)|MODE_BIT(DIRECT_REGISTER))
+#define WRITABLE (MODE_BIT(DIRECT)|MODE_BIT(INDEX)|MODE_BIT(DIRECT_REGISTER))
+#define LABEL (MODE_BIT(DIRECT)|MODE_BIT(INDEX))
+
+/* Words of an instruction, registers share a single word when both operands are registers */
+#define OPERAND_WORDS(mode) ((mode) == INDEX ? 2 : 1)
+#define IS_LEGAL(modes, mode) (((modes) & MODE_BIT(mode)) != 0)
+#define LENGTH(operands, sources, destinations, source, destination) \
+  ((operands) == 0 ? ((source) == 0 && (destination) == 0 ? 1 : 0) : \
+   (operands) == 1 ? ((source) == 0 && IS_LEGAL(destinations, destination) ? 1+OPERAND_WORDS(destination) : 0) : \
+   !IS_LEGAL(sources, source) || !IS_LEGAL(destinations, destination) ? 0 : \
+   (source) == DIRECT_REGISTER && (destination) == DIRECT_REGISTER ? 2 : 1+OPERAND_WORDS(source)+OPERAND_WORDS(destination))
+#define LENGTHS(operands, sources, destinations, source) \
+  {LENGTH(operands, sources, destinations, source, 0), LENGTH(operands, sources, destinations, source, 1), \
+   LENGTH(operands, sources, destinations, source, 2), LENGTH(operands, sources, destinations, source, 3)}
+
+/* The first word: opcode in bits 9-6, source mode in bits 5-4, destination mode in bits 3-2, A in bits 1-0 */
+#define FIRST_WORD(opcode, source, destination) (((opcode) << 6) | ((source) << 4) | ((destination) << 2))
+#define FIRST_WORDS(opcode, source) \
+  {FIRST_WORD(opcode, source, 0), FIRST_WORD(opcode, source, 1), FIRST_WORD(opcode, source, 2), FIRST_WORD(opcode, source, 3)}
+
+#define OPCODE_INFO(opcode, operands, sources, destinations) {operands, sources, destinations, \
+  {LENGTHS(operands, sources, destinations, 0), LENGTHS(operands, sources, destinations, 1), \
+   LENGTHS(operands, sources, destinations, 2), LENGTHS(operands, sources, destinations, 3)}, \
+  {FIRST_WORDS(opcode, 0), FIRST_WORDS(opcode, 1), FIRST_WORDS(opcode, 2), FIRST_WORDS(opcode, 3)}}
+
+/* What both passes know of every opcode, in the order of reservedWords */
+const opcodeInfo opcodeTable[OPCODE] = {
+  OPCODE_INFO(0, 2, ANY_MODE, WRITABLE), /* mov */
+  OPCODE_INFO(1, 2, ANY_MODE, ANY_MODE), /* cmp */
+  OPCODE_INFO(2, 2, ANY_MODE, WRITABLE), /* add */
+  OPCODE_INFO(3, 2, ANY_MODE, WRITABLE), /* sub */
+  OPCODE_INFO(4, 1, 0, WRITABLE), /* not */
+  OPCODE_INFO(5, 1, 0, WRITABLE), /* clr */
+  OPCODE_INFO(6, 2, LABEL, WRITABLE), /* lea */
+  OPCODE_INFO(7, 1, 0, WRITABLE), /* inc */
+  OPCODE_INFO(8, 1, 0, WRITABLE), /* dec */
+  OPCODE_INFO(9, 1, 0, WRITABLE), /* jmp */
+  OPCODE_INFO(10, 1, 0, WRITABLE), /* bne */
+  OPCODE_INFO(11, 1, 0, WRITABLE), /* red */
+  OPCODE_INFO(12, 1, 0, ANY_MODE), /* prn */
+  OPCODE_INFO(13, 1, 0, WRITABLE), /* jsr */
+  OPCODE_INFO(14, 0, 0, 0), /* rts */
+  OPCODE_INFO(15, 0, 0, 0) /* hlt */
+};
+
+/******************************************************
+ * Function: classify_word
+ * Description: Detects which reserved word a string is. The length and at most
+ *		two characters select the only candidate, which is then
+ *		compared once.
+ * 
+ * @param word: The string, it does not have to be null terminated.
+ * @param length: Length of the string.
+ * @return The opcode (0-15), the WORD_ code of another reserved word, or -1 if it is not reserved.
+ ******************************************************/
+int classify_word (char* word, int length) {
+  int candidate = -1;
+  
+  switch(length) {
+    case 2: /* Registers */
+      if(word[0] == 'r' && word[1] >= '0' && word[1] <= '7') return WORD_REGISTER + word[1] - '0';
+      return -1;
+    case 3: /* Opcodes and mcr */
+      switch(word[0]) {
+        case 'm': candidate = word[1] == 'o' ? 0 : WORD_MCR; break;
+        case 'c': candidate = word[1] == 'm' ? 1 : 5; break;
+        case 'a': candidate = 2; break;
+        case 's': candidate = 3; break;
+        case 'n': candidate = 4; break;
+        case 'l': candidate = 6; break;
+        case 'i': candidate = 7; break;
+        case 'd': candidate = 8; break;
+        case 'j': candidate = word[1] == 'm' ? 9 : 13; break;
+        case 'b': candidate = 10; break;
+        case 'r': candidate = word[1] == 'e' ? 11 : 14; break;
+        case 'p': candidate = 12; break;
+        case 'h': candidate = 15; break;
+      }
+      break;
+    case 5:
+      candidate = WORD_DATA;
+      break;
+    case 6:
+      candidate = word[0] == 'e' ? WORD_ENDMCR : WORD_ENTRY;
+      break;
+    case 7:
+      if(word[1] == 's') candidate = WORD_STRING;
+      else if(word[1] == 'e') candidate = WORD_EXTERN;
+      else candidate = WORD_DEFINE;
+      break;
+  }
+  if(candidate != -1 && memcmp(word, reservedWords[candidate], length) == 0) return candidate;
+  return -1;
+}
+
 /******************************************************
  * Function: detect_opcode
  * Description: Detects the opcode index based on the input string.
@@ -14,9 +116,6 @@
  * @return The index of the detected opcode, or -1 if not found.
  ******************************************************/
 int detect_opcode (char* input) {
-  char* opcode[OPCODE] = {"mov", "cmp", "add", "sub", "not", "clr", "lea", "inc", "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "hlt"};
-  int i;
-  for (i = 0; i<OPCODE; i++) /* Compare the input string with each opcode */
-    if(strcmp(opcode[i], input) == 0) return i; /* Return the index if a match is found */
-  return -1; /* Return -1 if no match is found */
+  int word = classify_word(input, strlen(input));
+  return word < OPCODE ? word : -1; /* Other reserved words are not opcodes */
 }
@@ -1,3 +1,14 @@
+/******************************************************
+ * Function: classify_word
+ * Description: Detects which reserved word a string is. The length and at most
+ *		two characters select the only candidate, which is then
+ *		compared once.
+ * 
+ * @param word: The string, it does not have to be null terminated.
+ * @param length: Length of the string.
+ * @return The opcode (0-15), the WORD_ code of another reserved word, or -1 if it is not reserved.
+ ******************************************************/
+int classify_word (char* word, int length);
 /******************************************************
  * Function: detect_opcode
  * Description: Detects the opcode index based on the input string.
@@ -0,0 +1,1037 @@
+/******************************************************
+ * File: optimize.c
+ * Description: This file holds the optimizers of the code
+ *              image. The peephole optimizer (-O)
+ *              which runs between the passes. It decodes the
+ *              instructions of the code image and removes the
+ *              ones that change nothing: a jmp to the next
+ *              instruction, a mov of a register to itself and
+ *              a clr followed by a mov #0 to the same operand.
+ *              A bne to a jmp is sent to the target of the jmp.
+ *              The remaining instructions are then moved
+ *              together and the code labels moved with them,
+ *              before the second pass encodes the operands.
+ *
+ *              With -Os the instruction sequences that repeat
+ *              are then moved to subroutines, each copy
+ *              replaced by a jsr to its subroutine, and the
+ *              data labels whose words repeat share them.
+ *
+ *              Programs that read their own code through a
+ *              code label are left as they are, since moving
+ *              the code would change what they read.
+ ******************************************************/
+
+#include "universal.h"
+#include "symbolTable.h"
+#include "context.h"
+#include "wordImage.h"
+#include "errorTreatment.h"
+#include "arena.h"
+#include "addressingModes.h"
+
+#define MOV 0 /*Opcodes the optimizers look for*/
+#define CMP 1
+#define ADD 2
+#define SUB 3
+#define CLR 5
+#define JMP 9
+#define BNE 10
+#define PRN 12
+#define JSR 13
+#define RTS 14
+#define JSR_WORDS 2 /*Words of a jsr to a label*/
+#define OUTLINE_WORK 2000000L /*Suffixes the search for repeated sequences may walk in a file*/
+#define OUTLINE_LABEL "outline." /*Prefix of the labels of the subroutines, followed by their number*/
+#define OUTLINE_LABEL_SIZE (sizeof(OUTLINE_LABEL) + sizeof(int)*3 + 1) /*The prefix, its null terminator, the sign and at most 3 digits per byte of an int*/
+
+#define PEEPHOLES 4 /*Patterns of the optimizer*/
+#define JMP_NEXT 0 /*jmp to the next instruction*/
+#define MOV_SELF 1 /*mov of a register to itself*/
+#define CLR_MOV 2 /*clr before a mov #0 to the same operand*/
+#define BNE_JMP 3 /*bne to a jmp, retargeted without saving words*/
+
+/* An instruction of the code image, with where its operands are */
+typedef struct decodedInstruction {
+  int start; /*Index of its first word*/
+  int L;
+  int opcode;
+  int source; /*Addressing modes, from its first word*/
+  int destination;
+  int sourceSlot; /*Index of the word of each operand, -1 if it has none*/
+  int destinationSlot;
+  int isRemoved;
+} decodedInstruction;
+
+/* Work arrays of the search for repeated sequences, allocated once per file */
+typedef struct repeatSearch {
+  int* ids; /*Class of every instruction*/
+  int count; /*Number of instructions*/
+  int range; /*Classes shared by instructions, the classes of their own start there*/
+  int* suffixes; /*Suffix array of the classes*/
+  int* ranks; /*Position of every suffix in the suffix array*/
+  int* next; /*Suffixes ordered by their second half, while sorting*/
+  int* lcp; /*Instructions every suffix shares with the one before it in the suffix array*/
+  int* buckets; /*Counts of the counting sorts*/
+  int* stackLength; /*Groups of suffixes that share a prefix, while they are walked*/
+  int* stackFirst;
+  int* positions; /*Copies of the group that is tried*/
+  int* wordsBefore; /*Words of the instructions before every instruction*/
+  int* labelsBefore; /*Instructions with a code label before every instruction*/
+  int* occurrences; /*Copies of the sequence that saves the most so far, from the first*/
+  int occurrenceCount;
+  int length; /*Its instructions*/
+  int saved; /*Words it saves*/
+  long work; /*Suffixes left to walk, the search stops with what it found when there are none*/
+} repeatSearch;
+
+/* Words of the data image from a data label to the next one */
+typedef struct dataRun {
+  int start;
+  int length;
+  int index; /*Position of the run among the runs*/
+  int isPinned; /*Written, its address taken or an entry, it keeps its own words*/
+  int host; /*Run whose last words it shares, -1 for none*/
+} dataRun;
+
+extern const opcodeInfo opcodeTable[OPCODE]; /*Operands, modes, lengths and first words of the opcodes*/
+
+decodedInstruction* decode_code(codeImage* codeImg, int** fixupAt, int** lineAt, assemblerContext* ctx);
+void decode_code_line(decodedInstruction* instruction, codeImage* codeImg, int line);
+ptrFixup operand_fixup(codeImage* codeImg, int* fixupAt, int slot);
+ptrLabel code_label(ptrFixup operand, symbolTable* symbols);
+int is_same_operand(codeImage* codeImg, int* fixupAt, int mode, int slot, int otherSlot);
+int is_resolved(codeImage* codeImg, int* fixupAt, int mode, int slot, symbolTable* symbols);
+int reads_code(codeImage* codeImg, decodedInstruction* instructions, int* fixupAt, symbolTable* symbols);
+void compact_code(codeImage* codeImg, decodedInstruction* instructions, symbolTable* symbols, assemblerContext* ctx);
+void move_labels(symbolTable* symbols, int* newAddress, int words);
+int classify_code(codeImage* codeImg, decodedInstruction* instructions, int* fixupAt, symbolTable* symbols, int* ids, assemblerContext* ctx);
+int is_same_instruction(codeImage* codeImg, int* fixupAt, decodedInstruction* instruction, decodedInstruction* other);
+void init_repeat_search(repeatSearch* search, int count, assemblerContext* ctx);
+int find_repeat(repeatSearch* search);
+void sort_suffixes(repeatSearch* search);
+void try_repeat(repeatSearch* search, int first, int last, int length);
+int compare_positions(const void* a, const void* b);
+void build_subroutines(codeImage* codeImg, decodedInstruction* instructions, int* fixupAt, int* subroutineAt, int* bodies, int* lengths, int subroutines,
+                       symbolTable* symbols, assemblerContext* ctx);
+ptrFixup copy_code_line(codeImage* optimized, codeImage* codeImg, decodedInstruction* instruction, int* fixupAt, int* newAddress, ptrFixup last);
+int compare_fixups(const void* a, const void* b);
+ptrLabel data_label(char* arg, symbolTable* symbols);
+int index_value(char* arg, symbolTable* symbols);
+int compare_runs(const void* a, const void* b);
+
+/******************************************************
+ * Function: optimize_code
+ * Description: Runs the peephole optimizer on the code image, after the first pass.
+ *		The words saved by every pattern are counted in the statistics of --stats.
+ *
+ * @param symbols: Pointer to the symbol table, its code labels are moved with the code.
+ * @param codeImg: Pointer to the code image, with the fixups of the first pass.
+ * @param ctx: Context of the file, its IC is updated.
+ ******************************************************/
+void optimize_code(symbolTable* symbols, codeImage* codeImg, assemblerContext* ctx) {
+  decodedInstruction* instructions;
+  int* fixupAt; /*Index of the fixup of every word, -1 for none*/
+  int* lineAt; /*Index of the instruction starting at every word, -1 for none*/
+  int count[PEEPHOLES] = {0, 0, 0, 0};
+  int saved[PEEPHOLES] = {0, 0, 0, 0};
+  int i;
+
+  if(codeImg->count == 0) return;
+  instructions = decode_code(codeImg, &fixupAt, &lineAt, ctx);
+  if(reads_code(codeImg, instructions, fixupAt, symbols) == YES) return;
+
+  /* Branches first, the jmp they skip may be removed below */
+  for(i = 0; i < codeImg->count; i++) {
+    decodedInstruction* p = &instructions[i];
+    ptrFixup operand;
+    ptrFixup target;
+    ptrLabel label;
+    int line;
+    if(p->opcode != BNE || p->destination != DIRECT) continue;
+    if((label = code_label(operand = operand_fixup(codeImg, fixupAt, p->destinationSlot), symbols)) == NULL) continue;
+    if((line = lineAt[label->data-FIRST_ADDRESS]) == -1 || instructions[line].opcode != JMP || instructions[line].destination != DIRECT) continue;
+    target = operand_fixup(codeImg, fixupAt, instructions[line].destinationSlot);
+    /* Only to a label the second pass resolves, an error stays on the line of the jmp */
+    if(target == NULL || (label = is_label(target->arg, symbols)) == NULL || (label->labelType != CODE && label->labelType != EXTERNAL)) continue;
+    if(strcmp(operand->arg, target->arg) == 0) continue;
+    operand->arg = target->arg;
+    count[BNE_JMP]++;
+  }
+
+  for(i = 0; i < codeImg->count; i++) {
+    decodedInstruction* p = &instructions[i];
+    ptrLabel label;
+    int pattern = -1;
+    if(p->opcode == JMP && p->destination == DIRECT && (label = code_label(operand_fixup(codeImg, fixupAt, p->destinationSlot), symbols)) != NULL &&
+       label->data-FIRST_ADDRESS == p->start+p->L) pattern = JMP_NEXT;
+    else if(p->opcode == MOV && p->source == DIRECT_REGISTER && p->destination == DIRECT_REGISTER &&
+            ((codeImg->words.words[p->sourceSlot] >> 5) & 7) == ((codeImg->words.words[p->sourceSlot] >> 2) & 7)) pattern = MOV_SELF;
+    else if(p->opcode == CLR && i+1 < codeImg->count) {
+      decodedInstruction* next = &instructions[i+1];
+      if(next->opcode == MOV && next->source == IMMEDIATE && fixupAt[next->sourceSlot] == -1 && codeImg->words.words[next->sourceSlot] == 0 &&
+         next->destination == p->destination && is_same_operand(codeImg, fixupAt, p->destination, p->destinationSlot, next->destinationSlot) == YES &&
+         is_resolved(codeImg, fixupAt, p->destination, p->destinationSlot, symbols) == YES) pattern = CLR_MOV; /*An error stays on the line of the clr*/
+    }
+    if(pattern == -1) continue;
+    p->isRemoved = YES;
+    count[pattern]++;
+    saved[pattern] += p->L;
+  }
+
+  if(count[JMP_NEXT] + count[MOV_SELF] + count[CLR_MOV] + count[BNE_JMP] == 0) return;
+  compact_code(codeImg, instructions, symbols, ctx);
+  ADD_STAT(ctx, jmpNextSaved, saved[JMP_NEXT]);
+  ADD_STAT(ctx, movSelfSaved, saved[MOV_SELF]);
+  ADD_STAT(ctx, clrMovSaved, saved[CLR_MOV]);
+  ADD_STAT(ctx, bneRetargeted, count[BNE_JMP]);
+}
+
+/******************************************************
+ * Function: outline_code
+ * Description: Moves instruction sequences that repeat in the code image to subroutines
+ *		at the end of the code, each copy replaced by a jsr to it, as long as that
+ *		saves words. The sequences are found on a suffix array of the instructions,
+ *		the one that saves the most is moved first, then the search starts again.
+ *		A sequence holds no jmp, bne, jsr, rts or hlt, and no code label after its
+ *		first instruction. The search walks at most OUTLINE_WORK suffixes, a very
+ *		large file keeps the repeats it has no time left for. The words saved are
+ *		counted in the statistics of --stats.
+ *
+ * @param symbols: Pointer to the symbol table, its code labels are moved with the code.
+ * @param codeImg: Pointer to the code image, with the fixups of the first pass.
+ * @param ctx: Context of the file, its IC is updated.
+ ******************************************************/
+void outline_code(symbolTable* symbols, codeImage* codeImg, assemblerContext* ctx) {
+  decodedInstruction* instructions;
+  repeatSearch search;
+  int* fixupAt; /*Index of the fixup of every word, -1 for none*/
+  int* lineAt; /*Index of the instruction starting at every word, -1 for none*/
+  int* subroutineAt; /*Subroutine of the first instruction of every copy, -1 for none*/
+  int* bodies; /*First instruction of the sequence of every subroutine*/
+  int* lengths; /*Instructions of the sequence of every subroutine*/
+  int n = codeImg->count;
+  int words = codeImg->words.count;
+  int subroutines = 0;
+  int copies = 0;
+  int saved = 0;
+  ptrLabel label;
+  int i, j;
+
+  if(n < 2) return;
+  instructions = decode_code(codeImg, &fixupAt, &lineAt, ctx);
+  if(reads_code(codeImg, instructions, fixupAt, symbols) == YES) return;
+  init_repeat_search(&search, n, ctx);
+  subroutineAt = (int*) arena_alloc(&ctx->memory, n*sizeof(int));
+  bodies = (int*) arena_alloc(&ctx->memory, n*sizeof(int));
+  lengths = (int*) arena_alloc(&ctx->memory, n*sizeof(int));
+  search.range = classify_code(codeImg, instructions, fixupAt, symbols, search.ids, ctx);
+  for(i = 0; i < n; i++) {
+    subroutineAt[i] = -1;
+    search.wordsBefore[i+1] = search.wordsBefore[i] + instructions[i].L;
+  }
+  for(label = symbols->head; label != NULL; label = label->next)
+    if(label->labelType == CODE && label->data-FIRST_ADDRESS >= 0 && label->data-FIRST_ADDRESS < words && lineAt[label->data-FIRST_ADDRESS] != -1)
+      search.labelsBefore[lineAt[label->data-FIRST_ADDRESS]+1] = 1;
+  for(i = 0; i < n; i++) search.labelsBefore[i+1] += search.labelsBefore[i];
+
+  while(find_repeat(&search) == YES) {
+    bodies[subroutines] = search.occurrences[0];
+    lengths[subroutines] = search.length;
+    for(i = 0; i < search.occurrenceCount; i++) {
+      subroutineAt[search.occurrences[i]] = subroutines;
+      /* Every instruction of a copy becomes unlike any other */
+      for(j = search.occurrences[i]; j < search.occurrences[i]+search.length; j++) search.ids[j] = search.range + j;
+    }
+    saved += search.saved;
+    copies += search.occurrenceCount;
+    subroutines++;
+  }
+  if(subroutines == 0) return;
+  build_subroutines(codeImg, instructions, fixupAt, subroutineAt, bodies, lengths, subroutines, symbols, ctx);
+  ADD_STAT(ctx, outlineSaved, saved);
+  ADD_STAT(ctx, subroutines, subroutines);
+  ADD_STAT(ctx, outlinedCopies, copies);
+}
+
+/******************************************************
+ * Function: merge_data
+ * Description: Shares the words of the data image between data labels. The run of a
+ *		label, from it to the next data label, goes away when its words are the
+ *		last words of a longer run, or the same as those of an earlier one, and
+ *		the label is moved there. Only runs the program reads are merged: a run
+ *		that is written, whose address is taken or that is an entry keeps its own
+ *		words. The words saved are counted in the statistics of --stats.
+ *
+ * @param symbols: Pointer to the symbol table, its data labels are moved with the data.
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image, with the fixups of the first pass.
+ * @param ctx: Context of the file, its DC is updated.
+ ******************************************************/
+void merge_data(symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, assemblerContext* ctx) {
+  decodedInstruction* instructions;
+  dataRun* runs;
+  dataRun* sorted; /*The runs from the longest, where each one looks for a host*/
+  int* fixupAt; /*Index of the fixup of every word, -1 for none*/
+  int* lineAt; /*Index of the instruction starting at every word, -1 for none*/
+  int* runAt; /*Run starting at every data word, -1 for none*/
+  int* hosts; /*Runs that keep their words, from the longest*/
+  int words = dataImg->count;
+  int count = 0;
+  int hostCount = 0;
+  int duplicates = 0;
+  int suffixes = 0;
+  int saved = 0;
+  ptrLabel label;
+  int i, j;
+
+  if(words == 0) return;
+  runAt = (int*) arena_alloc(&ctx->memory, (words+1)*sizeof(int));
+  for(i = 0; i <= words; i++) runAt[i] = -1;
+  for(label = symbols->head; label != NULL; label = label->next) {
+    if(label->labelType == ENTRY) return; /* Its section is not known before the second pass */
+    if(label->labelType != DATA) continue;
+    if(label->data < 0 || label->data >= words) return;
+    runAt[label->data] = 0;
+  }
+
+  /* The words before the first label are kept where they are */
+  runs = (dataRun*) arena_alloc(&ctx->memory, words*sizeof(dataRun));
+  for(i = 0; i < words; i++) {
+    if(i > 0 && runAt[i] == -1) continue;
+    runs[count].start = i;
+    runs[count].index = count;
+    runs[count].isPinned = runAt[i] == -1 ? YES : NO;
+    runs[count].host = -1;
+    if(count > 0) runs[count-1].length = i - runs[count-1].start;
+    runAt[i] = count++;
+  }
+  runs[count-1].length = words - runs[count-1].start;
+
+  instructions = decode_code(codeImg, &fixupAt, &lineAt, ctx);
+  for(i = 0; i < codeImg->count; i++) {
+    decodedInstruction* p = &instructions[i];
+    int slots[2];
+    slots[0] = p->sourceSlot;
+    slots[1] = p->destinationSlot;
+    for(j = 0; j < 2; j++) {
+      ptrFixup operand = operand_fixup(codeImg, fixupAt, slots[j]);
+      dataRun* run;
+      int index;
+      if(operand == NULL || operand->mode == IMMEDIATE || (label = data_label(operand->arg, symbols)) == NULL) continue;
+      run = &runs[runAt[label->data]];
+      if(!(j == 0 && (p->opcode == MOV || p->opcode == CMP || p->opcode == ADD || p->opcode == SUB)) &&
+         !(j == 1 && (p->opcode == CMP || p->opcode == PRN))) run->isPinned = YES;
+      /* A read past the end of its run depends on the run after it */
+      if(operand->mode == INDEX && ((index = index_value(operand->arg, symbols)) < 0 || index >= run->length)) return;
+    }
+  }
+  for(i = 0; i < codeImg->fixups.count; i++) {
+    ptrFixup p = &codeImg->fixups.items[i];
+    if(p->type == ENTRY && p->arg != NULL && (label = data_label(p->arg, symbols)) != NULL) runs[runAt[label->data]].isPinned = YES;
+  }
+
+  sorted = (dataRun*) arena_alloc(&ctx->memory, count*sizeof(dataRun));
+  hosts = (int*) arena_alloc(&ctx->memory, count*sizeof(int));
+  memcpy(sorted, runs, count*sizeof(dataRun));
+  qsort(sorted, count, sizeof(dataRun), compare_runs);
+  for(i = 0; i < count; i++) {
+    dataRun* run = &runs[sorted[i].index];
+    if(run->isPinned == YES) continue;
+    for(j = 0; j < hostCount; j++) {
+      dataRun* host = &runs[hosts[j]];
+      if(memcmp(dataImg->words + host->start + host->length - run->length, dataImg->words + run->start, run->length*sizeof(machineWord)) == 0) break;
+    }
+    if(j == hostCount) {
+      hosts[hostCount++] = run->index;
+      continue;
+    }
+    run->host = hosts[j];
+    saved += run->length;
+    if(run->length == runs[hosts[j]].length) duplicates++;
+    else suffixes++;
+  }
+  if(saved == 0) return;
+
+  /* The runs that keep their words move together, the others point into their host */
+  for(i = 0, j = 0; i < count; i++) {
+    if(runs[i].host != -1) continue;
+    memmove(dataImg->words + j, dataImg->words + runs[i].start, runs[i].length*sizeof(machineWord));
+    runs[i].start = j;
+    j += runs[i].length;
+  }
+  for(i = 0; i < count; i++)
+    if(runs[i].host != -1) runs[i].start = runs[runs[i].host].start + runs[runs[i].host].length - runs[i].length;
+  for(label = symbols->head; label != NULL; label = label->next)
+    if(label->labelType == DATA) label->data = runs[runAt[label->data]].start;
+  dataImg->count = j;
+  ctx->DC = j;
+  ADD_STAT(ctx, dataSaved, saved);
+  ADD_STAT(ctx, identicalRuns, duplicates);
+  ADD_STAT(ctx, suffixRuns, suffixes);
+}
+
+/******************************************************
+ * Function: decode_code
+ * Description: Decodes every instruction of the code image and maps its words.
+ *
+ * @param codeImg: Pointer to the code image.
+ * @param fixupAt: Where the index of the fixup of every word is stored, -1 for none.
+ * @param lineAt: Where the index of the instruction starting at every word is stored, -1 for none.
+ * @param ctx: Context of the file, its arena owns the result.
+ * @return: The decoded instructions, in IC order.
+ ******************************************************/
+decodedInstruction* decode_code(codeImage* codeImg, int** fixupAt, int** lineAt, assemblerContext* ctx) {
+  decodedInstruction* instructions = (decodedInstruction*) arena_alloc(&ctx->memory, (codeImg->count+1)*sizeof(decodedInstruction));
+  int words = codeImg->words.count;
+  int i;
+
+  *fixupAt = (int*) arena_alloc(&ctx->memory, (words+1)*sizeof(int));
+  *lineAt = (int*) arena_alloc(&ctx->memory, (words+1)*sizeof(int));
+  for(i = 0; i <= words; i++) {
+    (*fixupAt)[i] = -1;
+    (*lineAt)[i] = -1;
+  }
+  for(i = 0; i < codeImg->fixups.count; i++)
+    if(codeImg->fixups.items[i].type == CODE) (*fixupAt)[codeImg->fixups.items[i].slot] = i;
+  for(i = 0; i < codeImg->count; i++) {
+    decode_code_line(&instructions[i], codeImg, i);
+    (*lineAt)[instructions[i].start] = i;
+  }
+  return instructions;
+}
+
+/******************************************************
+ * Function: decode_code_line
+ * Description: Decodes an instruction of the code image.
+ *
+ * @param instruction: Where the instruction is stored.
+ * @param codeImg: Pointer to the code image.
+ * @param line: Index of the instruction in the code image.
+ ******************************************************/
+void decode_code_line(decodedInstruction* instruction, codeImage* codeImg, int line) {
+  itemCodeImg* code = &codeImg->lines[line];
+  machineWord first = codeImg->words.words[code->lineNum];
+
+  instruction->start = code->lineNum;
+  instruction->L = code->L;
+  instruction->opcode = code->opcode;
+  instruction->source = (first >> 4) & 3;
+  instruction->destination = (first >> 2) & 3;
+  instruction->sourceSlot = -1;
+  instruction->destinationSlot = -1;
+  instruction->isRemoved = NO;
+  if(code->L == 1) return;
+  if(opcodeTable[code->opcode].operands == 2) { /* Registers share a word */
+    instruction->sourceSlot = code->lineNum+1;
+    if(instruction->source == DIRECT_REGISTER && instruction->destination == DIRECT_REGISTER) instruction->destinationSlot = code->lineNum+1;
+    else instruction->destinationSlot = code->lineNum + (instruction->source == INDEX ? 3 : 2);
+  }
+  else instruction->destinationSlot = code->lineNum+1;
+}
+
+/******************************************************
+ * Function: operand_fixup
+ * Description: Finds the fixup of an operand word.
+ *
+ * @param codeImg: Pointer to the code image.
+ * @param fixupAt: Index of the fixup of every word.
+ * @param slot: The word, -1 for none.
+ * @return: The fixup, NULL if the word has none.
+ ******************************************************/
+ptrFixup operand_fixup(codeImage* codeImg, int* fixupAt, int slot) {
+  if(slot == -1 || fixupAt[slot] == -1) return NULL;
+  return &codeImg->fixups.items[fixupAt[slot]];
+}
+
+/******************************************************
+ * Function: code_label
+ * Description: Finds the code label a direct operand names.
+ *
+ * @param operand: The fixup of the operand, may be NULL.
+ * @param symbols: Pointer to the symbol table.
+ * @return: The label, NULL if the operand does not name a code label.
+ ******************************************************/
+ptrLabel code_label(ptrFixup operand, symbolTable* symbols) {
+  ptrLabel label;
+
+  if(operand == NULL || operand->mode != DIRECT) return NULL;
+  if((label = is_label(operand->arg, symbols)) == NULL || label->labelType != CODE) return NULL;
+  return label;
+}
+
+/******************************************************
+ * Function: is_same_operand
+ * Description: Checks if two operands with the same addressing mode name the same place.
+ *
+ * @param codeImg: Pointer to the code image.
+ * @param fixupAt: Index of the fixup of every word.
+ * @param mode: Addressing mode of both operands.
+ * @param slot: Word of the first operand.
+ * @param otherSlot: Word of the second operand.
+ * @return: YES if they do, NO otherwise.
+ ******************************************************/
+int is_same_operand(codeImage* codeImg, int* fixupAt, int mode, int slot, int otherSlot) {
+  ptrFixup operand = operand_fixup(codeImg, fixupAt, slot);
+  ptrFixup other = operand_fixup(codeImg, fixupAt, otherSlot);
+
+  if(mode == DIRECT_REGISTER) return codeImg->words.words[slot] == codeImg->words.words[otherSlot] ? YES : NO;
+  if(mode != DIRECT && mode != INDEX) return NO;
+  return operand != NULL && other != NULL && strcmp(operand->arg, other->arg) == 0 ? YES : NO;
+}
+
+/******************************************************
+ * Function: is_resolved
+ * Description: Checks if the second pass resolves an operand, by encoding a copy of it the same way.
+ *
+ * @param codeImg: Pointer to the code image.
+ * @param fixupAt: Index of the fixup of every word.
+ * @param mode: Addressing mode of the operand.
+ * @param slot: Word of the operand, -1 for none.
+ * @param symbols: Pointer to the symbol table.
+ * @return: YES if it does or the operand has no label, NO otherwise.
+ ******************************************************/
+int is_resolved(codeImage* codeImg, int* fixupAt, int mode, int slot, symbolTable* symbols) {
+  ptrFixup operand = operand_fixup(codeImg, fixupAt, slot);
+  machineWord output[2];
+  char arg[BUFFER]; /*The addressing functions cut their input*/
+
+  if(operand == NULL) return YES;
+  strncpy(arg, operand->arg, BUFFER-1);
+  arg[BUFFER-1] = '\0';
+  if(mode == DIRECT) return direct_addressing(arg, symbols, output) == NO ? YES : NO;
+  if(mode == INDEX) return index_addressing(arg, symbols, output) == NO ? YES : NO;
+  if(mode == IMMEDIATE) return immediate_addressing(arg, symbols, output) == NO ? YES : NO;
+  return YES;
+}
+
+/******************************************************
+ * Function: reads_code
+ * Description: Checks if the program uses a code label other than as the target of a branch.
+ *
+ * @param codeImg: Pointer to the code image.
+ * @param instructions: The decoded instructions.
+ * @param fixupAt: Index of the fixup of every word.
+ * @param symbols: Pointer to the symbol table.
+ * @return: YES if it does, NO otherwise.
+ ******************************************************/
+int reads_code(codeImage* codeImg, decodedInstruction* instructions, int* fixupAt, symbolTable* symbols) {
+  char name[BUFFER];
+  int i;
+
+  for(i = 0; i < codeImg->count; i++) {
+    decodedInstruction* p = &instructions[i];
+    int slots[2];
+    int j;
+    slots[0] = p->sourceSlot;
+    slots[1] = p->destinationSlot;
+    for(j = 0; j < 2; j++) {
+      ptrFixup operand = operand_fixup(codeImg, fixupAt, slots[j]);
+      ptrLabel label;
+      if(operand == NULL || operand->mode == IMMEDIATE) continue;
+      if(operand->mode == DIRECT && (p->opcode == JMP || p->opcode == BNE || p->opcode == JSR)) continue;
+      /* The name of an index operand ends at its '[' */
+      strncpy(name, operand->arg, BUFFER-1);
+      name[BUFFER-1] = '\0';
+      if(strchr(name, '[') != NULL) *strchr(name, '[') = '\0';
+      if((label = is_label(name, symbols)) != NULL && label->labelType == CODE) return YES;
+    }
+  }
+  return NO;
+}
+
+/******************************************************
+ * Function: compact_code
+ * Description: Moves the instructions that are kept together, with their fixups,
+ *		and moves every code label to where its instruction went. A label of a
+ *		removed instruction goes to the next instruction that is kept.
+ *
+ * @param codeImg: Pointer to the code image.
+ * @param instructions: The decoded instructions, with the ones to remove.
+ * @param symbols: Pointer to the symbol table.
+ * @param ctx: Context of the file, its IC is updated.
+ ******************************************************/
+void compact_code(codeImage* codeImg, decodedInstruction* instructions, symbolTable* symbols, assemblerContext* ctx) {
+  int words = codeImg->words.count;
+  int* newAddress = (int*) arena_alloc(&ctx->memory, (words+1)*sizeof(int)); /*Where every word goes, the next kept word for removed ones*/
+  char* isRemoved = (char*) arena_alloc(&ctx->memory, words+1);
+  int kept = 0;
+  int lines = 0;
+  int i, j;
+
+  for(i = 0; i < codeImg->count; i++) {
+    decodedInstruction* p = &instructions[i];
+    for(j = p->start; j < p->start+p->L; j++) {
+      isRemoved[j] = (char) p->isRemoved;
+      newAddress[j] = kept;
+      if(p->isRemoved == NO) codeImg->words.words[kept++] = codeImg->words.words[j];
+    }
+    if(p->isRemoved == NO) {
+      codeImg->lines[lines] = codeImg->lines[i];
+      codeImg->lines[lines++].lineNum = newAddress[p->start];
+    }
+  }
+  newAddress[words] = kept;
+  isRemoved[words] = NO;
+
+  for(i = 0, j = 0; i < codeImg->fixups.count; i++) {
+    itemFixup fixup = codeImg->fixups.items[i];
+    if(fixup.type == CODE) {
+      if(isRemoved[fixup.slot]) continue;
+      fixup.slot = newAddress[fixup.slot];
+    }
+    codeImg->fixups.items[j++] = fixup;
+  }
+  codeImg->fixups.count = j;
+
+  move_labels(symbols, newAddress, words);
+  codeImg->words.count = kept;
+  codeImg->count = lines;
+  ctx->IC = kept;
+}
+
+/******************************************************
+ * Function: move_labels
+ * Description: Moves every code label to the new address of its word.
+ *
+ * @param symbols: Pointer to the symbol table.
+ * @param newAddress: Where every word of the code image went, and the end of the code after it.
+ * @param words: Number of words of the code image before it changed.
+ ******************************************************/
+void move_labels(symbolTable* symbols, int* newAddress, int words) {
+  ptrLabel label;
+
+  for(label = symbols->head; label != NULL; label = label->next)
+    if(label->labelType == CODE && label->data-FIRST_ADDRESS >= 0 && label->data-FIRST_ADDRESS <= words) label->data = FIRST_ADDRESS + newAddress[label->data-FIRST_ADDRESS];
+}
+
+/******************************************************
+ * Function: classify_code
+ * Description: Gives every instruction a class, the same for instructions with the same
+ *		words and the same operands. An instruction that changes the flow of the
+ *		program has a class of its own, so no sequence holds it, and so does one
+ *		with an operand the second pass does not resolve, so its error stays on its line.
+ *
+ * @param codeImg: Pointer to the code image.
+ * @param instructions: The decoded instructions.
+ * @param fixupAt: Index of the fixup of every word.
+ * @param symbols: Pointer to the symbol table.
+ * @param ids: Where the class of every instruction is stored.
+ * @param ctx: Context of the file, its arena owns the hash table.
+ * @return: The number of classes of instructions that can be moved, the
+ *		classes of their own start there at range+index.
+ ******************************************************/
+int classify_code(codeImage* codeImg, decodedInstruction* instructions, int* fixupAt, symbolTable* symbols, int* ids, assemblerContext* ctx) {
+  unsigned long capacity = 16;
+  int* slots; /*Open-addressing table of the first instruction of every class*/
+  int classes = 0;
+  int i, j;
+
+  while(capacity < 2*(unsigned long) codeImg->count) capacity *= 2;
+  slots = (int*) arena_alloc(&ctx->memory, capacity*sizeof(int));
+  for(i = 0; i < (int) capacity; i++) slots[i] = -1;
+  for(i = 0; i < codeImg->count; i++) {
+    decodedInstruction* p = &instructions[i];
+    unsigned long hash = (unsigned long) p->opcode*31 + p->L;
+    ids[i] = -1;
+    if(p->opcode == JMP || p->opcode == BNE || p->opcode >= JSR) continue; /* jsr, rts and hlt */
+    if(is_resolved(codeImg, fixupAt, p->source, p->sourceSlot, symbols) == NO || is_resolved(codeImg, fixupAt, p->destination, p->destinationSlot, symbols) == NO) continue;
+    for(j = p->start; j < p->start+p->L; j++) {
+      hash = hash*31 + codeImg->words.words[j];
+      if(fixupAt[j] != -1) hash = hash*31 ^ hash_name(codeImg->fixups.items[fixupAt[j]].arg) ^ (unsigned long) codeImg->fixups.items[fixupAt[j]].mode;
+    }
+    for(j = (int) (hash & (capacity-1)); slots[j] != -1; j = (int) ((j+1) & (capacity-1)))
+      if(is_same_instruction(codeImg, fixupAt, p, &instructions[slots[j]]) == YES) {
+        ids[i] = ids[slots[j]];
+        break;
+      }
+    if(ids[i] != -1) continue;
+    slots[j] = i;
+    ids[i] = classes++;
+  }
+  for(i = 0; i < codeImg->count; i++) if(ids[i] == -1) ids[i] = classes + i;
+  return classes;
+}
+
+/******************************************************
+ * Function: is_same_instruction
+ * Description: Checks if two instructions have the same words and the same operands.
+ *
+ * @param codeImg: Pointer to the code image.
+ * @param fixupAt: Index of the fixup of every word.
+ * @param instruction: The first instruction.
+ * @param other: The second instruction.
+ * @return: YES if they do, NO otherwise.
+ ******************************************************/
+int is_same_instruction(codeImage* codeImg, int* fixupAt, decodedInstruction* instruction, decodedInstruction* other) {
+  int i;
+
+  if(instruction->opcode != other->opcode || instruction->L != other->L) return NO;
+  for(i = 0; i < instruction->L; i++) {
+    ptrFixup operand = operand_fixup(codeImg, fixupAt, instruction->start+i);
+    ptrFixup otherOperand = operand_fixup(codeImg, fixupAt, other->start+i);
+    if(codeImg->words.words[instruction->start+i] != codeImg->words.words[other->start+i]) return NO;
+    if(operand == NULL || otherOperand == NULL) {
+      if(operand != otherOperand) return NO;
+    }
+    else if(operand->mode != otherOperand->mode || strcmp(operand->arg, otherOperand->arg) != 0) return NO;
+  }
+  return YES;
+}
+
+/******************************************************
+ * Function: init_repeat_search
+ * Description: Allocates the work arrays of the search for repeated sequences.
+ *
+ * @param search: Pointer to the search.
+ * @param count: Number of instructions.
+ * @param ctx: Context of the file, its arena owns the arrays.
+ ******************************************************/
+void init_repeat_search(repeatSearch* search, int count, assemblerContext* ctx) {
+  int i;
+
+  search->count = count;
+  search->work = OUTLINE_WORK;
+  search->ids = (int*) arena_alloc(&ctx->memory, count*sizeof(int));
+  search->suffixes = (int*) arena_alloc(&ctx->memory, count*sizeof(int));
+  search->ranks = (int*) arena_alloc(&ctx->memory, count*sizeof(int));
+  search->next = (int*) arena_alloc(&ctx->memory, count*sizeof(int));
+  search->lcp = (int*) arena_alloc(&ctx->memory, (count+1)*sizeof(int));
+  search->buckets = (int*) arena_alloc(&ctx->memory, (2*count+1)*sizeof(int));
+  search->stackLength = (int*) arena_alloc(&ctx->memory, (count+1)*sizeof(int));
+  search->stackFirst = (int*) arena_alloc(&ctx->memory, (count+1)*sizeof(int));
+  search->positions = (int*) arena_alloc(&ctx->memory, count*sizeof(int));
+  search->occurrences = (int*) arena_alloc(&ctx->memory, count*sizeof(int));
+  search->wordsBefore = (int*) arena_alloc(&ctx->memory, (count+1)*sizeof(int));
+  search->labelsBefore = (int*) arena_alloc(&ctx->memory, (count+1)*sizeof(int));
+  for(i = 0; i <= count; i++) {
+    search->wordsBefore[i] = 0;
+    search->labelsBefore[i] = 0;
+  }
+}
+
+/******************************************************
+ * Function: find_repeat
+ * Description: Finds the repeated sequence that saves the most words when moved to a
+ *		subroutine: k copies of w words become k jsr of 2 words, and the
+ *		subroutine takes w words and an rts. Every group of suffixes of the
+ *		suffix array that share a prefix is a candidate, with its copies
+ *		taken from the first one on without overlapping. Every suffix sorted or
+ *		walked is taken from the work left, the groups it has no work left for are skipped.
+ *
+ * @param search: Pointer to the search, with the class of every instruction.
+ *		The sequence found is left in its occurrences, length and saved.
+ * @return: YES if a sequence saves words, NO otherwise.
+ ******************************************************/
+int find_repeat(repeatSearch* search) {
+  int n = search->count;
+  int top = 0;
+  int i;
+
+  search->saved = 0;
+  if(search->work < n) return NO;
+  search->work -= n;
+  sort_suffixes(search);
+  search->stackLength[0] = 0;
+  search->stackFirst[0] = 0;
+  for(i = 1; i <= n; i++) {
+    int length = i < n ? search->lcp[i] : 0;
+    int first = i-1;
+    while(length < search->stackLength[top]) {
+      try_repeat(search, search->stackFirst[top], i-1, search->stackLength[top]);
+      first = search->stackFirst[top--];
+    }
+    if(length > search->stackLength[top]) {
+      top++;
+      search->stackLength[top] = length;
+      search->stackFirst[top] = first;
+    }
+  }
+  return search->saved > 0 ? YES : NO;
+}
+
+/******************************************************
+ * Function: sort_suffixes
+ * Description: Builds the suffix array of the classes by prefix doubling, with counting
+ *		sorts, and the length of the prefix every suffix shares with the one before it.
+ *
+ * @param search: Pointer to the search.
+ ******************************************************/
+void sort_suffixes(repeatSearch* search) {
+  int n = search->count;
+  int* ids = search->ids;
+  int* suffixes = search->suffixes;
+  int* ranks = search->ranks;
+  int* next = search->next;
+  int* buckets = search->buckets;
+  int* lcp = search->lcp;
+  int range = search->range + n; /*Classes of their own included*/
+  int length = 0;
+  int i, k;
+
+  /* By the first instruction */
+  for(i = 0; i <= range; i++) buckets[i] = 0;
+  for(i = 0; i < n; i++) buckets[ids[i]+1]++;
+  for(i = 1; i <= range; i++) buckets[i] += buckets[i-1];
+  for(i = 0; i < n; i++) suffixes[buckets[ids[i]]++] = i;
+  ranks[suffixes[0]] = 0;
+  for(i = 1; i < n; i++) ranks[suffixes[i]] = ranks[suffixes[i-1]] + (ids[suffixes[i]] != ids[suffixes[i-1]]);
+
+  /* By the first 2k instructions, from the order by the first k */
+  for(k = 1; ranks[suffixes[n-1]] < n-1; k *= 2) {
+    int j = 0;
+    for(i = n-k; i < n; i++) next[j++] = i; /* Suffixes without a second half come first */
+    for(i = 0; i < n; i++) if(suffixes[i] >= k) next[j++] = suffixes[i]-k;
+    for(i = 0; i <= n; i++) buckets[i] = 0;
+    for(i = 0; i < n; i++) buckets[ranks[i]+1]++;
+    for(i = 1; i <= n; i++) buckets[i] += buckets[i-1];
+    for(i = 0; i < n; i++) suffixes[buckets[ranks[next[i]]]++] = next[i];
+    lcp[suffixes[0]] = 0;
+    for(i = 1; i < n; i++) {
+      int a = suffixes[i-1];
+      int b = suffixes[i];
+      int isSame = ranks[a] == ranks[b] && (a+k < n ? ranks[a+k] : -1) == (b+k < n ? ranks[b+k] : -1);
+      lcp[b] = lcp[a] + !isSame;
+    }
+    for(i = 0; i < n; i++) ranks[i] = lcp[i];
+  }
+
+  /* Shared prefixes, the suffix after i shares at least one instruction less with its own */
+  for(i = 0; i < n; i++) {
+    if(ranks[i] == 0) {
+      length = 0;
+      continue;
+    }
+    k = suffixes[ranks[i]-1];
+    while(i+length < n && k+length < n && ids[i+length] == ids[k+length]) length++;
+    lcp[ranks[i]] = length;
+    if(length > 0) length--;
+  }
+  lcp[0] = 0;
+}
+
+/******************************************************
+ * Function: try_repeat
+ * Description: Counts the words a group of suffixes would save and keeps it if it saves the most so far.
+ *
+ * @param search: Pointer to the search.
+ * @param first: First suffix of the group in the suffix array.
+ * @param last: Last suffix of the group.
+ * @param length: Instructions the suffixes share.
+ ******************************************************/
+void try_repeat(repeatSearch* search, int first, int last, int length) {
+  int words = search->wordsBefore[search->suffixes[first]+length] - search->wordsBefore[search->suffixes[first]];
+  int count = 0;
+  int end = 0; /*Where the last copy taken ends*/
+  int most = last-first+1 < search->count/length ? last-first+1 : search->count/length; /*Copies that fit without overlapping*/
+  int i;
+
+  if(words <= JSR_WORDS || most*(words-JSR_WORDS) - (words+1) <= search->saved || search->work < last-first+1) return;
+  search->work -= last-first+1;
+  for(i = first; i <= last; i++) search->positions[i-first] = search->suffixes[i];
+  qsort(search->positions, last-first+1, sizeof(int), compare_positions);
+  for(i = 0; i <= last-first; i++) {
+    int p = search->positions[i];
+    /* A copy is only entered at its first instruction */
+    if(p < end || search->labelsBefore[p+length] != search->labelsBefore[p+1]) continue;
+    search->positions[count++] = p;
+    end = p+length;
+  }
+  if(count < 2 || count*(words-JSR_WORDS) - (words+1) <= search->saved) return;
+  search->saved = count*(words-JSR_WORDS) - (words+1);
+  search->length = length;
+  search->occurrenceCount = count;
+  memcpy(search->occurrences, search->positions, count*sizeof(int));
+}
+
+/******************************************************
+ * Function: compare_positions
+ * Description: Orders positions in the code from the first.
+ *
+ * @param a: Pointer to the first position.
+ * @param b: Pointer to the second position.
+ * @return: Negative, zero or positive like strcmp.
+ ******************************************************/
+int compare_positions(const void* a, const void* b) {
+  return *(const int*) a - *(const int*) b;
+}
+
+/******************************************************
+ * Function: build_subroutines
+ * Description: Rebuilds the code image with a jsr in place of every copy of a moved
+ *		sequence and the subroutines after the rest of the code. The fixups of the
+ *		first copy move to its subroutine, the code labels move with their words
+ *		and every subroutine gets a label the jsr are patched with.
+ *		Only cmp sets the Z flag and neither jsr nor rts change it, so a bne after
+ *		a copy reads the flag its subroutine left, as it read the flag of the copy.
+ *
+ * @param codeImg: Pointer to the code image.
+ * @param instructions: The decoded instructions.
+ * @param fixupAt: Index of the fixup of every word.
+ * @param subroutineAt: Subroutine of the first instruction of every copy, -1 for none.
+ * @param bodies: First instruction of the sequence of every subroutine.
+ * @param lengths: Instructions of the sequence of every subroutine.
+ * @param subroutines: Number of subroutines.
+ * @param symbols: Pointer to the symbol table.
+ * @param ctx: Context of the file, its IC is updated.
+ ******************************************************/
+void build_subroutines(codeImage* codeImg, decodedInstruction* instructions, int* fixupAt, int* subroutineAt, int* bodies, int* lengths, int subroutines,
+                       symbolTable* symbols, assemblerContext* ctx) {
+  codeImage optimized;
+  int words = codeImg->words.count;
+  int* newAddress = (int*) arena_alloc(&ctx->memory, (words+1)*sizeof(int)); /*Where every word goes, a copy goes to its jsr*/
+  char** names = (char**) arena_alloc(&ctx->memory, subroutines*sizeof(char*));
+  ptrFixup last = NULL; /*The last operand before the current instruction, for the line of a jsr*/
+  int i, j;
+
+  init_code_image(&optimized, &ctx->memory);
+  optimized.fixups.lastCodeLine = codeImg->fixups.lastCodeLine;
+  for(i = 0; i < subroutines; i++) {
+    /* No label of the source can have a '.' in its name */
+    names[i] = (char*) arena_alloc(&ctx->memory, OUTLINE_LABEL_SIZE);
+    sprintf(names[i], OUTLINE_LABEL "%d", i+1);
+  }
+
+  for(i = 0; i < codeImg->count; i++) {
+    decodedInstruction* p = &instructions[i];
+    int address = optimized.words.count;
+    int s = subroutineAt[i];
+    ptrFixup line;
+    if(s == -1) {
+      last = copy_code_line(&optimized, codeImg, p, fixupAt, newAddress, last);
+      continue;
+    }
+    /* The jsr takes the line of the first operand of the copy or before it, the second pass skips line 0 */
+    line = NULL;
+    for(j = p->start; j < instructions[i+lengths[s]-1].start + instructions[i+lengths[s]-1].L; j++) {
+      newAddress[j] = address;
+      if(fixupAt[j] != -1 && line == NULL) line = &codeImg->fixups.items[fixupAt[j]];
+      if(fixupAt[j] != -1) last = &codeImg->fixups.items[fixupAt[j]];
+    }
+    if(line == NULL) line = last;
+    add_code_line(&optimized, address, JSR, JSR_WORDS);
+    add_word(&optimized.words, opcodeTable[JSR].firstWord[0][DIRECT]);
+    add_word(&optimized.words, 0);
+    add_fixup(&optimized.fixups, CODE, DIRECT, address+1, line != NULL ? line->lineNum : codeImg->fixups.lastCodeLine, names[s], line != NULL ? line->line : "", line != NULL ? line->lineLength : 0);
+    i += lengths[s]-1;
+  }
+  newAddress[words] = optimized.words.count;
+  move_labels(symbols, newAddress, words);
+
+  for(i = 0; i < subroutines; i++) {
+    add_symbol(symbols, names[i], CODE, FIRST_ADDRESS + optimized.words.count);
+    for(j = bodies[i]; j < bodies[i]+lengths[i]; j++) copy_code_line(&optimized, codeImg, &instructions[j], fixupAt, newAddress, NULL);
+    add_code_line(&optimized, optimized.words.count, RTS, 1);
+    add_word(&optimized.words, opcodeTable[RTS].firstWord[0][0]);
+  }
+
+  /* The second pass reads the fixups in line order, the .entry directives included */
+  for(i = 0; i < codeImg->fixups.count; i++) {
+    ptrFixup p = &codeImg->fixups.items[i];
+    if(p->type == ENTRY) add_fixup(&optimized.fixups, ENTRY, p->mode, p->slot, p->lineNum, p->arg, p->line, p->lineLength);
+  }
+  qsort(optimized.fixups.items, optimized.fixups.count, sizeof(itemFixup), compare_fixups);
+  *codeImg = optimized;
+  ctx->IC = optimized.words.count;
+}
+
+/******************************************************
+ * Function: copy_code_line
+ * Description: Appends an instruction to the rebuilt code image, with its operands.
+ *
+ * @param optimized: Pointer to the rebuilt code image.
+ * @param codeImg: Pointer to the code image the instruction is taken from.
+ * @param instruction: The instruction.
+ * @param fixupAt: Index of the fixup of every word.
+ * @param newAddress: Where the new address of every word of the instruction is stored.
+ * @param last: The last operand copied so far.
+ * @return: The last operand copied, with those of the instruction.
+ ******************************************************/
+ptrFixup copy_code_line(codeImage* optimized, codeImage* codeImg, decodedInstruction* instruction, int* fixupAt, int* newAddress, ptrFixup last) {
+  int i;
+
+  add_code_line(optimized, optimized->words.count, instruction->opcode, instruction->L);
+  for(i = instruction->start; i < instruction->start+instruction->L; i++) {
+    ptrFixup p = operand_fixup(codeImg, fixupAt, i);
+    newAddress[i] = optimized->words.count;
+    if(p != NULL) {
+      add_fixup(&optimized->fixups, CODE, p->mode, optimized->words.count, p->lineNum, p->arg, p->line, p->lineLength);
+      last = p;
+    }
+    add_word(&optimized->words, codeImg->words.words[i]);
+  }
+  return last;
+}
+
+/******************************************************
+ * Function: compare_fixups
+ * Description: Orders fixups by line, then by the word they patch.
+ *
+ * @param a: Pointer to the first fixup.
+ * @param b: Pointer to the second fixup.
+ * @return: Negative, zero or positive like strcmp.
+ ******************************************************/
+int compare_fixups(const void* a, const void* b) {
+  const itemFixup* first = (const itemFixup*) a;
+  const itemFixup* second = (const itemFixup*) b;
+  if(first->lineNum != second->lineNum) return first->lineNum - second->lineNum;
+  return first->slot - second->slot;
+}
+
+/******************************************************
+ * Function: data_label
+ * Description: Finds the data label an operand or an .entry directive names.
+ *
+ * @param arg: The operand, an index operand names its list before the '[',
+ *		the argument of an .entry directive may end with the newline of its line.
+ * @param symbols: Pointer to the symbol table.
+ * @return: The label, NULL if the argument does not name a data label.
+ ******************************************************/
+ptrLabel data_label(char* arg, symbolTable* symbols) {
+  char name[BUFFER];
+  ptrLabel label;
+
+  strncpy(name, arg, BUFFER-1);
+  name[BUFFER-1] = '\0';
+  name[strcspn(name, "[\n")] = '\0';
+  if((label = is_label(name, symbols)) == NULL || label->labelType != DATA) return NULL;
+  return label;
+}
+
+/******************************************************
+ * Function: index_value
+ * Description: Finds the value of the index of an index operand.
+ *
+ * @param arg: The operand, name[index].
+ * @param symbols: Pointer to the symbol table.
+ * @return: The index, -1 if it is not a number or a .define value.
+ ******************************************************/
+int index_value(char* arg, symbolTable* symbols) {
+  char index[BUFFER];
+  char* start = strchr(arg, '[');
+  ptrLabel label;
+
+  if(start == NULL) return -1;
+  strncpy(index, start+1, BUFFER-1);
+  index[BUFFER-1] = '\0';
+  if(strchr(index, ']') == NULL) return -1;
+  *strchr(index, ']') = '\0';
+  if(is_number(index) == YES) return atoi(index);
+  if((label = is_label(index, symbols)) != NULL && label->labelType == DEFINE) return label->data;
+  return -1;
+}
+
+/******************************************************
+ * Function: compare_runs
+ * Description: Orders data runs from the longest, then from the first.
+ *
+ * @param a: Pointer to the first run.
+ * @param b: Pointer to the second run.
+ * @return: Negative, zero or positive like strcmp.
+ ******************************************************/
+int compare_runs(const void* a, const void* b) {
+  const dataRun* first = (const dataRun*) a;
+  const dataRun* second = (const dataRun*) b;
+  if(first->length != second->length) return second->length - first->length;
+  return first->start - second->start;
+}
@@ -0,0 +1,35 @@
+/******************************************************
+ * Function: optimize_code
+ * Description: Runs the peephole optimizer on the code image, after the first pass.
+ *		The words saved by every pattern are counted in the statistics of --stats.
+ *
+ * @param symbols: Pointer to the symbol table, its code labels are moved with the code.
+ * @param codeImg: Pointer to the code image, with the fixups of the first pass.
+ * @param ctx: Context of the file, its IC is updated.
+ ******************************************************/
+void optimize_code(symbolTable* symbols, codeImage* codeImg, assemblerContext* ctx);
+
+/******************************************************
+ * Function: outline_code
+ * Description: Moves instruction sequences that repeat in the code image to subroutines
+ *		at the end of the code, each copy replaced by a jsr to it, as long as that
+ *		saves words. The words saved are counted in the statistics of --stats.
+ *
+ * @param symbols: Pointer to the symbol table, its code labels are moved with the code.
+ * @param codeImg: Pointer to the code image, with the fixups of the first pass.
+ * @param ctx: Context of the file, its IC is updated.
+ ******************************************************/
+void outline_code(symbolTable* symbols, codeImage* codeImg, assemblerContext* ctx);
+
+/******************************************************
+ * Function: merge_data
+ * Description: Shares the words of the data image between data labels whose words are the
+ *		same, or the last words of a longer run, if the program only reads them.
+ *		The words saved are counted in the statistics of --stats.
+ *
+ * @param symbols: Pointer to the symbol table, its data labels are moved with the data.
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image, with the fixups of the first pass.
+ * @param ctx: Context of the file, its DC is updated.
+ ******************************************************/
+void merge_data(symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, assemblerContext* ctx);
@@ -3,262 +3,277 @@
 #include "textToBinary.h"
 #include "exportFiles.h"
 #include "errorTreatment.h"
+#include "symbolTable.h"
+#include "arena.h"
+#include "context.h"
+#include "stats.h"
 
-int treat_line(char* curLine, ptrLabel *headLabel, ptrDataImg *headDataImg, ptrCodeImg p1, ptrExtEnt *headExtEnt, char* fileName);
-int build_operands (ptrCodeImg pointerCode, ptrLabel headLabel, ptrExtEnt **headExtEnt, int opcode, char* line);
-void build_ext_ent (ptrExtEnt **hptr, int lineNum, int type, char* varName);
-void freeLabel(ptrLabel * hptr);
-
-int lineCounterOb = 1; /* Initializing line counter for the output file */
+int patch_operands(codeImage* codeImg, int first, int last, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx);
+int collect_ext_ent(fixupList* fixups, extEntList* operands, int lists, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx);
+void export_image(wordImage* dataImg, codeImage* codeImg, extEntList* extEnt, int isRendered, assemblerContext* ctx);
+int resolve_entry(ptrFixup entry, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx);
+int build_operand (machineWord* output, ptrFixup operand, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx);
+void build_ext_ent (extEntList* list, int lineNum, int type, char* varName);
+void sort_ext_ent (extEntList* list);
+int compare_ext_ent (const void* a, const void* b);
 
 /******************************************************
  * Function: secondtrans
- * Description: Performs the second pass of the assembly process, generating the output files.
+ * Description: Performs the second pass of the assembly process: patches the operands
+ *		recorded by the first pass now that the symbol table is complete,
+ *		then generates the output files, or the result of the library.
  * 
- * @param am: Pointer to the modified assembly file.
- * @param headLabel: Pointer to the pointer to the head of the label linked list.
- * @param headDataImg: Pointer to the pointer to the head of the data image linked list.
- * @param headCodeImg: Pointer to the pointer to the head of the code image linked list.
- * @param fileName: Name of the output files.
- * @param IC: Value of the Instruction Counter.
- * @param DC: Value of the Data Counter.
+ * @param symbols: Pointer to the symbol table.
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image, with the fixups recorded by the first pass.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file, holding the final IC and DC.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-void secondtrans(FILE* am, ptrLabel *headLabel, ptrDataImg *headDataImg, ptrCodeImg *headCodeImg, char* fileName, int IC, int DC) {
-  char curLine[BUFFER];
+int secondtrans(symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, char* fileName, assemblerContext* ctx) {
+  fixupList* fixups = &codeImg->fixups;
   int isError = NO;
-  int returnTreatLine;
-  ptrCodeImg p1 = *headCodeImg;
-  ptrExtEnt headExtEnt = NULL;
-  	
-  while((fgets(curLine, BUFFER-1, am) != NULL) && p1 != NULL) { /*Parse the file line by line*/
-    if (curLine[strlen(curLine) - 1] != '\n') continue;
-    if((returnTreatLine = treat_line(curLine, headLabel, headDataImg, p1, &headExtEnt, fileName)) != -1) {
-      if(isError != YES) isError = returnTreatLine;
-      p1 = p1->next; /* Move to the next node in the code image linked list */
+  int errorLine = 0; /* Only the first error of a line is reported */
+  int i;
+  extEntList extEnt;
+  
+  SWITCH_PHASE(ctx, PHASE_SECOND);
+  extEnt.items = NULL;
+  extEnt.count = 0;
+  extEnt.capacity = 0;
+  extEnt.memory = &ctx->memory;
+  for(i = 0; i < fixups->count; i++) { /* Fixups are in line order */
+    ptrFixup p = &fixups->items[i];
+    int returnFixup;
+    if(p->lineNum > fixups->lastCodeLine) break; /* Lines after the last instruction are not part of the second pass */
+    if(p->lineNum == errorLine) continue;
+    if(p->type == ENTRY) returnFixup = resolve_entry(p, symbols, &extEnt, fileName, ctx);
+    else returnFixup = build_operand(&codeImg->words.words[p->slot], p, symbols, &extEnt, fileName, ctx);
+    if(returnFixup == YES) {
+      isError = YES;
+      errorLine = p->lineNum;
     }
-    lineCounterOb++;
   }
-  freeLabel(headLabel); /* Free allocated memory for the label linked list */
+  ADD_STAT(ctx, lines[PHASE_SECOND], i);
   if(isError == YES) {
-    printf("\nErrors detected in second transition, output files will not be created\n");
-    return;
+    report(ctx, "\nErrors detected in second transition, output files will not be created\n");
+    return YES;
   }
-  else export_files(headDataImg, headCodeImg, &headExtEnt, fileName, IC, DC);
+  export_image(dataImg, codeImg, &extEnt, NO, ctx);
+  return NO;
 }
 
 /******************************************************
- * Function: treat_line
- * Description: Treats each line of the modified assembly file, handling directives and operands.
+ * Function: patch_operands
+ * Description: Patches the operands among a range of fixups, the part of the second pass
+ *		a chunk of --split runs on its own. The .entry directives are left to
+ *		collect_ext_ent, and so is the order of the external entries: each item
+ *		added to the list holds the index of its fixup instead of its position.
  * 
- * @param curLine: Current line of the modified assembly file being processed.
- * @param headLabel: Pointer to the pointer to the head of the label linked list.
- * @param headDataImg: Pointer to the pointer to the head of the data image linked list.
- * @param p1: Pointer to the current node in the code image linked list.
- * @param headExtEnt: Pointer to the pointer to the head of the external entries linked list.
- * @param fileName: Name of the output files.
- * @return: int indicating whether an error occurred (YES) or not (-1).
+ * @param codeImg: Pointer to the code image of the file.
+ * @param first: Index of the first fixup of the range.
+ * @param last: Index past the last fixup of the range.
+ * @param symbols: Pointer to the symbol table of the file.
+ * @param extEnt: Pointer to the external entries list of the range.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context the errors are reported to.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-int treat_line(char* curLine, ptrLabel *headLabel, ptrDataImg *headDataImg, ptrCodeImg p1, ptrExtEnt *headExtEnt, char* fileName) {
-  char* curArg;
-  char* copyCurLine = malloc(strlen(curLine)+1);
-  strcpy(copyCurLine, curLine);
-  curArg = strtok(curLine, "\040\t");
+int patch_operands(codeImage* codeImg, int first, int last, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx) {
+  fixupList* fixups = &codeImg->fixups;
+  int isError = NO;
+  int i;
   
-  /* Check if the argument is missing */
-  if(curArg == NULL) return -1;
-  /* Check if the directive is ".entry" */
-  if(strcmp(curArg, ".entry") == 0) {
-    ptrLabel label;
-    curArg = strtok(NULL, "\040\t");
-    /* Check if the argument is missing */
-    if(curArg==NULL) {
-      printf("\nMissing arguments in line %d: %s in file \"%s\"\n", lineCounterOb, copyCurLine, fileName);
-      return YES;
+  for(i = first; i < last; i++) {
+    ptrFixup p = &fixups->items[i];
+    int count = extEnt->count;
+    if(p->lineNum > fixups->lastCodeLine) break;
+    if(p->type == ENTRY) continue;
+    if(build_operand(&codeImg->words.words[p->slot], p, symbols, extEnt, fileName, ctx) == YES) isError = YES;
+    if(extEnt->count > count) extEnt->items[count].order = i;
+  }
+  return isError;
+}
+
+/******************************************************
+ * Function: collect_ext_ent
+ * Description: Builds the external entries list of the file from the lists of patch_operands,
+ *		resolving the .entry directives in between, in the order the second pass would.
+ * 
+ * @param fixups: Pointer to the fixups of the file.
+ * @param operands: The lists of patch_operands, in the order of their ranges.
+ * @param lists: Number of lists.
+ * @param symbols: Pointer to the symbol table.
+ * @param extEnt: Pointer to the external entries list of the file.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int collect_ext_ent(fixupList* fixups, extEntList* operands, int lists, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx) {
+  int list = 0;
+  int next = 0; /* The next item of the current list */
+  int isError = NO;
+  int i;
+  
+  for(i = 0; i < fixups->count; i++) {
+    ptrFixup p = &fixups->items[i];
+    if(p->lineNum > fixups->lastCodeLine) break;
+    if(p->type == ENTRY) {
+      if(resolve_entry(p, symbols, extEnt, fileName, ctx) == YES) isError = YES;
+      continue;
     }
-    /* Check if the label is defined twice */
-    if(is_ext_ent(curArg, *headExtEnt) != NULL) {
-      printf("\n\"%s\" is defined twice in line %d: %s in file \"%s\"\n", curArg, lineCounterOb, copyCurLine, fileName);
-      return YES;
+    while(list < lists && next == operands[list].count) {
+      list++;
+      next = 0;
     }
-    if(curArg[strlen(curArg)-1 == '\n']) curArg[strlen(curArg)-1] = '\0';
-    if((label = is_label(curArg, *headLabel)) != NULL) build_ext_ent(&headExtEnt, label->data, ENTRY, curArg);
-    else {
-      printf("\n\"%s\" is not defined and therefore cannot be entry in line %d: %s in file \"%s\"\n", curArg, lineCounterOb, copyCurLine, fileName);
-      return YES;
+    if(list < lists && operands[list].items[next].order == i) {
+      ptrExtEnt item = &operands[list].items[next++];
+      build_ext_ent(extEnt, item->lineNum, item->type, item->varName);
     }
-    return -1;
   }
-  else if(strcmp(curArg, ".define")==0 || strcmp(curArg, ".extern") == 0 || strcmp(curArg, ".data") == 0 || strcmp(curArg, ".string") == 0)
-    return -1;
-  else if(curArg[strlen(curArg)-1] == ':') curArg = strtok(NULL, "\040\t");
-  if(strcmp(curArg, ".define")==0 || strcmp(curArg, ".extern") == 0 || strcmp(curArg, ".data") == 0 || strcmp(curArg, ".string") == 0 || strcmp(curArg, ".entry") == 0) return -1;
+  ADD_STAT(ctx, lines[PHASE_SECOND], i);
+  return isError;
+}
+
+/******************************************************
+ * Function: export_image
+ * Description: Generates the output files, or the result of the library, once the operands are patched.
+ * 
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
+ * @param extEnt: Pointer to the external entries list.
+ * @param isRendered: YES if the words of the .ob file are already written.
+ * @param ctx: Context of the file, holding the final IC and DC.
+ ******************************************************/
+void export_image(wordImage* dataImg, codeImage* codeImg, extEntList* extEnt, int isRendered, assemblerContext* ctx) {
+  sort_ext_ent(extEnt);
+  SWITCH_PHASE(ctx, PHASE_EXPORT);
+  ADD_STAT(ctx, lines[PHASE_EXPORT], ctx->IC + ctx->DC + extEnt->count); /* A line per word and per entry or external */
+  if(ctx->result != NULL) export_result(dataImg, codeImg, extEnt, ctx->result);
   else {
-    curArg = strtok(NULL, "\0");
-    return build_operands (p1, *headLabel, &headExtEnt, p1->opcode, curArg);
+    if(isRendered == YES) export_symbols(extEnt, ctx);
+    else export_files(dataImg, codeImg, extEnt, ctx);
+    write_outputs(ctx);
   }
 }
 
 /******************************************************
- * Function: build_operands
- * Description: Builds the operands of the current code line based on its opcode and addressing modes.
+ * Function: resolve_entry
+ * Description: Adds the label named by an .entry directive to the external entries list.
  * 
- * @param pointerCode: Pointer to the current node in the code image linked list.
- * @param headLabel: Pointer to the head of the label linked list.
- * @param headExtEnt: Pointer to the pointer to the head of the external entries linked list.
- * @param opcode: Opcode of the instruction.
- * @param line: Line containing the operands.
+ * @param entry: The .entry directive, its argument is the label name as written in the line.
+ * @param symbols: Pointer to the symbol table.
+ * @param extEnt: Pointer to the external entries list.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
  * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-int build_operands (ptrCodeImg pointerCode, ptrLabel headLabel, ptrExtEnt **headExtEnt, int opcode, char* line) {
-  if (line == NULL) { /* Checking if the line is empty */
-    if (opcode == 14 || opcode == 15) { /* Handling cases where no operands are needed */
-      return NO;
-    }
+int resolve_entry(ptrFixup entry, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx) {
+  char* curArg = entry->arg;
+  ptrLabel label;
+  
+  /* Check if the argument is missing */
+  if(curArg==NULL) {
+    report(ctx, "\nMissing arguments in line %d: %.*s in file \"%s\"\n", entry->lineNum, entry->lineLength, entry->line, fileName);
+    return YES;
   }
-  else if ((opcode >= 7 && opcode <= 13) || opcode == 4 || opcode == 5) { /* Processing instructions that have single operands */
-    int addressingMode;
-    ptrLabel label;
-    if(line[strlen(line)-1] == '\n') line[strlen(line)-1] = '\0';
-    addressingMode = detect_addressing_mode(line);
-    strcat(pointerCode->output, "\n");
-    
-    if(addressingMode == DIRECT) {
-      strcat(pointerCode->output, direct_addressing(line, headLabel));
-      if((label = is_label(line, headLabel)) != NULL && label->labelType == EXTERNAL) build_ext_ent (headExtEnt, pointerCode->lineNum+101, EXTERNAL, line);
-      else if((label = is_label(line, headLabel)) != NULL && label->labelType == ENTRY) build_ext_ent (headExtEnt, pointerCode->lineNum+101, ENTRY, line);
-    }
-    
-    else if(addressingMode == IMMEDIATE) strcat(pointerCode->output, immediate_addressing(line, headLabel));
-    
-    else if(addressingMode == INDEX) {
-      strcat(pointerCode->output, index_addressing(line, headLabel));
-      line = strtok(line, "\040\t[\040\t");
-      if((label = is_label(line, headLabel)) != NULL && label->labelType == EXTERNAL) build_ext_ent (headExtEnt, pointerCode->lineNum+101, EXTERNAL, line);
-      else if((label = is_label(line, headLabel)) != NULL && label->labelType == ENTRY) build_ext_ent (headExtEnt, pointerCode->lineNum+101, ENTRY, line);
-    }
-    
-    else if(addressingMode == DIRECT_REGISTER) strcat(pointerCode->output, direct_register_addressing(NULL, line));
-    
-    return NO;
+  /* Check if the label is defined twice */
+  if(is_ext_ent(curArg, extEnt) != NULL) {
+    report(ctx, "\n\"%s\" is defined twice in line %d: %.*s in file \"%s\"\n", curArg, entry->lineNum, entry->lineLength, entry->line, fileName);
+    return YES;
   }
-  else if (opcode <=3 || opcode == 6) { /* Processing instructions that have two operands */
-    char* arg1 = malloc(strlen(line)+1);
-    char* arg2 = malloc(strlen(line)+1);
-    int addressingModeSource;
-    int addressingModeDestination;
-    ptrLabel label;
-    arg1 = strtok(line, "\040\t,\040\t");
-    arg2 = strtok(NULL, ",\040\t\n");
-    
-    addressingModeSource = detect_addressing_mode(arg1);
-    addressingModeDestination = detect_addressing_mode(arg2);
-    strcat(pointerCode->output, "\n");
-    
-    /* Source operand processing */
-    if(addressingModeSource == DIRECT) {
-      strcat(pointerCode->output, direct_addressing(arg1, headLabel));
-      if((label = is_label(arg1, headLabel)) != NULL && label->labelType == EXTERNAL) build_ext_ent (headExtEnt, pointerCode->lineNum+101, EXTERNAL, arg1);
-      else if((label = is_label(arg1, headLabel)) != NULL && label->labelType == ENTRY) build_ext_ent (headExtEnt, pointerCode->lineNum+101, ENTRY, arg1);
-    }
-    
-    else if(addressingModeSource == IMMEDIATE) strcat(pointerCode->output, immediate_addressing(arg1, headLabel));
-    
-    else if(addressingModeSource == INDEX) {
-      strcat(pointerCode->output, index_addressing(arg1, headLabel));
-      arg1 = strtok(arg1, "\040\t[\040\t");
-      if((label = is_label(arg1, headLabel)) != NULL && label->labelType == EXTERNAL) build_ext_ent (headExtEnt, pointerCode->lineNum+101, EXTERNAL, arg1);
-      else if((label = is_label(arg1, headLabel)) != NULL && label->labelType == ENTRY) build_ext_ent (headExtEnt, pointerCode->lineNum+101, ENTRY, arg1);
-    }
-    
-    else if(addressingModeSource == DIRECT_REGISTER) {
-      if(addressingModeDestination == DIRECT_REGISTER) {
-        strcat(pointerCode->output, direct_register_addressing(arg1, arg2));
-        return NO;
-      }
-      else {
-        strcat(pointerCode->output, direct_register_addressing(arg1, NULL));
-      }
-    }
-
-    strcat(pointerCode->output, "\n");
-    /* Destination operand processing */
-    if(addressingModeDestination == DIRECT) {
-      strcat(pointerCode->output, direct_addressing(arg2, headLabel));
-      if((label = is_label(arg2, headLabel)) != NULL && label->labelType == EXTERNAL) build_ext_ent (headExtEnt, pointerCode->lineNum+101, EXTERNAL, arg2);
-      else if((label = is_label(arg2, headLabel)) != NULL && label->labelType == ENTRY) build_ext_ent (headExtEnt, pointerCode->lineNum+101, ENTRY, arg2);
-    }
-    
-    else if(addressingModeDestination == IMMEDIATE) strcat(pointerCode->output, immediate_addressing(arg2, headLabel));
-    
-    else if(addressingModeDestination == INDEX) {
-      strcat(pointerCode->output, index_addressing(arg2, headLabel));
-      arg2 = strtok(arg2, "\040\t[\040\t");
-      if((label = is_label(arg2, headLabel)) != NULL && label->labelType == EXTERNAL) build_ext_ent (headExtEnt, pointerCode->lineNum+101, EXTERNAL, arg2);
-      else if((label = is_label(arg2, headLabel)) != NULL && label->labelType == ENTRY) build_ext_ent (headExtEnt, pointerCode->lineNum+101, ENTRY, arg2);
-    }
-    
-    else if(addressingModeDestination == DIRECT_REGISTER && addressingModeSource != DIRECT_REGISTER) strcat(pointerCode->output, direct_register_addressing(NULL, arg2));
-    
-    return NO;
+  curArg[strlen(curArg)-1] = '\0'; /* Drop the last character, the newline of the line */
+  if((label = is_label(curArg, symbols)) != NULL) build_ext_ent(extEnt, label->data, ENTRY, curArg);
+  else {
+    report(ctx, "\n\"%s\" is not defined and therefore cannot be entry in line %d: %.*s in file \"%s\"\n", curArg, entry->lineNum, entry->lineLength, entry->line, fileName);
+    return YES;
   }
-  return YES;
+  return NO;
 }
 
 /******************************************************
- * Function: build_ext_ent
- * Description: Builds external entries and adds them to the external entries linked list.
+ * Function: build_operand
+ * Description: Builds the word(s) of a single operand and records its use of external or entry labels.
  * 
- * @param hptr: Pointer to the pointer to the head of the external entries linked list.
- * @param lineNum: Line number associated with the external entry.
- * @param type: Type of the external entry (ENTRY or EXTERNAL).
- * @param varName: Name of the external entry.
+ * @param output: Where the operand word(s) are stored.
+ * @param operand: The operand, with its addressing mode and the index of its first word.
+ * @param symbols: Pointer to the symbol table.
+ * @param extEnt: Pointer to the external entries list.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-void build_ext_ent (ptrExtEnt **hptr, int lineNum, int type, char* varName) {
-  ptrExtEnt t = (ptrExtEnt) malloc(sizeof(itemExtEnt)); /*Create a new item in a linked list*/
-  ptrExtEnt p1, p2;
-
-  if(t==NULL) {
-    printf("\nCannot allocate memory\n");
-    exit(0);
+int build_operand (machineWord* output, ptrFixup operand, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx) {
+  char* arg = operand->arg;
+  ptrLabel label;
+  int isError = NO;
+  
+  if(operand->mode == DIRECT) {
+    if((isError = direct_addressing(arg, symbols, output)) == NO && (label = is_label(arg, symbols)) != NULL && (label->labelType == EXTERNAL || label->labelType == ENTRY))
+      build_ext_ent (extEnt, FIRST_ADDRESS+operand->slot, label->labelType, arg);
   }
   
-  t->lineNum = lineNum;
-  t->type = type;
-  t->varName = malloc(strlen(varName)+1);
-  strcpy(t->varName, varName);
+  else if(operand->mode == IMMEDIATE) isError = immediate_addressing(arg, symbols, output);
   
-  /* Traverse the linked list to find the end */
-  p1 = **hptr;
-  while ((p1)&&p1->lineNum<lineNum) {
-    p2 = p1;
-    p1 = p1->next;
+  else if(operand->mode == INDEX) {
+    if((isError = index_addressing(arg, symbols, output)) == NO && (label = is_label(arg, symbols)) != NULL && (label->labelType == EXTERNAL || label->labelType == ENTRY))
+      build_ext_ent (extEnt, FIRST_ADDRESS+operand->slot, label->labelType, arg); /* index_addressing leaves only the list name in arg */
   }
   
-  if (p1 == **hptr) { 
-    **hptr = t;
-    t->next = p1;
-  }
+  else isError = YES;
   
-  else {
-    p2->next = t;
-    t->next = p1;
-  }
+  if(isError == YES) report(ctx, "\n\"%s\" is an illegal or undefined argument in line %d: %.*s in file \"%s\"\n", arg, operand->lineNum, operand->lineLength, operand->line, fileName);
+  return isError;
 }
 
 /******************************************************
- * Function: freeLabel
- * Description: Frees allocated memory of the label linked list.
+ * Function: build_ext_ent
+ * Description: Appends an external or entry item to the external entries list.
  * 
- * @param hptr: Pointer to the pointer to the head of the label linked list.
+ * @param list: Pointer to the external entries list.
+ * @param lineNum: Address associated with the external entry.
+ * @param type: Type of the external entry (ENTRY or EXTERNAL).
+ * @param varName: Name of the external entry.
  ******************************************************/
-void freeLabel(ptrLabel * hptr) {
-  ptrLabel p;
+void build_ext_ent (extEntList* list, int lineNum, int type, char* varName) {
+  ptrExtEnt t;
   
-  /*Parse the linked list and free each item and its content*/
-  while(*hptr) { 
-    p = *hptr;
-    *hptr = (*hptr)->next;
-    free(p->labelName);
-    free(p);
+  /* Double the capacity when the list is full */
+  if(list->count == list->capacity) {
+    int capacity = list->capacity == 0 ? 16 : list->capacity*2;
+    list->items = (itemExtEnt*) arena_grow(list->memory, list->items, list->capacity*sizeof(itemExtEnt), capacity*sizeof(itemExtEnt));
+    list->capacity = capacity;
   }
+  
+  t = &list->items[list->count];
+  t->lineNum = lineNum;
+  t->type = type;
+  t->order = list->count++;
+  t->varName = arena_strdup(list->memory, varName);
+}
+
+/******************************************************
+ * Function: sort_ext_ent
+ * Description: Sorts the external entries list by address.
+ * 
+ * @param list: Pointer to the external entries list.
+ ******************************************************/
+void sort_ext_ent (extEntList* list) {
+  if(list->count > 1) qsort(list->items, list->count, sizeof(itemExtEnt), compare_ext_ent);
+}
+
+/******************************************************
+ * Function: compare_ext_ent
+ * Description: Orders external entries by address, the most recently
+ *		added first among items with the same address.
+ * 
+ * @param a: Pointer to the first item.
+ * @param b: Pointer to the second item.
+ * @return: Negative, zero or positive like strcmp.
+ ******************************************************/
+int compare_ext_ent (const void* a, const void* b) {
+  const itemExtEnt* first = (const itemExtEnt*) a;
+  const itemExtEnt* second = (const itemExtEnt*) b;
+  if(first->lineNum != second->lineNum) return first->lineNum - second->lineNum;
+  return second->order - first->order;
 }
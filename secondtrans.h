@@ -1,13 +1,57 @@
 /******************************************************
  * Function: secondtrans
- * Description: Performs the second pass of the assembly process, generating the output files.
+ * Description: Performs the second pass of the assembly process: patches the operands
+ *		recorded by the first pass now that the symbol table is complete,
+ *		then generates the output files.
  * 
- * @param am: Pointer to the modified assembly file.
- * @param headLabel: Pointer to the pointer to the head of the label linked list.
- * @param headDataImg: Pointer to the pointer to the head of the data image linked list.
- * @param headCodeImg: Pointer to the pointer to the head of the code image linked list.
- * @param fileName: Name of the output files.
- * @param IC: Value of the Instruction Counter.
- * @param DC: Value of the Data Counter.
+ * @param symbols: Pointer to the symbol table.
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image, with the fixups recorded by the first pass.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file, holding the final IC and DC.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
  ******************************************************/
-void secondtrans(FILE* am, ptrLabel *headLabel, ptrDataImg *headDataImg, ptrCodeImg *headCodeImg, char* fileName, int IC, int DC);
+int secondtrans(symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, char* fileName, assemblerContext* ctx);
+/******************************************************
+ * Function: patch_operands
+ * Description: Patches the operands among a range of fixups, the part of the second pass
+ *		a chunk of --split runs on its own. The .entry directives are left to
+ *		collect_ext_ent, and so is the order of the external entries: each item
+ *		added to the list holds the index of its fixup instead of its position.
+ * 
+ * @param codeImg: Pointer to the code image of the file.
+ * @param first: Index of the first fixup of the range.
+ * @param last: Index past the last fixup of the range.
+ * @param symbols: Pointer to the symbol table of the file.
+ * @param extEnt: Pointer to the external entries list of the range.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context the errors are reported to.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int patch_operands(codeImage* codeImg, int first, int last, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx);
+/******************************************************
+ * Function: collect_ext_ent
+ * Description: Builds the external entries list of the file from the lists of patch_operands,
+ *		resolving the .entry directives in between, in the order the second pass would.
+ * 
+ * @param fixups: Pointer to the fixups of the file.
+ * @param operands: The lists of patch_operands, in the order of their ranges.
+ * @param lists: Number of lists.
+ * @param symbols: Pointer to the symbol table.
+ * @param extEnt: Pointer to the external entries list of the file.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int collect_ext_ent(fixupList* fixups, extEntList* operands, int lists, symbolTable* symbols, extEntList* extEnt, char* fileName, assemblerContext* ctx);
+/******************************************************
+ * Function: export_image
+ * Description: Generates the output files, or the result of the library, once the operands are patched.
+ * 
+ * @param dataImg: Pointer to the data image.
+ * @param codeImg: Pointer to the code image.
+ * @param extEnt: Pointer to the external entries list.
+ * @param isRendered: YES if the words of the .ob file are already written.
+ * @param ctx: Context of the file, holding the final IC and DC.
+ ******************************************************/
+void export_image(wordImage* dataImg, codeImage* codeImg, extEntList* extEnt, int isRendered, assemblerContext* ctx);
@@ -0,0 +1,352 @@
+/******************************************************
+ * File: server.c
+ * Description: This file keeps the assembler resident
+ *              behind a Unix socket (--serve=SOCKET), so
+ *              a build that assembles many small modules
+ *              does not pay for starting a process and
+ *              filling the tables for each of them. A pool
+ *              of threads waits on the socket, each one
+ *              takes a request, assembles its files in the
+ *              directory of the client and replies with
+ *              their diagnostics. --client=SOCKET sends the
+ *              files of the command line to the server and
+ *              prints its reply, it assembles them itself
+ *              when no server is running.
+ *
+ *              The socket is only open to the user that
+ *              started the server, since a request names
+ *              the directory its files are written to.
+ *
+ *              A request is made of lines, read until the
+ *              client closes its side of the connection,
+ *              and holds at most MAX_REQUEST bytes:
+ *                dir DIRECTORY        names are relative to it
+ *                emit-am              also write the .am files
+ *                format bin           export .bin files
+ *                optimize N           run the optimizer passes of
+ *                                     the OPTIMIZE_ bits N
+ *                file NAME            assemble NAME.as
+ *                source LENGTH NAME   assemble the LENGTH bytes
+ *                                     that follow the line
+ ******************************************************/
+
+#include "universal.h"
+#include "arena.h"
+#include "context.h"
+#include "textBuffer.h"
+#include "assembleFile.h"
+#include "cache.h"
+#include <pthread.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define REQUEST_READ 4096 /*Room for every read of a request*/
+#define MAX_REQUEST (64L*1024*1024) /*Largest request the server keeps, sources included*/
+
+/* The listening socket shared by the threads of the pool */
+typedef struct serverPool {
+  int listener;
+  assemblerOptions* options;
+  pthread_mutex_t evicting; /*Held by the thread that evicts the cache*/
+} serverPool;
+
+void* serve_connections(void* arg);
+void handle_request(int connection, serverPool* pool);
+int read_request(int connection, textBuffer* request, long limit);
+int send_text(int connection, char* text, size_t length);
+int connect_server(char* socketName);
+int socket_address(char* socketName, struct sockaddr_un* address);
+
+/******************************************************
+ * Function: serve
+ * Description: Listens on a Unix socket and serves requests until the process is killed.
+ *
+ * @param socketName: Path of the socket, an old socket there is replaced.
+ * @param options: Command-line options, the number of jobs is the size of the pool.
+ ******************************************************/
+void serve(char* socketName, assemblerOptions* options) {
+  struct sockaddr_un address;
+  serverPool pool;
+  pthread_t thread;
+  mode_t mask;
+  int i;
+
+  if(socket_address(socketName, &address) == YES) return;
+  if((pool.listener = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+    printf("\nFATAL ERROR: Cannot create socket \"%s\"\n", socketName);
+    return;
+  }
+  unlink(socketName);
+  /* The socket is created without access for the group and others, the pool is not running yet */
+  mask = umask(077);
+  if(bind(pool.listener, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(pool.listener, SOMAXCONN) != 0) {
+    umask(mask);
+    printf("\nFATAL ERROR: Cannot listen on socket \"%s\"\n", socketName);
+    close(pool.listener);
+    return;
+  }
+  umask(mask);
+  pool.options = options;
+  pthread_mutex_init(&pool.evicting, NULL);
+  signal(SIGPIPE, SIG_IGN); /* A client that went away only fails its own reply */
+
+  /* The calling thread is one of the pool */
+  for(i = 1; i < options->jobs; i++)
+    if(pthread_create(&thread, NULL, serve_connections, &pool) != 0 || pthread_detach(thread) != 0) break;
+  serve_connections(&pool);
+}
+
+/******************************************************
+ * Function: serve_connections
+ * Description: Accepts connections and handles their requests, one at a time.
+ *
+ * @param arg: Pointer to the server pool.
+ * @return NULL, only when the socket fails.
+ ******************************************************/
+void* serve_connections(void* arg) {
+  serverPool* pool = (serverPool*) arg;
+  int connection;
+
+  while(1) {
+    if((connection = accept(pool->listener, NULL, NULL)) == -1) {
+      if(errno == EINTR || errno == ECONNABORTED) continue;
+      return NULL;
+    }
+    handle_request(connection, pool);
+    close(connection);
+  }
+}
+
+/******************************************************
+ * Function: handle_request
+ * Description: Assembles the files of a request and replies with their diagnostics.
+ *
+ * @param connection: The connection of the client.
+ * @param pool: The server pool, with the options of the server. The request may add its own.
+ ******************************************************/
+void handle_request(int connection, serverPool* pool) {
+  assemblerOptions requestOptions = *pool->options;
+  assemblerContext ctx;
+  arena memory; /*Owns the request and the reply*/
+  textBuffer request;
+  textBuffer reply;
+  textBuffer source;
+  char* directory = NULL;
+  char* line;
+  char* end;
+  int isStored = NO;
+
+  init_arena(&memory);
+  init_text_buffer(&request, &memory);
+  init_text_buffer(&reply, &memory);
+  requestOptions.emitAm = NO;
+  requestOptions.format = FORMAT_TEXT;
+  requestOptions.optimize = 0;
+  if(read_request(connection, &request, MAX_REQUEST) == YES) {
+    if(request.length > MAX_REQUEST) {
+      char message[BUFFER];
+      sprintf(message, "\nFATAL ERROR: The request is larger than %ld bytes\n", MAX_REQUEST);
+      send_text(connection, message, strlen(message));
+    }
+    free_arena(&memory);
+    return;
+  }
+
+  line = request.text;
+  while(line < request.text + request.length) {
+    long length = 0;
+    char* name = NULL;
+
+    if((end = (char*) memchr(line, '\n', request.text + request.length - line)) == NULL) end = request.text + request.length;
+    *end = '\0';
+    if(strncmp(line, "dir ", 4) == 0) directory = line+4;
+    else if(strcmp(line, "emit-am") == 0) requestOptions.emitAm = YES;
+    else if(strcmp(line, "format bin") == 0) requestOptions.format = FORMAT_BIN;
+    else if(strncmp(line, "optimize ", 9) == 0) requestOptions.optimize = atoi(line+9);
+    else if(strncmp(line, "file ", 5) == 0 && line[5] != '\0') name = line+5;
+    else if(strncmp(line, "source ", 7) == 0 && sscanf(line+7, "%ld", &length) == 1 && length >= 0 &&
+            length <= request.text + request.length - (end+1) && (name = strchr(line+7, ' ')) != NULL && name[1] != '\0') name++;
+    else {
+      char message[BUFFER*2];
+      sprintf(message, "\nInvalid request line: %.*s\n", BUFFER, line);
+      append_text(&reply, message, strlen(message));
+      break;
+    }
+
+    if(name != NULL) {
+      init_context(&ctx, name, &requestOptions);
+      ctx.directory = directory;
+      if(strncmp(line, "file ", 5) == 0) assemble_file(&ctx);
+      else {
+        /* The source is copied so the request is not changed by the passes */
+        init_text_buffer(&source, &ctx.memory);
+        append_text(&source, end+1, length);
+        assemble_source(&ctx, &source);
+        free_arena(&ctx.memory);
+        end += length;
+      }
+      if(ctx.reportLength > 0) append_text(&reply, ctx.report, ctx.reportLength);
+      free(ctx.report);
+      if(ctx.isStored == YES) isStored = YES;
+    }
+    line = end+1;
+  }
+
+  send_text(connection, reply.text, reply.length);
+  free_arena(&memory);
+  /*Only new entries can take the cache over its budget, one thread evicts at a time and the others skip it*/
+  if(isStored == YES && pthread_mutex_trylock(&pool->evicting) == 0) {
+    evict_cache(pool->options);
+    pthread_mutex_unlock(&pool->evicting);
+  }
+}
+
+/******************************************************
+ * Function: read_request
+ * Description: Reads a request until the client closes its side of the connection.
+ *		Past the limit the rest is read and dropped, so the client can still get a reply.
+ *
+ * @param connection: The connection of the client.
+ * @param request: The text buffer the request is read into.
+ * @param limit: Most bytes kept, 0 for no limit.
+ * @return: int indicating whether an error occurred or the request is over the limit (YES) or not (NO).
+ ******************************************************/
+int read_request(int connection, textBuffer* request, long limit) {
+  ssize_t length;
+  char* room = NULL;
+
+  do {
+    /* Once over the limit, every read goes to the same room */
+    if(limit == 0 || (long) request->length <= limit) room = reserve_text(request, REQUEST_READ);
+    length = read(connection, room, REQUEST_READ);
+    if(length > 0 && (limit == 0 || (long) request->length <= limit)) request->length += length;
+  } while(length > 0 || (length == -1 && errno == EINTR));
+  return length == 0 && (limit == 0 || (long) request->length <= limit) ? NO : YES;
+}
+
+/******************************************************
+ * Function: send_text
+ * Description: Writes all of a text to a connection.
+ *
+ * @param connection: The connection.
+ * @param text: The text.
+ * @param length: Length of the text.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int send_text(int connection, char* text, size_t length) {
+  ssize_t written;
+
+  while(length > 0) {
+    if((written = write(connection, text, length)) == -1) {
+      if(errno == EINTR) continue;
+      return YES;
+    }
+    text += written;
+    length -= written;
+  }
+  return NO;
+}
+
+/******************************************************
+ * Function: run_client
+ * Description: Sends the files to the server and prints its reply.
+ *
+ * @param socketName: Path of the socket of the server.
+ * @param files: Contexts of the files, in command-line order.
+ * @param count: Number of files.
+ * @param options: Command-line options.
+ * @return: int indicating whether the server could not be reached (YES) or not (NO).
+ ******************************************************/
+int run_client(char* socketName, assemblerContext* files, int count, assemblerOptions* options) {
+  arena memory;
+  textBuffer request;
+  textBuffer reply;
+  char* directory = NULL;
+  size_t size = BUFFER*4;
+  int connection;
+  int i;
+
+  if((connection = connect_server(socketName)) == -1) return YES;
+  init_arena(&memory);
+  init_text_buffer(&request, &memory);
+  init_text_buffer(&reply, &memory);
+
+  /* Names are relative to the working directory of the client */
+  while(directory == NULL) {
+    directory = (char*) arena_alloc(&memory, size);
+    if(getcwd(directory, size) == NULL) {
+      if(errno != ERANGE) {
+        printf("\nFATAL ERROR: Cannot find the working directory\n");
+        exit(0);
+      }
+      directory = NULL;
+      size *= 2;
+    }
+  }
+  append_text(&request, "dir ", 4);
+  append_line(&request, directory, strlen(directory));
+  if(options->emitAm == YES) append_line(&request, "emit-am", 7);
+  if(options->format == FORMAT_BIN) append_line(&request, "format bin", 10);
+  if(options->optimize != 0) {
+    char optimize[32];
+    sprintf(optimize, "optimize %d", options->optimize);
+    append_line(&request, optimize, strlen(optimize));
+  }
+  for(i = 0; i < count; i++) {
+    append_text(&request, "file ", 5);
+    append_line(&request, files[i].fileName, strlen(files[i].fileName));
+  }
+
+  /* The server replies once it has read the whole request */
+  if(send_text(connection, request.text, request.length) == YES || shutdown(connection, SHUT_WR) != 0 ||
+     read_request(connection, &reply, 0) == YES) printf("\nFATAL ERROR: Lost the connection to the server\n");
+  else if(reply.length > 0) fwrite(reply.text, 1, reply.length, stdout);
+  close(connection);
+  free_arena(&memory);
+  return NO;
+}
+
+/******************************************************
+ * Function: connect_server
+ * Description: Connects to the server listening on a Unix socket.
+ *
+ * @param socketName: Path of the socket.
+ * @return: The connection, -1 if no server listens there.
+ ******************************************************/
+int connect_server(char* socketName) {
+  struct sockaddr_un address;
+  int connection;
+
+  if(socket_address(socketName, &address) == YES) return -1;
+  if((connection = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) return -1;
+  if(connect(connection, (struct sockaddr*) &address, sizeof(address)) != 0) {
+    close(connection);
+    return -1;
+  }
+  signal(SIGPIPE, SIG_IGN); /* A server that went away is reported by the failed write */
+  return connection;
+}
+
+/******************************************************
+ * Function: socket_address
+ * Description: Builds the address of a Unix socket.
+ *
+ * @param socketName: Path of the socket.
+ * @param address: The address to fill.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int socket_address(char* socketName, struct sockaddr_un* address) {
+  memset(address, 0, sizeof(*address));
+  if(strlen(socketName) >= sizeof(address->sun_path)) {
+    printf("\nThe socket name \"%s\" is too long\n", socketName);
+    return YES;
+  }
+  address->sun_family = AF_UNIX;
+  strcpy(address->sun_path, socketName);
+  return NO;
+}
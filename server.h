@@ -0,0 +1,19 @@
+/******************************************************
+ * Function: serve
+ * Description: Listens on a Unix socket and serves requests until the process is killed.
+ *
+ * @param socketName: Path of the socket, an old socket there is replaced.
+ * @param options: Command-line options, the number of jobs is the size of the pool.
+ ******************************************************/
+void serve(char* socketName, assemblerOptions* options);
+/******************************************************
+ * Function: run_client
+ * Description: Sends the files to the server and prints its reply.
+ *
+ * @param socketName: Path of the socket of the server.
+ * @param files: Contexts of the files, in command-line order.
+ * @param count: Number of files.
+ * @param options: Command-line options.
+ * @return: int indicating whether the server could not be reached (YES) or not (NO).
+ ******************************************************/
+int run_client(char* socketName, assemblerContext* files, int count, assemblerOptions* options);
@@ -0,0 +1,514 @@
+/******************************************************
+ * File: simulator.c
+ * Description: This program runs the .ob files of the
+ *              assembler. The code is decoded once, when
+ *              it is loaded, into an instruction per
+ *              address that holds the handler of its
+ *              opcode and where its operands are. The
+ *              run loop then only calls the handler of
+ *              the current address, which returns the next
+ *              one. A program that writes over its own
+ *              code keeps running the code it was loaded
+ *              with. red reads a character from stdin and
+ *              prn prints one to stdout, both buffered.
+ ******************************************************/
+
+#include "universal.h"
+#include "objectFile.h"
+
+#define OUTPUT_BUFFER 65536 /*Bytes of stdout buffered between writes*/
+
+int init_simulator(simulator* sim, objectImage* image, char* fileName);
+int decode_instruction(simulator* sim, int address, char* fileName);
+int decode_operand(simulator* sim, simInstruction* instruction, simOperand* operand, int mode, int address, int isSource);
+machineWord code_word(simulator* sim, int address);
+int immediate_value(machineWord word);
+int run(simulator* sim);
+int jump(simulator* sim, simInstruction* instruction, int target);
+int runtime_error(simInstruction* instruction, const char* message);
+int exec_mov(simulator* sim, simInstruction* instruction);
+int exec_cmp(simulator* sim, simInstruction* instruction);
+int exec_add(simulator* sim, simInstruction* instruction);
+int exec_sub(simulator* sim, simInstruction* instruction);
+int exec_not(simulator* sim, simInstruction* instruction);
+int exec_clr(simulator* sim, simInstruction* instruction);
+int exec_lea(simulator* sim, simInstruction* instruction);
+int exec_inc(simulator* sim, simInstruction* instruction);
+int exec_dec(simulator* sim, simInstruction* instruction);
+int exec_jmp(simulator* sim, simInstruction* instruction);
+int exec_bne(simulator* sim, simInstruction* instruction);
+int exec_red(simulator* sim, simInstruction* instruction);
+int exec_prn(simulator* sim, simInstruction* instruction);
+int exec_jsr(simulator* sim, simInstruction* instruction);
+int exec_rts(simulator* sim, simInstruction* instruction);
+int exec_hlt(simulator* sim, simInstruction* instruction);
+int exec_fault(simulator* sim, simInstruction* instruction);
+
+/* Handlers of the opcodes, in the order of reservedWords */
+const executeFunction handlers[OPCODE] = {
+  exec_mov, exec_cmp, exec_add, exec_sub, exec_not, exec_clr, exec_lea, exec_inc,
+  exec_dec, exec_jmp, exec_bne, exec_red, exec_prn, exec_jsr, exec_rts, exec_hlt
+};
+
+/******************************************************
+ * Function: main
+ * Description: The entry point of the simulator,
+ *		recieves the .ob file to run from the command line.
+ *
+ * @param argc: The number of command-line arguments.
+ * @param argv: An array of pointers to the arguments.
+ * @return 0 if the program reached hlt, 1 otherwise.
+ ******************************************************/
+int main(int argc, char* argv[]) {
+  objectImage image;
+  simulator* sim;
+  char* fileName;
+  size_t length;
+  int isError;
+
+  if(argc < 2) {
+    printf("\nYou didn't enter a file to be run\n");
+    return 1;
+  }
+
+  /* The .ob extension may be left out, as with the assembler, a .bin file is given with its extension */
+  length = strlen(argv[1]);
+  if((fileName = (char*) malloc(length+4)) == NULL || (sim = (simulator*) malloc(sizeof(simulator))) == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+  strcpy(fileName, argv[1]);
+  if((length < 3 || strcmp(fileName+length-3, ".ob") != 0) && (length < 4 || strcmp(fileName+length-4, ".bin") != 0)) strcat(fileName, ".ob");
+
+  if((isError = load_object(fileName, &image)) == NO) {
+    isError = init_simulator(sim, &image, fileName);
+    free_object(&image);
+  }
+  if(isError == NO) {
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER);
+    isError = run(sim);
+    fflush(stdout);
+    free(sim->code);
+  }
+  free(sim);
+  free(fileName);
+  return isError == YES ? 1 : 0;
+}
+
+/******************************************************
+ * Function: init_simulator
+ * Description: Loads an object image to memory, clears the registers and decodes the code.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param image: Pointer to the object image.
+ * @param fileName: Name of the .ob file, for the diagnostics.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int init_simulator(simulator* sim, objectImage* image, char* fileName) {
+  int address;
+
+  memset(sim->memory, 0, sizeof(sim->memory));
+  memset(sim->registers, 0, sizeof(sim->registers));
+  memcpy(sim->memory+FIRST_ADDRESS, image->words, (image->IC+image->DC)*sizeof(machineWord));
+  sim->zero = NO;
+  sim->depth = 0;
+  sim->codeEnd = FIRST_ADDRESS+image->IC;
+
+  /* Every address up to the end of the code faults until an instruction is decoded at it */
+  if((sim->code = (simInstruction*) malloc((sim->codeEnd+1)*sizeof(simInstruction))) == NULL) {
+    printf("\nFATAL ERROR: Cannot allocate memory\n");
+    exit(0);
+  }
+  for(address = 0; address <= sim->codeEnd; address++) {
+    sim->code[address].execute = exec_fault;
+    sim->code[address].address = address;
+    sim->code[address].length = 0;
+    sim->code[address].fault = address < sim->codeEnd ? "the address does not start an instruction" : "the program ran past the end of its code";
+  }
+
+  for(address = FIRST_ADDRESS; address < sim->codeEnd; address += sim->code[address].length)
+    if(decode_instruction(sim, address, fileName) == YES) {
+      free(sim->code);
+      return YES;
+    }
+  return NO;
+}
+
+/******************************************************
+ * Function: decode_instruction
+ * Description: Decodes the instruction at an address of the code.
+ *		Operands the instruction cannot use make it fault when it is executed.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param address: Address of the first word of the instruction.
+ * @param fileName: Name of the .ob file, for the diagnostics.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int decode_instruction(simulator* sim, int address, char* fileName) {
+  simInstruction* instruction = &sim->code[address];
+  machineWord word = sim->memory[address];
+  int opcode = (word >> 6) & 15;
+  int sourceMode = (word >> 4) & 3;
+  int destinationMode = (word >> 2) & 3;
+  int next = address+1;
+
+  instruction->execute = handlers[opcode];
+  instruction->source.mode = IMMEDIATE;
+  instruction->destination.mode = IMMEDIATE;
+  if(opcode <= 3 || opcode == 6) {
+    next = decode_operand(sim, instruction, &instruction->source, sourceMode, next, YES);
+    if(sourceMode == DIRECT_REGISTER && destinationMode == DIRECT_REGISTER) next--; /* Two registers share a word */
+    next = decode_operand(sim, instruction, &instruction->destination, destinationMode, next, NO);
+  }
+  else if(opcode < 14) next = decode_operand(sim, instruction, &instruction->destination, destinationMode, next, NO);
+
+  if(next > sim->codeEnd) {
+    printf("\nThe instruction at address %04d in file \"%s\" is cut off by the end of the code\n", address, fileName);
+    return YES;
+  }
+  instruction->length = next-address;
+
+  /* Only cmp and prn read an immediate destination, lea needs the address of its source */
+  if(instruction->execute != exec_fault) {
+    if(opcode < 14 && opcode != 1 && opcode != 12 && destinationMode == IMMEDIATE) instruction->fault = "the destination operand is immediate";
+    else if(opcode == 6 && (sourceMode == IMMEDIATE || sourceMode == DIRECT_REGISTER)) instruction->fault = "lea needs a label as its source operand";
+    else return NO;
+    instruction->execute = exec_fault;
+  }
+  return NO;
+}
+
+/******************************************************
+ * Function: decode_operand
+ * Description: Finds the register, memory word or immediate value of an operand.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction of the operand.
+ * @param operand: Pointer to the operand to decode.
+ * @param mode: Addressing mode of the operand.
+ * @param address: Address of the first word of the operand.
+ * @param isSource: YES for a source operand, NO for a destination operand.
+ * @return: The address after the words of the operand.
+ ******************************************************/
+int decode_operand(simulator* sim, simInstruction* instruction, simOperand* operand, int mode, int address, int isSource) {
+  machineWord word = code_word(sim, address);
+
+  operand->mode = mode;
+  if(mode == IMMEDIATE) {
+    operand->value = immediate_value(word);
+    operand->immediate = (machineWord) (operand->value & WORD_MASK);
+    operand->location = &operand->immediate;
+    return address+1;
+  }
+  if(mode == DIRECT_REGISTER) {
+    operand->value = isSource == YES ? (word >> 5) & 7 : (word >> 2) & 7;
+    operand->location = &sim->registers[operand->value];
+    return address+1;
+  }
+
+  /* A label, followed by the index of INDEX operands */
+  operand->value = word >> 2;
+  if(mode == INDEX) operand->value += immediate_value(code_word(sim, address+1));
+  operand->location = &sim->memory[0];
+  if((word & 3) == ARE_EXTERNAL) {
+    instruction->execute = exec_fault;
+    instruction->fault = "an operand refers to an external label";
+  }
+  else if(operand->value < 0 || operand->value >= SIM_MEMORY) {
+    instruction->execute = exec_fault;
+    instruction->fault = "an operand is outside the memory";
+  }
+  else operand->location = &sim->memory[operand->value];
+  return address + (mode == INDEX ? 2 : 1);
+}
+
+/******************************************************
+ * Function: code_word
+ * Description: Reads a word of the code, words after the code read as 0.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param address: Address of the word.
+ * @return: The word.
+ ******************************************************/
+machineWord code_word(simulator* sim, int address) {
+  return address < sim->codeEnd ? sim->memory[address] : 0;
+}
+
+/******************************************************
+ * Function: immediate_value
+ * Description: Extracts the signed 12-bit value of an operand word.
+ *
+ * @param word: The operand word.
+ * @return: The value.
+ ******************************************************/
+int immediate_value(machineWord word) {
+  int value = word >> 2;
+  return value & 0x800 ? value - 0x1000 : value;
+}
+
+/******************************************************
+ * Function: run
+ * Description: Executes the program from its first address until hlt or a runtime error.
+ *
+ * @param sim: Pointer to the simulator.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int run(simulator* sim) {
+  simInstruction* code = sim->code;
+  int address = FIRST_ADDRESS;
+
+  while(address >= 0) address = code[address].execute(sim, &code[address]);
+  return address == SIM_ERROR ? YES : NO;
+}
+
+/******************************************************
+ * Function: jump
+ * Description: Checks the target of a jump.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the jumping instruction.
+ * @param target: The address jumped to.
+ * @return: The next address to execute.
+ ******************************************************/
+int jump(simulator* sim, simInstruction* instruction, int target) {
+  if(target >= sim->codeEnd) return runtime_error(instruction, "the program jumped outside its code");
+  return target;
+}
+
+/******************************************************
+ * Function: runtime_error
+ * Description: Prints a runtime error.
+ *
+ * @param instruction: Pointer to the failing instruction.
+ * @param message: What went wrong.
+ * @return: SIM_ERROR.
+ ******************************************************/
+int runtime_error(simInstruction* instruction, const char* message) {
+  printf("\nRuntime error at address %04d: %s\n", instruction->address, message);
+  return SIM_ERROR;
+}
+
+/******************************************************
+ * Function: exec_mov
+ * Description: Copies the source operand to the destination operand.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_mov(simulator* sim, simInstruction* instruction) {
+  *instruction->destination.location = *instruction->source.location;
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_cmp
+ * Description: Sets the Z flag if the operands are equal.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_cmp(simulator* sim, simInstruction* instruction) {
+  sim->zero = *instruction->source.location == *instruction->destination.location;
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_add
+ * Description: Adds the source operand to the destination operand.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_add(simulator* sim, simInstruction* instruction) {
+  machineWord* destination = instruction->destination.location;
+  *destination = (machineWord) ((*destination + *instruction->source.location) & WORD_MASK);
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_sub
+ * Description: Subtracts the source operand from the destination operand.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_sub(simulator* sim, simInstruction* instruction) {
+  machineWord* destination = instruction->destination.location;
+  *destination = (machineWord) ((*destination - *instruction->source.location) & WORD_MASK);
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_not
+ * Description: Inverts the bits of the operand.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_not(simulator* sim, simInstruction* instruction) {
+  machineWord* destination = instruction->destination.location;
+  *destination = (machineWord) (~*destination & WORD_MASK);
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_clr
+ * Description: Clears the operand.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_clr(simulator* sim, simInstruction* instruction) {
+  *instruction->destination.location = 0;
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_lea
+ * Description: Stores the address of the source operand in the destination operand.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_lea(simulator* sim, simInstruction* instruction) {
+  *instruction->destination.location = (machineWord) instruction->source.value;
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_inc
+ * Description: Adds one to the operand.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_inc(simulator* sim, simInstruction* instruction) {
+  machineWord* destination = instruction->destination.location;
+  *destination = (machineWord) ((*destination + 1) & WORD_MASK);
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_dec
+ * Description: Subtracts one from the operand.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_dec(simulator* sim, simInstruction* instruction) {
+  machineWord* destination = instruction->destination.location;
+  *destination = (machineWord) ((*destination - 1) & WORD_MASK);
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_jmp
+ * Description: Jumps to the label of the operand, or to the address in its register.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_jmp(simulator* sim, simInstruction* instruction) {
+  simOperand* operand = &instruction->destination;
+  return jump(sim, instruction, operand->mode == DIRECT_REGISTER ? *operand->location : operand->value);
+}
+
+/******************************************************
+ * Function: exec_bne
+ * Description: Jumps like jmp if the Z flag is not set.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_bne(simulator* sim, simInstruction* instruction) {
+  if(sim->zero) return instruction->address + instruction->length;
+  return exec_jmp(sim, instruction);
+}
+
+/******************************************************
+ * Function: exec_red
+ * Description: Reads a character from stdin to the operand, -1 at the end of the input.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_red(simulator* sim, simInstruction* instruction) {
+  *instruction->destination.location = (machineWord) (getchar() & WORD_MASK);
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_prn
+ * Description: Prints the character in the operand to stdout.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_prn(simulator* sim, simInstruction* instruction) {
+  putchar(*instruction->destination.location & 0xFF);
+  return instruction->address + instruction->length;
+}
+
+/******************************************************
+ * Function: exec_jsr
+ * Description: Pushes the return address and jumps like jmp.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_jsr(simulator* sim, simInstruction* instruction) {
+  if(sim->depth == SIM_STACK) return runtime_error(instruction, "too many nested jsr");
+  sim->stack[sim->depth++] = instruction->address + instruction->length;
+  return exec_jmp(sim, instruction);
+}
+
+/******************************************************
+ * Function: exec_rts
+ * Description: Returns to the address pushed by the last jsr.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: The next address to execute.
+ ******************************************************/
+int exec_rts(simulator* sim, simInstruction* instruction) {
+  if(sim->depth == 0) return runtime_error(instruction, "rts without jsr");
+  return sim->stack[--sim->depth];
+}
+
+/******************************************************
+ * Function: exec_hlt
+ * Description: Stops the program.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: SIM_HALT.
+ ******************************************************/
+int exec_hlt(simulator* sim, simInstruction* instruction) {
+  return SIM_HALT;
+}
+
+/******************************************************
+ * Function: exec_fault
+ * Description: Stops the program at an instruction that cannot be executed.
+ *
+ * @param sim: Pointer to the simulator.
+ * @param instruction: Pointer to the instruction.
+ * @return: SIM_ERROR.
+ ******************************************************/
+int exec_fault(simulator* sim, simInstruction* instruction) {
+  return runtime_error(instruction, instruction->fault);
+}
@@ -0,0 +1,335 @@
+/******************************************************
+ * File: split.c
+ * Description: This file assembles a single large file on
+ *              several threads (--split=N). The expanded
+ *              source is cut at line boundaries into chunks
+ *              and the first pass runs on each chunk apart,
+ *              with its own counters from 0 and its own
+ *              symbol table, which records every definition
+ *              it makes. The chunks are then joined in line
+ *              order: their instructions and data move to
+ *              where the earlier chunks end, and their
+ *              definitions are replayed on the symbol table
+ *              of the file. The operands of each chunk are
+ *              patched and its words written to the .ob file
+ *              on its thread again, and the externals and the
+ *              entries are collected in line order.
+ *
+ *              A chunk may rely on labels of earlier chunks
+ *              in ways the first pass cannot tell on its own,
+ *              and errors have to be reported in line order.
+ *              Whenever either happens the file is assembled
+ *              again by a single thread, so the outputs and
+ *              diagnostics are always those of the passes.
+ ******************************************************/
+
+#include "universal.h"
+#include "firsttrans.h"
+#include "secondtrans.h"
+#include "exportFiles.h"
+#include "symbolTable.h"
+#include "wordImage.h"
+#include "arena.h"
+#include "context.h"
+#include "textBuffer.h"
+#include "stats.h"
+#include <pthread.h>
+
+/* A chunk of the expanded source, with the state of its passes */
+typedef struct splitChunk {
+  assemblerContext ctx; /*Counters of the chunk, its arena and its diagnostics*/
+  assemblerStats stats;
+  textBuffer lines; /*The lines of the chunk, a view of the expanded source*/
+  symbolTable symbols; /*Definitions of the chunk, then a copy of the table of the file*/
+  symbolEventList events;
+  wordImage dataImg;
+  codeImage codeImg;
+  int isError;
+  int codeBase; /*Where the instructions of the chunk start in the file*/
+  int dataBase; /*Where the data of the chunk starts in the file*/
+  int firstFixup; /*The fixups of the chunk among those of the file*/
+  int lastFixup;
+  extEntList extEnt; /*Externals and entries used by the operands of the chunk*/
+  codeImage* fileCode; /*Images of the file for the second pass*/
+  wordImage* fileData;
+  char* fileName;
+  char* words; /*Where the .ob lines of the words start, NULL when they are not written here*/
+} splitChunk;
+
+int split_lines(textBuffer* am, int* firstLines, size_t* positions, int split);
+void run_chunks(splitChunk* chunks, int count, void* (*work)(void*));
+void* first_chunk(void* arg);
+void* second_chunk(void* arg);
+int join_chunks(splitChunk* chunks, int count, symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, assemblerContext* ctx);
+int patch_chunks(splitChunk* chunks, int count, symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, assemblerContext* ctx);
+
+/******************************************************
+ * Function: split_file
+ * Description: Performs both passes over the expanded source on --split threads.
+ *		The file is left as it was for firsttrans when it is too short
+ *		to be split, or when a single thread has to assemble it. The optimizer
+ *		works on the code image of the whole file, so with -O it is never split.
+ *
+ * @param am: Text buffer holding the expanded source.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
+ * @return: YES if the file was assembled, NO otherwise.
+ ******************************************************/
+int split_file(textBuffer* am, char* fileName, assemblerContext* ctx) {
+  splitChunk* chunks;
+  symbolTable symbols;
+  wordImage dataImg;
+  codeImage codeImg;
+  int firstLines[MAX_SPLIT]; /*First line of every chunk, from the first line of the file*/
+  size_t positions[MAX_SPLIT+1]; /*Where every chunk starts in the text, and where the last one ends*/
+  int lineCounterAm = ctx->lineCounterAm;
+  size_t reportLength = ctx->reportLength;
+  int isDone = NO;
+  int count, i;
+
+  if(ctx->options->optimize != 0 || (count = split_lines(am, firstLines, positions, ctx->options->split)) < 2) return NO;
+  if((chunks = (splitChunk*) malloc(count*sizeof(splitChunk))) == NULL) out_of_memory(&ctx->memory);
+
+  SWITCH_PHASE(ctx, PHASE_FIRST);
+  for(i = 0; i < count; i++) {
+    splitChunk* chunk = &chunks[i];
+    init_context(&chunk->ctx, ctx->fileName, ctx->options);
+    chunk->ctx.directory = ctx->directory;
+    chunk->ctx.lineCounterAm = lineCounterAm + firstLines[i];
+    init_stats(&chunk->stats);
+    if(ctx->stats != NULL) chunk->ctx.stats = &chunk->stats;
+    chunk->lines = *am;
+    chunk->lines.position = positions[i];
+    chunk->lines.length = positions[i+1];
+    chunk->events.items = NULL;
+    chunk->events.count = 0;
+    chunk->events.capacity = 0;
+    chunk->events.memory = &chunk->ctx.memory;
+    init_symbol_table(&chunk->symbols, &chunk->ctx.memory);
+    chunk->symbols.events = &chunk->events;
+    init_word_image(&chunk->dataImg, &chunk->ctx.memory);
+    init_code_image(&chunk->codeImg, &chunk->ctx.memory);
+    chunk->extEnt.items = NULL;
+    chunk->extEnt.count = 0;
+    chunk->extEnt.capacity = 0;
+    chunk->extEnt.memory = &chunk->ctx.memory;
+    chunk->fileName = fileName;
+  }
+  run_chunks(chunks, count, first_chunk);
+
+  init_symbol_table(&symbols, &ctx->memory);
+  init_word_image(&dataImg, &ctx->memory);
+  init_code_image(&codeImg, &ctx->memory);
+  if(join_chunks(chunks, count, &symbols, &dataImg, &codeImg, ctx) == NO) {
+    SWITCH_PHASE(ctx, PHASE_SECOND);
+    if(patch_chunks(chunks, count, &symbols, &dataImg, &codeImg, ctx) == NO) isDone = YES;
+  }
+
+  /* The work of the chunks is only counted when it is kept */
+  for(i = 0; i < count; i++) {
+    if(isDone == YES) {
+      ADD_STAT(ctx, lines[PHASE_FIRST], chunks[i].stats.lines[PHASE_FIRST]);
+      ADD_STAT(ctx, opcodeLookups, chunks[i].stats.opcodeLookups);
+      ADD_STAT(ctx, labelLookups, chunks[i].symbols.lookups);
+      ADD_STAT(ctx, bytesAllocated, (long) chunks[i].ctx.memory.reserved);
+    }
+    free(chunks[i].ctx.report);
+    free_arena(&chunks[i].ctx.memory);
+  }
+  free(chunks);
+  if(isDone == YES) {
+    ADD_STAT(ctx, symbols, symbols.count);
+    ADD_STAT(ctx, labelLookups, symbols.lookups);
+    return YES;
+  }
+
+  /* Start over on a single thread */
+  ctx->IC = 0;
+  ctx->DC = 0;
+  ctx->lineCounterAm = lineCounterAm;
+  ctx->reportLength = reportLength;
+  if(ctx->report != NULL) ctx->report[reportLength] = '\0';
+  for(i = 0; i < OUTPUTS; i++) ctx->output[i].length = 0;
+  return NO;
+}
+
+/******************************************************
+ * Function: split_lines
+ * Description: Cuts the expanded source into chunks of whole lines, SPLIT_LINES at least.
+ *
+ * @param am: Text buffer holding the expanded source, it is not moved.
+ * @param firstLines: Where the first line of every chunk is stored, counted from 0.
+ * @param positions: Where the start of every chunk in the text is stored, followed by the end of the last one.
+ * @param split: Most chunks there may be.
+ * @return: Number of chunks, less than 2 when the file is not split.
+ ******************************************************/
+int split_lines(textBuffer* am, int* firstLines, size_t* positions, int split) {
+  textBuffer view = *am;
+  long lines = 0;
+  long line = 0;
+  int length;
+  int count, i;
+  char* text;
+
+  /* A line that is too long is an error, which only the first pass reports in order */
+  while((text = next_line(&view, BUFFER-1, &length)) != NULL) {
+    if(text[length-1] != '\n') return 0;
+    lines++;
+  }
+  count = (int) (lines/SPLIT_LINES < split ? lines/SPLIT_LINES : split);
+  if(count > MAX_SPLIT) count = MAX_SPLIT;
+  if(count < 2) return count;
+
+  view.position = am->position;
+  for(i = 0; i < count; i++) {
+    for(; line < lines*i/count; line++) next_line(&view, BUFFER-1, &length);
+    firstLines[i] = (int) line;
+    positions[i] = view.position;
+  }
+  positions[count] = am->length;
+  return count;
+}
+
+/******************************************************
+ * Function: run_chunks
+ * Description: Runs the same work on every chunk, each on a thread of its own.
+ *		The calling thread takes the first chunk, and any chunk a thread
+ *		cannot be started for once it is done.
+ *
+ * @param chunks: The chunks.
+ * @param count: Number of chunks.
+ * @param work: The work, called with a pointer to the chunk.
+ ******************************************************/
+void run_chunks(splitChunk* chunks, int count, void* (*work)(void*)) {
+  pthread_t threads[MAX_SPLIT];
+  int isStarted[MAX_SPLIT];
+  int i;
+
+  for(i = 1; i < count; i++) isStarted[i] = pthread_create(&threads[i], NULL, work, &chunks[i]) == 0 ? YES : NO;
+  work(&chunks[0]);
+  for(i = 1; i < count; i++) {
+    if(isStarted[i] == YES) pthread_join(threads[i], NULL);
+    else work(&chunks[i]);
+  }
+}
+
+/******************************************************
+ * Function: first_chunk
+ * Description: Performs the first pass over the lines of a chunk.
+ *
+ * @param arg: Pointer to the chunk.
+ * @return: NULL.
+ ******************************************************/
+void* first_chunk(void* arg) {
+  splitChunk* chunk = (splitChunk*) arg;
+
+  chunk->isError = translate_lines(&chunk->lines, &chunk->symbols, &chunk->dataImg, &chunk->codeImg, chunk->fileName, &chunk->ctx);
+  return NULL;
+}
+
+/******************************************************
+ * Function: second_chunk
+ * Description: Patches the operands of a chunk and writes the .ob lines of its words.
+ *
+ * @param arg: Pointer to the chunk.
+ * @return: NULL.
+ ******************************************************/
+void* second_chunk(void* arg) {
+  splitChunk* chunk = (splitChunk*) arg;
+
+  chunk->isError = patch_operands(chunk->fileCode, chunk->firstFixup, chunk->lastFixup, &chunk->symbols, &chunk->extEnt, chunk->fileName, &chunk->ctx);
+  if(chunk->isError == NO && chunk->words != NULL) {
+    write_object_words(chunk->words, chunk->fileCode->words.words + chunk->codeBase, chunk->codeBase, chunk->ctx.IC);
+    write_object_words(chunk->words, chunk->fileData->words + chunk->dataBase, chunk->fileCode->words.count + chunk->dataBase, chunk->ctx.DC);
+  }
+  return NULL;
+}
+
+/******************************************************
+ * Function: join_chunks
+ * Description: Joins the images of the chunks in line order and replays their definitions
+ *		on the symbol table of the file, as the first pass over the whole file would.
+ *
+ * @param chunks: The chunks, after their first pass.
+ * @param count: Number of chunks.
+ * @param symbols: Pointer to the symbol table of the file.
+ * @param dataImg: Pointer to the data image of the file.
+ * @param codeImg: Pointer to the code image of the file.
+ * @param ctx: Context of the file, its IC, DC and line counter are set.
+ * @return: YES if the file has to be assembled on a single thread, NO otherwise.
+ ******************************************************/
+int join_chunks(splitChunk* chunks, int count, symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, assemblerContext* ctx) {
+  int IC = 0;
+  int DC = 0;
+  int i, j;
+
+  for(i = 0; i < count; i++) {
+    if(chunks[i].isError == YES || chunks[i].ctx.reportLength > 0) return YES;
+    chunks[i].codeBase = IC;
+    chunks[i].dataBase = DC;
+    IC += chunks[i].ctx.IC;
+    DC += chunks[i].ctx.DC;
+  }
+  if(IC+DC > MAX_PROGRAM) return YES;
+
+  for(i = 0; i < count; i++) {
+    splitChunk* chunk = &chunks[i];
+    append_words(&codeImg->words, chunk->codeImg.words.words, chunk->codeImg.words.count);
+    for(j = 0; j < chunk->codeImg.count; j++)
+      add_code_line(codeImg, chunk->codeImg.lines[j].lineNum + chunk->codeBase, chunk->codeImg.lines[j].opcode, chunk->codeImg.lines[j].L);
+    chunk->firstFixup = codeImg->fixups.count;
+    append_fixups(&codeImg->fixups, &chunk->codeImg.fixups, chunk->codeBase);
+    chunk->lastFixup = codeImg->fixups.count;
+    append_words(dataImg, chunk->dataImg.words, chunk->dataImg.count);
+    if(replay_events(&chunk->events, symbols, dataImg, chunk->codeBase, chunk->dataBase) == YES) return YES;
+  }
+  ctx->IC = IC;
+  ctx->DC = DC;
+  ctx->lineCounterAm = chunks[count-1].ctx.lineCounterAm;
+  place_data_labels(symbols, IC);
+  return NO;
+}
+
+/******************************************************
+ * Function: patch_chunks
+ * Description: Performs the second pass over the joined chunks, then exports the file.
+ *
+ * @param chunks: The joined chunks.
+ * @param count: Number of chunks.
+ * @param symbols: Pointer to the symbol table of the file.
+ * @param dataImg: Pointer to the data image of the file.
+ * @param codeImg: Pointer to the code image of the file.
+ * @param ctx: Context of the file.
+ * @return: YES if the file has to be assembled on a single thread, NO otherwise.
+ ******************************************************/
+int patch_chunks(splitChunk* chunks, int count, symbolTable* symbols, wordImage* dataImg, codeImage* codeImg, assemblerContext* ctx) {
+  extEntList operands[MAX_SPLIT];
+  extEntList extEnt;
+  char* words = NULL;
+  int i;
+
+  /* The .ob lines are written by the chunks, at their place in the file */
+  if(ctx->result == NULL && ctx->options->format == FORMAT_TEXT) words = object_words(ctx, ctx->IC + ctx->DC);
+  for(i = 0; i < count; i++) {
+    splitChunk* chunk = &chunks[i];
+    unsigned long lookups = chunk->symbols.lookups;
+    chunk->symbols = *symbols; /* A copy, so every thread counts its own lookups */
+    chunk->symbols.lookups = lookups;
+    chunk->fileCode = codeImg;
+    chunk->fileData = dataImg;
+    chunk->words = words;
+  }
+  run_chunks(chunks, count, second_chunk);
+
+  for(i = 0; i < count; i++) {
+    if(chunks[i].isError == YES || chunks[i].ctx.reportLength > 0) return YES;
+    operands[i] = chunks[i].extEnt;
+  }
+  extEnt.items = NULL;
+  extEnt.count = 0;
+  extEnt.capacity = 0;
+  extEnt.memory = &ctx->memory;
+  if(collect_ext_ent(&codeImg->fixups, operands, count, symbols, &extEnt, chunks[0].fileName, ctx) == YES) return YES;
+  export_image(dataImg, codeImg, &extEnt, words != NULL ? YES : NO, ctx);
+  return NO;
+}
@@ -0,0 +1,13 @@
+/******************************************************
+ * Function: split_file
+ * Description: Performs both passes over the expanded source on --split threads.
+ *		The file is left as it was for firsttrans when it is too short
+ *		to be split, or when a single thread has to assemble it. The optimizer
+ *		works on the code image of the whole file, so with -O it is never split.
+ *
+ * @param am: Text buffer holding the expanded source.
+ * @param fileName: Name of the assembly file.
+ * @param ctx: Context of the file.
+ * @return: YES if the file was assembled, NO otherwise.
+ ******************************************************/
+int split_file(textBuffer* am, char* fileName, assemblerContext* ctx);
@@ -0,0 +1,166 @@
+/******************************************************
+ * File: stats.c
+ * Description: This file times the phases of the
+ *              assembly of a file. The passes mark where
+ *              each phase starts with SWITCH_PHASE, the
+ *              time since the previous mark is charged
+ *              to the phase that was running, so nested
+ *              calls (the first pass calls the second)
+ *              are still timed apart. The passes also
+ *              count the lines they read and the lookups
+ *              in their tables and the optimizers count
+ *              the words they save, --stats prints all of
+ *              it after the report of every file, as a
+ *              table or as a line of JSON (--stats=json).
+ ******************************************************/
+
+#include "universal.h"
+#include <time.h>
+
+double now_seconds(void);
+void clear_savings(assemblerStats* stats);
+void print_json_string(FILE* file, char* text);
+
+/* Names of the phases, in the order of the PHASE_ numbers */
+const char* phaseNames[PHASES] = {"macro", "first", "second", "export"};
+
+/******************************************************
+ * Function: init_stats
+ * Description: Clears the times and the counters of all the phases.
+ *
+ * @param stats: Pointer to the statistics.
+ ******************************************************/
+void init_stats(assemblerStats* stats) {
+  int i;
+
+  for(i = 0; i < PHASES; i++) {
+    stats->seconds[i] = 0;
+    stats->lines[i] = 0;
+  }
+  stats->phase = NO_PHASE;
+  stats->since = 0;
+  stats->symbols = 0;
+  stats->macros = 0;
+  stats->labelLookups = 0;
+  stats->macroLookups = 0;
+  stats->opcodeLookups = 0;
+  stats->bytesAllocated = 0;
+  stats->bytesWritten = 0;
+  clear_savings(stats);
+}
+
+/******************************************************
+ * Function: clear_savings
+ * Description: Clears what the optimizers saved, for a file that does not assemble.
+ *
+ * @param stats: Pointer to the statistics.
+ ******************************************************/
+void clear_savings(assemblerStats* stats) {
+  stats->jmpNextSaved = 0;
+  stats->movSelfSaved = 0;
+  stats->clrMovSaved = 0;
+  stats->bneRetargeted = 0;
+  stats->outlineSaved = 0;
+  stats->subroutines = 0;
+  stats->outlinedCopies = 0;
+  stats->dataSaved = 0;
+  stats->identicalRuns = 0;
+  stats->suffixRuns = 0;
+}
+
+/******************************************************
+ * Function: switch_phase
+ * Description: Charges the time since the last switch to the current phase
+ *		and starts the next one.
+ *
+ * @param stats: Pointer to the statistics.
+ * @param next: The phase that starts, NO_PHASE when the file is done.
+ ******************************************************/
+void switch_phase(assemblerStats* stats, int next) {
+  double now = now_seconds();
+
+  if(stats->phase != NO_PHASE) stats->seconds[stats->phase] += now - stats->since;
+  stats->phase = next;
+  stats->since = now;
+}
+
+/******************************************************
+ * Function: now_seconds
+ * Description: Reads the monotonic clock.
+ *
+ * @return: Seconds since an arbitrary point.
+ ******************************************************/
+double now_seconds(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec/1e9;
+}
+
+/******************************************************
+ * Function: phase_name
+ * Description: Names a phase in the statistics.
+ *
+ * @param phase: The phase.
+ * @return: The name of the phase.
+ ******************************************************/
+const char* phase_name(int phase) {
+  return phaseNames[phase];
+}
+
+/******************************************************
+ * Function: print_stats
+ * Description: Prints the statistics of a file to the standard error,
+ *		as a table or as one line of JSON.
+ *
+ * @param ctx: Context of the file, with its statistics.
+ ******************************************************/
+void print_stats(assemblerContext* ctx) {
+  assemblerStats* stats = ctx->stats;
+  int i;
+
+  fflush(stdout); /* The report of the file comes first */
+  if(ctx->options->stats == STATS_JSON) {
+    fprintf(stderr, "{\"file\":");
+    print_json_string(stderr, ctx->fileName);
+    fprintf(stderr, ",\"phases\":{");
+    for(i = 0; i < PHASES; i++)
+      fprintf(stderr, "%s\"%s\":{\"seconds\":%.6f,\"lines\":%ld}", i > 0 ? "," : "", phaseNames[i], stats->seconds[i], stats->lines[i]);
+    fprintf(stderr, "},\"symbols\":%ld,\"macros\":%ld,\"lookups\":{\"is_label\":%ld,\"is_line_macro\":%ld,\"opcode\":%ld},\"bytes_allocated\":%ld,\"bytes_written\":%ld",
+            stats->symbols, stats->macros, stats->labelLookups, stats->macroLookups, stats->opcodeLookups, stats->bytesAllocated, stats->bytesWritten);
+    fprintf(stderr, ",\"saved\":{\"peephole\":{\"jmp_next\":%ld,\"mov_self\":%ld,\"clr_mov\":%ld,\"bne_retargeted\":%ld},"
+            "\"outline\":{\"words\":%ld,\"subroutines\":%ld,\"copies\":%ld},\"data\":{\"words\":%ld,\"identical\":%ld,\"suffixes\":%ld}}}\n",
+            stats->jmpNextSaved, stats->movSelfSaved, stats->clrMovSaved, stats->bneRetargeted,
+            stats->outlineSaved, stats->subroutines, stats->outlinedCopies, stats->dataSaved, stats->identicalRuns, stats->suffixRuns);
+    return;
+  }
+  fprintf(stderr, "\nStatistics of \"%s\":\n  %-8s %10s %8s\n", ctx->fileName, "phase", "seconds", "lines");
+  for(i = 0; i < PHASES; i++) fprintf(stderr, "  %-8s %10.6f %8ld\n", phaseNames[i], stats->seconds[i], stats->lines[i]);
+  fprintf(stderr, "  symbols %ld, macros %ld\n", stats->symbols, stats->macros);
+  fprintf(stderr, "  lookups: is_label %ld, is_line_macro %ld, opcode %ld\n", stats->labelLookups, stats->macroLookups, stats->opcodeLookups);
+  fprintf(stderr, "  bytes allocated %ld, written %ld\n", stats->bytesAllocated, stats->bytesWritten);
+  if(ctx->options->optimize & OPTIMIZE_PEEPHOLE)
+    fprintf(stderr, "  peephole optimizer saved %ld words: jmp to the next instruction %ld, mov of a register to itself %ld, clr before mov #0 %ld, bne to a jmp retargeted %ld\n",
+            stats->jmpNextSaved + stats->movSelfSaved + stats->clrMovSaved, stats->jmpNextSaved, stats->movSelfSaved, stats->clrMovSaved, stats->bneRetargeted);
+  if(ctx->options->optimize & OPTIMIZE_OUTLINE)
+    fprintf(stderr, "  outliner saved %ld words: subroutines %ld, copies replaced by jsr %ld\n", stats->outlineSaved, stats->subroutines, stats->outlinedCopies);
+  if(ctx->options->optimize & OPTIMIZE_DATA)
+    fprintf(stderr, "  data optimizer saved %ld words: identical runs %ld, suffixes of longer runs %ld\n", stats->dataSaved, stats->identicalRuns, stats->suffixRuns);
+}
+
+/******************************************************
+ * Function: print_json_string
+ * Description: Prints a text as a JSON string, with its quotes.
+ *
+ * @param file: The file to print to.
+ * @param text: The text, null terminated.
+ ******************************************************/
+void print_json_string(FILE* file, char* text) {
+  fputc('"', file);
+  for(; *text != '\0'; text++) {
+    if(*text == '"' || *text == '\\') fprintf(file, "\\%c", *text);
+    else if((unsigned char) *text < 0x20) fprintf(file, "\\u%04x", (unsigned char) *text);
+    else fputc(*text, file);
+  }
+  fputc('"', file);
+}
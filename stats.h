@@ -0,0 +1,46 @@
+/******************************************************
+ * Function: init_stats
+ * Description: Clears the times and the counters of all the phases.
+ *
+ * @param stats: Pointer to the statistics.
+ ******************************************************/
+void init_stats(assemblerStats* stats);
+/******************************************************
+ * Function: clear_savings
+ * Description: Clears what the optimizers saved, for a file that does not assemble.
+ *
+ * @param stats: Pointer to the statistics.
+ ******************************************************/
+void clear_savings(assemblerStats* stats);
+/******************************************************
+ * Function: switch_phase
+ * Description: Charges the time since the last switch to the current phase
+ *		and starts the next one.
+ *
+ * @param stats: Pointer to the statistics.
+ * @param next: The phase that starts, NO_PHASE when the file is done.
+ ******************************************************/
+void switch_phase(assemblerStats* stats, int next);
+/******************************************************
+ * Function: now_seconds
+ * Description: Reads the monotonic clock.
+ *
+ * @return: Seconds since an arbitrary point.
+ ******************************************************/
+double now_seconds(void);
+/******************************************************
+ * Function: phase_name
+ * Description: Names a phase in the statistics.
+ *
+ * @param phase: The phase.
+ * @return: The name of the phase.
+ ******************************************************/
+const char* phase_name(int phase);
+/******************************************************
+ * Function: print_stats
+ * Description: Prints the statistics of a file to the standard error,
+ *		as a table or as one line of JSON.
+ *
+ * @param ctx: Context of the file, with its statistics.
+ ******************************************************/
+void print_stats(assemblerContext* ctx);
@@ -0,0 +1,150 @@
+/******************************************************
+ * File: symbolTable.c
+ * Description: This file implements the symbol table as
+ *              an open-addressing hash table. Labels are
+ *              also chained in definition order so both
+ *              passes can walk them sequentially.
+ ******************************************************/
+
+#include "universal.h"
+#include "arena.h"
+
+#define INITIAL_SLOTS 64 /*Initial number of slots (must be a power of two)*/
+
+unsigned long hash_text(char* text, int length);
+void grow_symbol_table(symbolTable* table);
+
+/******************************************************
+ * Function: init_symbol_table
+ * Description: Initializes an empty symbol table.
+ * 
+ * @param table: Pointer to the symbol table to initialize.
+ * @param memory: Arena that owns the table.
+ ******************************************************/
+void init_symbol_table(symbolTable* table, arena* memory) {
+  table->memory = memory;
+  table->slots = (ptrLabel*) arena_alloc(memory, INITIAL_SLOTS*sizeof(ptrLabel));
+  memset(table->slots, 0, INITIAL_SLOTS*sizeof(ptrLabel));
+  table->capacity = INITIAL_SLOTS;
+  table->count = 0;
+  table->head = NULL;
+  table->tail = NULL;
+  table->lookups = 0;
+  table->events = NULL;
+}
+
+/******************************************************
+ * Function: hash_name
+ * Description: Computes the FNV-1a hash of a label or macro name.
+ * 
+ * @param name: The name to hash.
+ * @return The hash value (32 bits).
+ ******************************************************/
+unsigned long hash_name(char* name) {
+  return hash_text(name, strlen(name));
+}
+
+/******************************************************
+ * Function: hash_text
+ * Description: Computes the FNV-1a hash of a name that is not null terminated.
+ * 
+ * @param text: The name to hash.
+ * @param length: Length of the name.
+ * @return The hash value (32 bits).
+ ******************************************************/
+unsigned long hash_text(char* text, int length) {
+  unsigned long hash = 2166136261UL;
+  while(length-- > 0) {
+    hash ^= (unsigned char) *text++;
+    hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+  }
+  return hash;
+}
+
+/******************************************************
+ * Function: is_label
+ * Description: Checks if a string represents a label.
+ * 
+ * @param line: The input string to check.
+ * @param table: Pointer to the symbol table.
+ * @return Pointer to the label node if found, NULL otherwise.
+ ******************************************************/
+ptrLabel is_label(char* line, symbolTable* table) {
+  unsigned long hash = hash_name(line);
+  unsigned long i = hash & (table->capacity-1);
+  
+  COUNT_LOOKUP(table->lookups);
+  /* Probe until the label or an empty slot is found */
+  while(table->slots[i] != NULL) {
+    if(table->slots[i]->hash == hash && strcmp(line, table->slots[i]->labelName) == 0) return table->slots[i];
+    i = (i+1) & (table->capacity-1);
+  }
+  return NULL;
+}
+
+/******************************************************
+ * Function: add_symbol
+ * Description: Appends a label to the symbol table.
+ * 
+ * @param table: Pointer to the symbol table.
+ * @param labelName: Name of the label to be added.
+ * @param labelType: Type of the label (DEFINE, DATA, CODE, EXTERNAL).
+ * @param data: Value associated with the label.
+ * @return Pointer to the newly added label node.
+ ******************************************************/
+ptrLabel add_symbol(symbolTable* table, char* labelName, int labelType, int data) {
+  ptrLabel t = (ptrLabel) arena_alloc(table->memory, sizeof(itemLabel)); /*Create a new item in the table*/
+  unsigned long i;
+  
+  t->labelName = arena_strdup(table->memory, labelName); /*The name is interned once, lookups compare the cached hash first*/
+  t->hash = hash_name(labelName);
+  t->labelType = labelType;
+  t->data = data;
+  t->next = NULL;
+  
+  /* Keep the definition order for sequential walks */
+  if(table->tail == NULL) table->head = t;
+  else table->tail->next = t;
+  table->tail = t;
+  
+  /* Keep the load factor under 1/2 */
+  if(2*(table->count+1) > table->capacity) grow_symbol_table(table);
+  
+  /* A repeated name stays reachable only through its first definition */
+  i = t->hash & (table->capacity-1);
+  while(table->slots[i] != NULL) {
+    if(table->slots[i]->hash == t->hash && strcmp(labelName, table->slots[i]->labelName) == 0) return t;
+    i = (i+1) & (table->capacity-1);
+  }
+  table->slots[i] = t;
+  table->count++;
+  return t;
+}
+
+/******************************************************
+ * Function: grow_symbol_table
+ * Description: Doubles the number of slots and re-inserts
+ *		the indexed labels.
+ * 
+ * @param table: Pointer to the symbol table.
+ ******************************************************/
+void grow_symbol_table(symbolTable* table) {
+  unsigned long capacity = table->capacity*2;
+  ptrLabel* slots = (ptrLabel*) arena_alloc(table->memory, capacity*sizeof(ptrLabel)); /*The old slots are left to the arena*/
+  ptrLabel p;
+  unsigned long i;
+  
+  memset(slots, 0, capacity*sizeof(ptrLabel));
+  
+  /* Slots only hold the first definition of each name, so they can be moved in any order */
+  for(i = 0; i < table->capacity; i++) {
+    unsigned long j;
+    if((p = table->slots[i]) == NULL) continue;
+    j = p->hash & (capacity-1);
+    while(slots[j] != NULL) j = (j+1) & (capacity-1);
+    slots[j] = p;
+  }
+  
+  table->slots = slots;
+  table->capacity = capacity;
+}
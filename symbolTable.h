@@ -0,0 +1,45 @@
+/******************************************************
+ * Function: init_symbol_table
+ * Description: Initializes an empty symbol table.
+ * 
+ * @param table: Pointer to the symbol table to initialize.
+ * @param memory: Arena that owns the table.
+ ******************************************************/
+void init_symbol_table(symbolTable* table, arena* memory);
+/******************************************************
+ * Function: hash_name
+ * Description: Computes the FNV-1a hash of a label or macro name.
+ * 
+ * @param name: The name to hash.
+ * @return The hash value (32 bits).
+ ******************************************************/
+unsigned long hash_name(char* name);
+/******************************************************
+ * Function: hash_text
+ * Description: Computes the FNV-1a hash of a name that is not null terminated.
+ * 
+ * @param text: The name to hash.
+ * @param length: Length of the name.
+ * @return The hash value (32 bits).
+ ******************************************************/
+unsigned long hash_text(char* text, int length);
+/******************************************************
+ * Function: is_label
+ * Description: Checks if a string represents a label.
+ * 
+ * @param line: The input string to check.
+ * @param table: Pointer to the symbol table.
+ * @return Pointer to the label node if found, NULL otherwise.
+ ******************************************************/
+ptrLabel is_label(char* line, symbolTable* table);
+/******************************************************
+ * Function: add_symbol
+ * Description: Appends a label to the symbol table.
+ * 
+ * @param table: Pointer to the symbol table.
+ * @param labelName: Name of the label to be added.
+ * @param labelType: Type of the label (DEFINE, DATA, CODE, EXTERNAL).
+ * @param data: Value associated with the label.
+ * @return Pointer to the newly added label node.
+ ******************************************************/
+ptrLabel add_symbol(symbolTable* table, char* labelName, int labelType, int data);
@@ -0,0 +1,141 @@
+/******************************************************
+ * File: textBuffer.c
+ * Description: This file provides an in-memory text
+ *              buffer. The source file is read into one
+ *              in a single pass, the pre-processor appends
+ *              the expanded source to another and the first
+ *              pass reads it back line by line, so the .am
+ *              file only has to be written when asked for.
+ ******************************************************/
+
+#include "universal.h"
+#include "arena.h"
+
+#define INITIAL_TEXT 4096 /*Initial capacity of a text buffer*/
+
+char* reserve_text(textBuffer* buffer, size_t length);
+
+/******************************************************
+ * Function: init_text_buffer
+ * Description: Initializes an empty text buffer.
+ *
+ * @param buffer: Pointer to the text buffer to initialize.
+ * @param memory: Arena that owns the text.
+ ******************************************************/
+void init_text_buffer(textBuffer* buffer, arena* memory) {
+  buffer->memory = memory;
+  buffer->text = NULL;
+  buffer->length = 0;
+  buffer->capacity = 0;
+  buffer->position = 0;
+}
+
+/******************************************************
+ * Function: append_text
+ * Description: Appends a span of text to the text buffer.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param text: The text to append, it does not have to be null terminated.
+ * @param length: Length of the text.
+ ******************************************************/
+void append_text(textBuffer* buffer, char* text, size_t length) {
+  memcpy(reserve_text(buffer, length), text, length);
+  buffer->length += length;
+}
+
+/******************************************************
+ * Function: reserve_text
+ * Description: Makes room for text to be written right after the end of the text buffer.
+ *		The length of the buffer is not changed.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param length: Room needed.
+ * @return: The end of the text, where the text can be written.
+ ******************************************************/
+char* reserve_text(textBuffer* buffer, size_t length) {
+  /* Double the capacity when the text does not fit */
+  if(buffer->length + length > buffer->capacity) {
+    size_t capacity = buffer->capacity == 0 ? INITIAL_TEXT : buffer->capacity*2;
+    while(buffer->length + length > capacity) capacity *= 2;
+    buffer->text = (char*) arena_grow(buffer->memory, buffer->text, buffer->capacity, capacity);
+    buffer->capacity = capacity;
+  }
+  return buffer->text + buffer->length;
+}
+
+/******************************************************
+ * Function: append_line
+ * Description: Appends a line and a newline character to the text buffer.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param line: The line to append (without its newline), it does not have to be null terminated.
+ * @param length: Length of the line.
+ ******************************************************/
+void append_line(textBuffer* buffer, char* line, int length) {
+  append_text(buffer, line, length);
+  append_text(buffer, "\n", 1);
+}
+
+/******************************************************
+ * Function: read_text
+ * Description: Appends the whole content of a file to the text buffer in a few large reads.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param file: The file to read.
+ ******************************************************/
+void read_text(textBuffer* buffer, FILE* file) {
+  size_t length;
+
+  do {
+    /* Always leave room for a large read */
+    if(buffer->capacity - buffer->length < INITIAL_TEXT) {
+      size_t capacity = buffer->capacity == 0 ? INITIAL_TEXT*4 : buffer->capacity*2;
+      buffer->text = (char*) arena_grow(buffer->memory, buffer->text, buffer->capacity, capacity);
+      buffer->capacity = capacity;
+    }
+    length = fread(buffer->text + buffer->length, 1, buffer->capacity - buffer->length, file);
+    buffer->length += length;
+  } while(length > 0);
+}
+
+/******************************************************
+ * Function: next_line
+ * Description: Finds the next line of the text buffer the way fgets reads a file:
+ *		at most size-1 characters, stopping after a newline.
+ *		The line is not copied and not null terminated.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param size: Size fgets would have been given.
+ * @param length: Where the length of the line is stored.
+ * @return: The start of the line, or NULL when the whole text was read.
+ ******************************************************/
+char* next_line(textBuffer* buffer, int size, int* length) {
+  size_t left = buffer->length - buffer->position;
+  char* line;
+  char* newline;
+
+  if(left == 0) return NULL;
+  line = buffer->text + buffer->position;
+  if(left > (size_t) size-1) left = size-1;
+  if((newline = (char*) memchr(line, '\n', left)) != NULL) left = newline - line + 1;
+  buffer->position += left;
+  *length = left;
+  return line;
+}
+
+/******************************************************
+ * Function: write_text
+ * Description: Writes the whole text buffer to a file.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param fileName: Name of the file to write.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int write_text(textBuffer* buffer, char* fileName) {
+  FILE* file = fopen(fileName, "w");
+
+  if(file == NULL) return YES;
+  if(buffer->length > 0) fwrite(buffer->text, 1, buffer->length, file);
+  fclose(file);
+  return NO;
+}
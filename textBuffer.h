@@ -0,0 +1,65 @@
+/******************************************************
+ * Function: init_text_buffer
+ * Description: Initializes an empty text buffer.
+ *
+ * @param buffer: Pointer to the text buffer to initialize.
+ * @param memory: Arena that owns the text.
+ ******************************************************/
+void init_text_buffer(textBuffer* buffer, arena* memory);
+/******************************************************
+ * Function: append_text
+ * Description: Appends a span of text to the text buffer.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param text: The text to append, it does not have to be null terminated.
+ * @param length: Length of the text.
+ ******************************************************/
+void append_text(textBuffer* buffer, char* text, size_t length);
+/******************************************************
+ * Function: reserve_text
+ * Description: Makes room for text to be written right after the end of the text buffer.
+ *		The length of the buffer is not changed.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param length: Room needed.
+ * @return: The end of the text, where the text can be written.
+ ******************************************************/
+char* reserve_text(textBuffer* buffer, size_t length);
+/******************************************************
+ * Function: append_line
+ * Description: Appends a line and a newline character to the text buffer.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param line: The line to append (without its newline), it does not have to be null terminated.
+ * @param length: Length of the line.
+ ******************************************************/
+void append_line(textBuffer* buffer, char* line, int length);
+/******************************************************
+ * Function: read_text
+ * Description: Appends the whole content of a file to the text buffer in a few large reads.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param file: The file to read.
+ ******************************************************/
+void read_text(textBuffer* buffer, FILE* file);
+/******************************************************
+ * Function: next_line
+ * Description: Finds the next line of the text buffer the way fgets reads a file:
+ *		at most size-1 characters, stopping after a newline.
+ *		The line is not copied and not null terminated.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param size: Size fgets would have been given.
+ * @param length: Where the length of the line is stored.
+ * @return: The start of the line, or NULL when the whole text was read.
+ ******************************************************/
+char* next_line(textBuffer* buffer, int size, int* length);
+/******************************************************
+ * Function: write_text
+ * Description: Writes the whole text buffer to a file.
+ *
+ * @param buffer: Pointer to the text buffer.
+ * @param fileName: Name of the file to write.
+ * @return: int indicating whether an error occurred (YES) or not (NO).
+ ******************************************************/
+int write_text(textBuffer* buffer, char* fileName);
@@ -1,13 +1,21 @@
+#define _POSIX_C_SOURCE 200112L /*strtok_r, vsnprintf and threads*/
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <setjmp.h>
 
+#define ASSEMBLER_VERSION "1.5" /*Part of the key of cached files, changed whenever the output of the assembler changes*/
 #define BUFFER 82 /*Maximum line length (plus one \n charcter and null terminator)*/
 #define MAX_WORD 15 /*Maximum word length (plus one null terminator character*/
 #define MAX_LABEL 32 /*Maximum label length (plus one null terminator character*/
 #define MAX_PROGRAM 4096 /*Maximum program length*/
 #define OPCODE 16 /*Number of opcodes*/
+#define WORD_BITS 14 /*Number of bits in a machine word*/
+#define WORD_MASK 0x3FFF /*Mask of the bits of a machine word*/
+#define ENCRYPTED_WORD 7 /*Number of base 4 characters in a machine word*/
 
 #define NO 0
 #define YES 1
@@ -15,6 +23,8 @@
 #define A 00 /*Absolute*/
 #define R 10 /*Relocatable*/
 #define E 01 /*External*/
+#define ARE_RELOCATABLE 2 /*The low bits of a word that holds the address of a label*/
+#define ARE_EXTERNAL 1 /*The low bits of a word that refers to an external label*/
 
 #define DEFINE 0
 #define CODE 1
@@ -26,36 +36,334 @@
 #define DIRECT 1
 #define INDEX 2
 #define DIRECT_REGISTER 3
+#define MODES 4 /*Number of addressing modes*/
+#define MODE_BIT(mode) (1 << (mode)) /*The bit of an addressing mode in the masks of opcodeInfo*/
 
-typedef struct nodeDataImg* ptrDataImg;
-typedef struct nodeDataImg {
-  int lineNum;
-  int L;
-  char* output;
-  ptrDataImg next;
-} itemDataImg;
+#define RESERVED_WORDS 31 /*Opcodes, macro keywords, directives and registers*/
+#define WORD_MCR 16 /*Reserved words after the opcodes, in the order of reservedWords*/
+#define WORD_ENDMCR 17
+#define WORD_DATA 18
+#define WORD_STRING 19
+#define WORD_ENTRY 20
+#define WORD_EXTERN 21
+#define WORD_DEFINE 22
+#define WORD_REGISTER 23 /*r0, r1 to r7 follow*/
+
+#define LEX_REST 0 /*No delimiters, the token is the rest of the line*/
+#define LEX_SPACE 1 /*Space and tab*/
+#define LEX_COMMA 2
+#define LEX_EQUALS 4
+#define LEX_NEWLINE 8
+#define LEX_OPEN 16 /*[*/
+#define LEX_CLOSE 32 /*]*/
+
+#define TOKEN_WORD 0 /*A mnemonic, a number or a label used as an operand*/
+#define TOKEN_LABEL 1 /*A label definition, ends with ':'*/
+#define TOKEN_DIRECTIVE 2 /*Starts with '.'*/
+#define TOKEN_IMMEDIATE 3 /*Starts with '#'*/
+#define TOKEN_INDEX 4 /*name[index]*/
+#define TOKEN_REGISTER 5 /*r0 to r7*/
+
+#define DEFAULT_CACHE_BUDGET (64L*1024*1024) /*Bytes the cache directory may take without --cache-size*/
+
+#define OUTPUTS 4 /*Output files of an assembled file*/
+#define OUTPUT_OB 0
+#define OUTPUT_ENT 1
+#define OUTPUT_EXT 2
+#define OUTPUT_BIN 3
+
+#define FORMAT_TEXT 0 /*.ob, .ent and .ext files*/
+#define FORMAT_BIN 1 /*A single binary .bin file (--format=bin)*/
+
+/* Layout of a .bin file, all numbers are little-endian and every section starts 4-aligned:
+   header, code words, data words, symbols, relocations, null terminated names */
+#define BIN_MAGIC "A14B"
+#define BIN_VERSION 1
+#define BIN_HEADER 44 /*Magic, version, header size, IC, DC, code and data offsets, then offset and count (size for the names) of the other sections*/
+#define BIN_SYMBOL 8 /*Symbol or relocation: name offset (4 bytes), address (2), ARE bits of its uses (2)*/
+
+#define PHASES 4 /*Phases of the assembly that are timed*/
+#define PHASE_MACRO 0 /*Pre-processor*/
+#define PHASE_FIRST 1
+#define PHASE_SECOND 2
+#define PHASE_EXPORT 3
+#define NO_PHASE -1 /*Between files, the time is not charged to any phase*/
+
+#define STATS_OFF 0 /*Values of --stats*/
+#define STATS_TEXT 1
+#define STATS_JSON 2
+
+#define OPTIMIZE_PEEPHOLE 1 /*Bits of the optimize option, -O*/
+#define OPTIMIZE_OUTLINE 2 /*-Os, with the peephole optimizer*/
+#define OPTIMIZE_DATA 4 /*--merge-data, also with -Os*/
+
+/* Charges the time since the last switch to the current phase, adds to a counter of the file
+   and counts a lookup in a table, all built without them with -DNO_STATS */
+#ifdef NO_STATS
+#define SWITCH_PHASE(ctx, next) ((void) 0)
+#define ADD_STAT(ctx, field, n) ((void) 0)
+#define COUNT_LOOKUP(counter) ((void) 0)
+#else
+#define SWITCH_PHASE(ctx, next) ((ctx)->stats != NULL ? switch_phase((ctx)->stats, next) : (void) 0)
+#define ADD_STAT(ctx, field, n) ((ctx)->stats != NULL ? (void) ((ctx)->stats->field += (n)) : (void) 0)
+#define COUNT_LOOKUP(counter) ((void) (counter)++)
+#endif
+
+#define MAX_SPLIT 64 /*Most chunks of --split*/
+#define SPLIT_LINES 256 /*Fewest lines of a chunk of --split, shorter files are assembled by a single thread*/
+#define EVENT_DEFINE 0 /*A definition of a chunk replayed with define_label*/
+#define EVENT_NEW 1 /*A code label or .define, only defined if the name is new*/
+#define EVENT_CONSTANT 2 /*A .data argument that names a .define of an earlier chunk*/
+
+#define FIRST_ADDRESS 100 /*Address the program is loaded at*/
+#define REGISTERS 8
+#define SIM_MEMORY (FIRST_ADDRESS+MAX_PROGRAM) /*Words of memory of the simulator*/
+#define SIM_STACK 1024 /*Depth of the return address stack of the simulator*/
+#define SIM_HALT -1 /*Next address of an instruction that stops the simulator*/
+#define SIM_ERROR -2 /*Next address of an instruction that failed*/
+
+typedef unsigned short machineWord; /*A packed 14-bit machine word*/
+
+typedef struct opcodeInfo {
+  int operands; /*0, 1 (destination only) or 2*/
+  int sourceModes; /*MODE_BIT of every legal source mode*/
+  int destinationModes; /*MODE_BIT of every legal destination mode*/
+  unsigned char length[MODES][MODES]; /*Words of the instruction by source and destination mode, 0 if illegal*/
+  machineWord firstWord[MODES][MODES]; /*Its first word, with the A bits*/
+} opcodeInfo;
+
+typedef struct arenaBlock* ptrArenaBlock;
+typedef struct arenaBlock {
+  ptrArenaBlock next;
+  size_t size; /*Usable bytes after the header*/
+  size_t used;
+} arenaBlock;
+
+typedef struct arena {
+  ptrArenaBlock head; /*Block small allocations are served from*/
+  void* last; /*Most recent allocation, the only one that can grow in place*/
+  size_t reserved; /*Bytes requested from the system*/
+  jmp_buf* onFailure; /*Where an allocation that fails jumps to, NULL to end the program*/
+} arena;
+
+typedef struct assemblerOptions {
+  int jobs; /*Number of worker threads*/
+  int emitAm; /*Write the expanded source to the .am file*/
+  int format; /*FORMAT_TEXT or FORMAT_BIN*/
+  char* cacheDir; /*Directory of the cache of assembled files, NULL without --cache*/
+  long cacheBudget; /*Bytes the cache directory may take*/
+  int stats; /*STATS_OFF, STATS_TEXT or STATS_JSON*/
+  int split; /*Threads the passes over a single file are split across (--split=N), 1 for none*/
+  int optimize; /*OPTIMIZE_ bits of the passes run between the first and the second pass, 0 for none*/
+} assemblerOptions;
+
+typedef struct textBuffer {
+  char* text; /*Not null terminated*/
+  size_t length;
+  size_t capacity;
+  size_t position; /*Where the next line is read from*/
+  arena* memory;
+} textBuffer;
+
+typedef struct assemblerStats {
+  double seconds[PHASES]; /*Wall time of every phase*/
+  int phase; /*Phase the time is charged to*/
+  double since; /*When the phase started*/
+  long lines[PHASES]; /*Lines read by the pre-processor and the first pass, operands patched by the second pass, lines exported*/
+  long symbols; /*Size of the symbol table*/
+  long macros; /*Size of the macro table*/
+  long labelLookups; /*Calls of is_label*/
+  long macroLookups; /*Calls of is_line_macro*/
+  long opcodeLookups; /*Reserved words looked up by the first pass*/
+  long bytesAllocated; /*Bytes the arena of the file requested from the system*/
+  long bytesWritten; /*Bytes of the output files written*/
+  long jmpNextSaved; /*Words saved by every pattern of the peephole optimizer (-O)*/
+  long movSelfSaved;
+  long clrMovSaved;
+  long bneRetargeted; /*bne sent to the target of a jmp, which saves no words*/
+  long outlineSaved; /*Words saved by the outliner (-Os)*/
+  long subroutines; /*Subroutines it made*/
+  long outlinedCopies; /*Copies it replaced by a jsr*/
+  long dataSaved; /*Words saved by the data optimizer (--merge-data)*/
+  long identicalRuns; /*Runs that share the words of an identical run*/
+  long suffixRuns; /*Runs that share the last words of a longer run*/
+} assemblerStats;
+
+typedef struct assemblerContext {
+  char* fileName; /*Name of the file without its extension*/
+  char* directory; /*Directory the name is relative to, NULL for the working directory*/
+  assemblerOptions* options; /*Command-line options, shared by all the files*/
+  int IC; /*Instruction counter*/
+  int DC; /*Data counter*/
+  int lineCounterAs; /*Line counter for the source file*/
+  int lineCounterAm; /*Line counter for the first pass*/
+  textBuffer output[OUTPUTS]; /*Content of the output files, empty if a file is not written*/
+  int isStored; /*YES if a cache entry was written for the file*/
+  assemblerStats* stats; /*Where the phases are timed and counted, NULL when they are not*/
+  struct asmResult* result; /*Where the library keeps the images, NULL to write the output files*/
+  arena memory; /*Owns all the memory of the file*/
+  char* report; /*Diagnostics, printed once the file is done*/
+  size_t reportLength;
+  size_t reportCapacity;
+} assemblerContext;
+
+typedef struct token {
+  char* start; /*Points into the line, which is never modified*/
+  int length;
+  int kind;
+} token;
+
+typedef struct lexer {
+  char* position; /*Where the next token is searched from*/
+  char* end;
+} lexer;
+
+typedef struct wordImage {
+  machineWord* words; /*Contiguous words, indexed by IC (code) or DC (data)*/
+  int count;
+  int capacity;
+  arena* memory; /*Owner of the words*/
+} wordImage;
 
 typedef struct nodeCodeImg* ptrCodeImg;
 typedef struct nodeCodeImg {
-  int lineNum;
+  int lineNum; /*Index of the first word of the instruction in the code image*/
   int opcode;
   int L;
-  char* output;
-  ptrCodeImg next;
 } itemCodeImg;
 
+typedef struct nodeFixup* ptrFixup;
+typedef struct nodeFixup {
+  int type; /*CODE for an operand, ENTRY for an .entry directive*/
+  int mode; /*Addressing mode of the operand (-1 if illegal)*/
+  int slot; /*Index of the first word of the operand in the code image*/
+  int lineNum; /*Line of the operand or directive*/
+  char* arg; /*The operand, or the argument of .entry*/
+  char* line; /*The whole line in the expanded source, for error reporting*/
+  int lineLength;
+} itemFixup;
+
+typedef struct fixupList {
+  itemFixup* items; /*Operands that depend on labels and .entry directives, in line order*/
+  int count;
+  int capacity;
+  int lastCodeLine; /*Line of the last instruction*/
+  arena* memory; /*Owner of the items and their text*/
+} fixupList;
+
+typedef struct codeImage {
+  itemCodeImg* lines; /*Instructions in IC order*/
+  int count;
+  int capacity;
+  arena* memory; /*Owner of the instructions*/
+  wordImage words; /*Words of all the instructions, indexed by IC*/
+  fixupList fixups; /*Operands the second pass patches into the words*/
+} codeImage;
+
 typedef struct nodeExtEnt* ptrExtEnt;
 typedef struct nodeExtEnt {
   int lineNum;
   int type;
+  int order; /*Position in which the item was added*/
   char* varName;
-  ptrExtEnt next;
 } itemExtEnt;
 
+typedef struct extEntList {
+  itemExtEnt* items; /*Appended in any order and sorted once before export*/
+  int count;
+  int capacity;
+  arena* memory; /*Owner of the items and their names*/
+} extEntList;
+
 typedef struct nodeLabel* ptrLabel;
 typedef struct nodeLabel {
   char* labelName;
+  unsigned long hash;
   int labelType;
   int data;
   ptrLabel next;
 } itemLabel;
+
+typedef struct symbolEvent {
+  int kind; /*EVENT_DEFINE, EVENT_NEW or EVENT_CONSTANT*/
+  int labelType;
+  int data; /*Value of the label, relative to the chunk for code and data (index of the data word for EVENT_CONSTANT)*/
+  char* name;
+} symbolEvent;
+
+typedef struct symbolEventList {
+  symbolEvent* items; /*In line order*/
+  int count;
+  int capacity;
+  arena* memory; /*Owner of the items and their names*/
+} symbolEventList;
+
+typedef struct symbolTable {
+  ptrLabel* slots; /*Open-addressing index, each name points at its first definition*/
+  unsigned long capacity;
+  unsigned long count;
+  ptrLabel head; /*Labels in definition order*/
+  ptrLabel tail;
+  unsigned long lookups; /*Calls of is_label, for --stats*/
+  symbolEventList* events; /*Where a chunk of --split records its definitions, NULL when they are final*/
+  arena* memory; /*Owner of the labels, their names and the slots*/
+} symbolTable;
+
+typedef struct objectImage {
+  int IC; /*Words of code*/
+  int DC; /*Words of data, loaded right after the code*/
+  machineWord* words; /*IC+DC words, the first one is loaded at FIRST_ADDRESS*/
+} objectImage;
+
+typedef struct linkModule {
+  char* name; /*Name of the module without its extension*/
+  objectImage image;
+  int codeBase; /*Address of the first code word of the module in the linked image*/
+  int dataBase; /*Address of the first data word of the module in the linked image*/
+} linkModule;
+
+typedef struct asmSymbol {
+  char* name;
+  int address;
+} asmSymbol;
+
+typedef struct asmResult {
+  int isError; /*YES if the source has errors, there are no images and symbols then*/
+  objectImage image; /*Code then data, the words of the .ob file*/
+  asmSymbol* entries; /*The .ent lines, sorted by address*/
+  int entryCount;
+  asmSymbol* externals; /*The .ext lines, a use of an external label each*/
+  int externalCount;
+  char* diagnostics; /*Null terminated, what the command line would have printed*/
+  arena memory; /*Owns everything in the result*/
+} asmResult;
+
+typedef struct simOperand {
+  machineWord* location; /*The register, memory word or immediate value the operand reads and writes*/
+  machineWord immediate; /*Value of an IMMEDIATE operand*/
+  int mode; /*Addressing mode*/
+  int value; /*Address of a DIRECT or INDEX operand (with its index), register number of a register*/
+} simOperand;
+
+typedef struct simulator* ptrSimulator;
+typedef struct simInstruction* ptrInstruction;
+typedef int (*executeFunction)(ptrSimulator sim, ptrInstruction instruction);
+
+typedef struct simInstruction {
+  executeFunction execute; /*Handler of the opcode, or of an address that does not start an instruction*/
+  int address;
+  int length; /*Words of the instruction*/
+  const char* fault; /*Why the instruction cannot be executed, for the fault handler*/
+  simOperand source;
+  simOperand destination;
+} simInstruction;
+
+typedef struct simulator {
+  machineWord memory[SIM_MEMORY];
+  machineWord registers[REGISTERS];
+  int zero; /*Z flag, set by cmp*/
+  int stack[SIM_STACK]; /*Return addresses of jsr*/
+  int depth;
+  simInstruction* code; /*Predecoded instructions indexed by address, up to the end of the code*/
+  int codeEnd; /*First address after the code*/
+} simulator;
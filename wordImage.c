@@ -0,0 +1,181 @@
+/******************************************************
+ * File: wordImage.c
+ * Description: This file provides functions to build the
+ *              code and data images as growable arrays
+ *              of packed machine words, and the list of
+ *              operands the second pass patches into them.
+ ******************************************************/
+
+#include "universal.h"
+#include "arena.h"
+
+#define INITIAL_WORDS 256 /*Initial capacity of a word image*/
+#define INITIAL_LINES 64 /*Initial capacity of the instructions of a code image*/
+
+void init_fixup_list(fixupList* list, arena* memory);
+
+/******************************************************
+ * Function: init_word_image
+ * Description: Initializes an empty word image.
+ * 
+ * @param image: Pointer to the word image to initialize.
+ * @param memory: Arena that owns the image.
+ ******************************************************/
+void init_word_image(wordImage* image, arena* memory) {
+  image->memory = memory;
+  image->words = NULL;
+  image->count = 0;
+  image->capacity = 0;
+}
+
+/******************************************************
+ * Function: add_word
+ * Description: Appends a machine word to a word image.
+ * 
+ * @param image: Pointer to the word image.
+ * @param word: The machine word to append.
+ ******************************************************/
+void add_word(wordImage* image, machineWord word) {
+  /* Double the capacity when the image is full */
+  if(image->count == image->capacity) {
+    int capacity = image->capacity == 0 ? INITIAL_WORDS : image->capacity*2;
+    image->words = (machineWord*) arena_grow(image->memory, image->words, image->capacity*sizeof(machineWord), capacity*sizeof(machineWord));
+    image->capacity = capacity;
+  }
+  image->words[image->count++] = word;
+}
+
+/******************************************************
+ * Function: init_code_image
+ * Description: Initializes an empty code image.
+ * 
+ * @param image: Pointer to the code image to initialize.
+ * @param memory: Arena that owns the image.
+ ******************************************************/
+void init_code_image(codeImage* image, arena* memory) {
+  image->memory = memory;
+  image->lines = NULL;
+  image->count = 0;
+  image->capacity = 0;
+  init_word_image(&image->words, memory);
+  init_fixup_list(&image->fixups, memory);
+}
+
+/******************************************************
+ * Function: add_code_line
+ * Description: Appends an instruction to a code image.
+ * 
+ * @param image: Pointer to the code image.
+ * @param lineNum: Address (IC) of the instruction.
+ * @param opcode: Opcode of the instruction.
+ * @param L: Length of the instruction.
+ * @return Pointer to the newly added instruction.
+ ******************************************************/
+ptrCodeImg add_code_line(codeImage* image, int lineNum, int opcode, int L) {
+  ptrCodeImg t;
+  
+  /* Double the capacity when the image is full */
+  if(image->count == image->capacity) {
+    int capacity = image->capacity == 0 ? INITIAL_LINES : image->capacity*2;
+    image->lines = (itemCodeImg*) arena_grow(image->memory, image->lines, image->capacity*sizeof(itemCodeImg), capacity*sizeof(itemCodeImg));
+    image->capacity = capacity;
+  }
+  t = &image->lines[image->count++];
+  t->lineNum = lineNum;
+  t->opcode = opcode;
+  t->L = L;
+  return t;
+}
+
+/******************************************************
+ * Function: init_fixup_list
+ * Description: Initializes an empty list of fixups.
+ * 
+ * @param list: Pointer to the list to initialize.
+ * @param memory: Arena that owns the list.
+ ******************************************************/
+void init_fixup_list(fixupList* list, arena* memory) {
+  list->memory = memory;
+  list->items = NULL;
+  list->count = 0;
+  list->capacity = 0;
+  list->lastCodeLine = 0;
+}
+
+/******************************************************
+ * Function: add_fixup
+ * Description: Appends a fixup to the list.
+ * 
+ * @param list: Pointer to the list.
+ * @param type: CODE for an operand, ENTRY for an .entry directive.
+ * @param mode: Addressing mode of the operand.
+ * @param slot: Index of the first word of the operand in the code image.
+ * @param lineNum: Line of the operand or directive.
+ * @param arg: The operand or the argument of .entry (copied, may be NULL).
+ * @param line: The whole line in the expanded source (kept as is, it must be owned by the arena).
+ * @param lineLength: Length of the line.
+ ******************************************************/
+void add_fixup(fixupList* list, int type, int mode, int slot, int lineNum, char* arg, char* line, int lineLength) {
+  ptrFixup t;
+  
+  /* Double the capacity when the list is full */
+  if(list->count == list->capacity) {
+    int capacity = list->capacity == 0 ? INITIAL_LINES : list->capacity*2;
+    list->items = (itemFixup*) arena_grow(list->memory, list->items, list->capacity*sizeof(itemFixup), capacity*sizeof(itemFixup));
+    list->capacity = capacity;
+  }
+  t = &list->items[list->count++];
+  t->type = type;
+  t->mode = mode;
+  t->slot = slot;
+  t->lineNum = lineNum;
+  t->arg = arg == NULL ? NULL : arena_strdup(list->memory, arg);
+  t->line = line;
+  t->lineLength = lineLength;
+}
+
+/******************************************************
+ * Function: append_words
+ * Description: Appends consecutive machine words to a word image.
+ * 
+ * @param image: Pointer to the word image.
+ * @param words: The words to append.
+ * @param count: Number of words.
+ ******************************************************/
+void append_words(wordImage* image, machineWord* words, int count) {
+  /* Grow once for all the words */
+  if(image->count + count > image->capacity) {
+    int capacity = image->capacity == 0 ? INITIAL_WORDS : image->capacity;
+    while(image->count + count > capacity) capacity *= 2;
+    image->words = (machineWord*) arena_grow(image->memory, image->words, image->capacity*sizeof(machineWord), capacity*sizeof(machineWord));
+    image->capacity = capacity;
+  }
+  if(count > 0) memcpy(image->words + image->count, words, count*sizeof(machineWord));
+  image->count += count;
+}
+
+/******************************************************
+ * Function: append_fixups
+ * Description: Appends the fixups of another list, moving their slots.
+ *		Their text is not copied, it stays owned by the arena of the other list.
+ * 
+ * @param list: Pointer to the list.
+ * @param from: Pointer to the list the fixups are taken from.
+ * @param offset: Added to the slot of every fixup.
+ ******************************************************/
+void append_fixups(fixupList* list, fixupList* from, int offset) {
+  int i;
+  
+  /* Grow once for all the fixups */
+  if(list->count + from->count > list->capacity) {
+    int capacity = list->capacity == 0 ? INITIAL_LINES : list->capacity;
+    while(list->count + from->count > capacity) capacity *= 2;
+    list->items = (itemFixup*) arena_grow(list->memory, list->items, list->capacity*sizeof(itemFixup), capacity*sizeof(itemFixup));
+    list->capacity = capacity;
+  }
+  for(i = 0; i < from->count; i++) {
+    list->items[list->count] = from->items[i];
+    list->items[list->count++].slot += offset;
+  }
+  if(from->lastCodeLine > list->lastCodeLine) list->lastCodeLine = from->lastCodeLine;
+}
@@ -0,0 +1,76 @@
+/******************************************************
+ * Function: init_word_image
+ * Description: Initializes an empty word image.
+ * 
+ * @param image: Pointer to the word image to initialize.
+ * @param memory: Arena that owns the image.
+ ******************************************************/
+void init_word_image(wordImage* image, arena* memory);
+/******************************************************
+ * Function: add_word
+ * Description: Appends a machine word to a word image.
+ * 
+ * @param image: Pointer to the word image.
+ * @param word: The machine word to append.
+ ******************************************************/
+void add_word(wordImage* image, machineWord word);
+/******************************************************
+ * Function: init_code_image
+ * Description: Initializes an empty code image.
+ * 
+ * @param image: Pointer to the code image to initialize.
+ * @param memory: Arena that owns the image.
+ ******************************************************/
+void init_code_image(codeImage* image, arena* memory);
+/******************************************************
+ * Function: add_code_line
+ * Description: Appends an instruction to a code image.
+ * 
+ * @param image: Pointer to the code image.
+ * @param lineNum: Address (IC) of the instruction.
+ * @param opcode: Opcode of the instruction.
+ * @param L: Length of the instruction.
+ * @return Pointer to the newly added instruction.
+ ******************************************************/
+ptrCodeImg add_code_line(codeImage* image, int lineNum, int opcode, int L);
+/******************************************************
+ * Function: init_fixup_list
+ * Description: Initializes an empty list of fixups.
+ * 
+ * @param list: Pointer to the list to initialize.
+ * @param memory: Arena that owns the list.
+ ******************************************************/
+void init_fixup_list(fixupList* list, arena* memory);
+/******************************************************
+ * Function: add_fixup
+ * Description: Appends a fixup to the list.
+ * 
+ * @param list: Pointer to the list.
+ * @param type: CODE for an operand, ENTRY for an .entry directive.
+ * @param mode: Addressing mode of the operand.
+ * @param slot: Index of the first word of the operand in the code image.
+ * @param lineNum: Line of the operand or directive.
+ * @param arg: The operand or the argument of .entry (copied, may be NULL).
+ * @param line: The whole line in the expanded source (kept as is, it must be owned by the arena).
+ * @param lineLength: Length of the line.
+ ******************************************************/
+void add_fixup(fixupList* list, int type, int mode, int slot, int lineNum, char* arg, char* line, int lineLength);
+/******************************************************
+ * Function: append_words
+ * Description: Appends consecutive machine words to a word image.
+ * 
+ * @param image: Pointer to the word image.
+ * @param words: The words to append.
+ * @param count: Number of words.
+ ******************************************************/
+void append_words(wordImage* image, machineWord* words, int count);
+/******************************************************
+ * Function: append_fixups
+ * Description: Appends the fixups of another list, moving their slots.
+ *		Their text is not copied, it stays owned by the arena of the other list.
+ * 
+ * @param list: Pointer to the list.
+ * @param from: Pointer to the list the fixups are taken from.
+ * @param offset: Added to the slot of every fixup.
+ ******************************************************/
+void append_fixups(fixupList* list, fixupList* from, int offset);